@@ -1240,6 +1240,110 @@ throw_invalid_argument(JSContext      *context,
     g_free(display_name);
 }
 
+/* Returns the size of the elements of @obj if it is a typed array, or 0 */
+static gsize
+typed_array_element_size(JSObject *obj,
+                         bool     *is_float)
+{
+    *is_float = false;
+    if (JS_IsInt8Array(obj) || JS_IsUint8Array(obj) || JS_IsUint8ClampedArray(obj))
+        return 1;
+    if (JS_IsInt16Array(obj) || JS_IsUint16Array(obj))
+        return 2;
+    if (JS_IsInt32Array(obj) || JS_IsUint32Array(obj))
+        return 4;
+
+    *is_float = true;
+    if (JS_IsFloat32Array(obj))
+        return 4;
+    if (JS_IsFloat64Array(obj))
+        return 8;
+
+    return 0;
+}
+
+/* Fast path for typed arrays and ByteArrays whose elements have the same
+ * representation as those of the C array: their contents are copied in
+ * one go instead of converting each element. Integers are truncated to
+ * the size of the C type anyway, so signedness doesn't matter. Returns
+ * false if @value is not such an array. */
+static bool
+gjs_contiguous_array_to_array(JSContext       *context,
+                              JS::HandleValue  value,
+                              GITypeInfo      *param_info,
+                              void           **arr_p,
+                              gsize           *length_p)
+{
+    GITypeTag element_type = g_type_info_get_tag(param_info);
+    gsize element_size, length;
+    bool is_float = false, obj_is_float;
+    guint8 *data;
+
+    if (!value.isObject())
+        return false;
+
+    JS::RootedObject obj(context, &value.toObject());
+
+    if (element_type == GI_TYPE_TAG_INTERFACE) {
+        GIBaseInfo *interface_info = g_type_info_get_interface(param_info);
+        GIInfoType info_type = g_base_info_get_type(interface_info);
+        if (info_type == GI_INFO_TYPE_ENUM || info_type == GI_INFO_TYPE_FLAGS)
+            element_type = g_enum_info_get_storage_type ((GIEnumInfo*) interface_info);
+        g_base_info_unref(interface_info);
+    }
+
+    switch (element_type) {
+    case GI_TYPE_TAG_INT8:
+    case GI_TYPE_TAG_UINT8:
+        element_size = 1;
+        break;
+    case GI_TYPE_TAG_INT16:
+    case GI_TYPE_TAG_UINT16:
+        element_size = 2;
+        break;
+    case GI_TYPE_TAG_INT32:
+    case GI_TYPE_TAG_UINT32:
+    case GI_TYPE_TAG_UNICHAR:
+        element_size = 4;
+        break;
+    case GI_TYPE_TAG_FLOAT:
+        element_size = sizeof(float);
+        is_float = true;
+        break;
+    case GI_TYPE_TAG_DOUBLE:
+        element_size = sizeof(double);
+        is_float = true;
+        break;
+    default:
+        return false;
+    }
+
+    if (gjs_typecheck_bytearray(context, obj, false)) {
+        if (element_size != 1)
+            return false;
+        gjs_byte_array_peek_data(context, obj, &data, &length);
+    } else if (JS_IsTypedArrayObject(obj)) {
+        if (typed_array_element_size(obj, &obj_is_float) != element_size ||
+            obj_is_float != is_float)
+            return false;
+        data = (guint8 *) JS_GetArrayBufferViewData(obj);
+        length = JS_GetTypedArrayLength(obj);
+    } else {
+        return false;
+    }
+
+    gjs_debug_marshal(GJS_DEBUG_GFUNCTION,
+                      "Copying %" G_GSIZE_FORMAT " elements of a contiguous array",
+                      length);
+
+    /* add one so we're always zero terminated */
+    *arr_p = g_malloc0((length + 1) * element_size);
+    if (length > 0)
+        memcpy(*arr_p, data, length * element_size);
+    *length_p = length;
+    return true;
+}
+
 static bool
 gjs_array_to_explicit_array_internal(JSContext       *context,
                                      JS::HandleValue  value,
@@ -1275,6 +1379,9 @@ gjs_array_to_explicit_array_internal(JSContext       *context,
         if (!gjs_string_to_intarray(context, value, param_info,
                                     contents, length_p))
             goto out;
+    } else if (gjs_contiguous_array_to_array(context, value, param_info,
+                                             contents, length_p)) {
+        /* Typed array or ByteArray, copied in one go */
     } else {
         JS::RootedObject array_obj(context, &value.toObject());
         if (JS_HasPropertyById(context, array_obj, length_name, &found_length) &&
@@ -2129,21 +2236,20 @@ gjs_value_to_arg(JSContext      *context,
 bool
 gjs_value_to_explicit_array (JSContext      *context,
                              JS::HandleValue value,
-                             GIArgInfo      *arg_info,
+                             GITypeInfo     *type_info,
+                             const char     *arg_name,
+                             GITransfer      transfer,
+                             bool            may_be_null,
                              GIArgument     *arg,
                              size_t         *length_p)
 {
-    GITypeInfo type_info;
-
-    g_arg_info_load_type(arg_info, &type_info);
-
     return gjs_array_to_explicit_array_internal(context,
                                                 value,
-                                                &type_info,
-                                                g_base_info_get_name((GIBaseInfo*) arg_info),
+                                                type_info,
+                                                arg_name,
                                                 GJS_ARGUMENT_ARGUMENT,
-                                                g_arg_info_get_ownership_transfer(arg_info),
-                                                g_arg_info_may_be_null(arg_info),
+                                                transfer,
+                                                may_be_null,
                                                 &arg->v_pointer,
                                                 length_p);
 }
@@ -2374,6 +2480,78 @@ gjs_value_from_explicit_array(JSContext             *context,
     return res;
 }
 
+/* Like gjs_value_from_explicit_array(), but arrays of numbers that fit in a
+ * typed array are copied into one in a single memcpy, instead of boxing
+ * each element into a JS::Value. Other arrays are converted as usual. The
+ * caller still owns the C array and releases it according to its transfer.
+ */
+bool
+gjs_typed_array_from_explicit_array(JSContext             *context,
+                                    JS::MutableHandleValue value_p,
+                                    GITypeInfo            *type_info,
+                                    GIArgument            *arg,
+                                    int                    length)
+{
+    GITypeInfo *param_info;
+    GITypeTag element_type;
+    gsize element_size;
+    JS::RootedObject obj(context);
+
+    param_info = g_type_info_get_param_type(type_info, 0);
+    element_type = g_type_info_get_tag(param_info);
+    g_base_info_unref((GIBaseInfo*)param_info);
+
+    switch (element_type) {
+    case GI_TYPE_TAG_INT8:
+        obj = JS_NewInt8Array(context, length);
+        element_size = 1;
+        break;
+    case GI_TYPE_TAG_UINT8:
+        obj = JS_NewUint8Array(context, length);
+        element_size = 1;
+        break;
+    case GI_TYPE_TAG_INT16:
+        obj = JS_NewInt16Array(context, length);
+        element_size = 2;
+        break;
+    case GI_TYPE_TAG_UINT16:
+        obj = JS_NewUint16Array(context, length);
+        element_size = 2;
+        break;
+    case GI_TYPE_TAG_INT32:
+        obj = JS_NewInt32Array(context, length);
+        element_size = 4;
+        break;
+    case GI_TYPE_TAG_UINT32:
+        obj = JS_NewUint32Array(context, length);
+        element_size = 4;
+        break;
+    case GI_TYPE_TAG_FLOAT:
+        obj = JS_NewFloat32Array(context, length);
+        element_size = 4;
+        break;
+    case GI_TYPE_TAG_DOUBLE:
+        obj = JS_NewFloat64Array(context, length);
+        element_size = 8;
+        break;
+    default:
+        /* 64-bit integers don't fit in a typed array without losing
+         * precision, and the rest aren't plain numbers */
+        return gjs_value_from_explicit_array(context, value_p, type_info,
+                                             arg, length);
+    }
+
+    if (obj == NULL)
+        return false;
+
+    if (length > 0)
+        memcpy(JS_GetArrayBufferViewData(obj), arg->v_pointer,
+               length * element_size);
+
+    value_p.setObject(*obj);
+    return true;
+}
+
 static bool
 gjs_array_from_boxed_array (JSContext             *context,
                             JS::MutableHandleValue value_p,
@@ -50,7 +50,10 @@ bool gjs_value_to_arg(JSContext      *context,
 
 bool gjs_value_to_explicit_array(JSContext       *context,
                                  JS::HandleValue  value,
-                                 GIArgInfo       *arg_info,
+                                 GITypeInfo      *type_info,
+                                 const char      *arg_name,
+                                 GITransfer       transfer,
+                                 bool             may_be_null,
                                  GIArgument      *arg,
                                  size_t          *length_p);
 
@@ -79,6 +82,12 @@ bool gjs_value_from_explicit_array(JSContext             *context,
                                    GIArgument            *arg,
                                    int                    length);
 
+bool gjs_typed_array_from_explicit_array(JSContext             *context,
+                                         JS::MutableHandleValue value_p,
+                                         GITypeInfo            *type_info,
+                                         GIArgument            *arg,
+                                         int                    length);
+
 bool gjs_g_argument_release    (JSContext  *context,
                                 GITransfer  transfer,
                                 GITypeInfo *type_info,
@@ -43,6 +43,7 @@ typedef struct {
     /* prototype info */
     GIBoxedInfo *info;
     GType gtype;
+    const char *type_name; /* interned, for memory accounting */
     gint zero_args_constructor; /* -1 if none */
     JS::Heap<jsid> zero_args_constructor_name;
     gint default_constructor; /* -1 if none */
@@ -56,6 +57,7 @@ typedef struct {
     guint allocated_directly : 1;
     guint not_owning_gboxed : 1; /* if set, the JS wrapper does not own
                                     the reference to the C gboxed */
+    guint accounted : 1; /* counted in the per-type memory accounting */
 } Boxed;
 
 static bool struct_is_simple(GIStructInfo *info);
@@ -205,6 +207,37 @@ boxed_get_copy_source(JSContext *context,
     return true;
 }
 
+/* Called once the wrapper has a gboxed: counts it in the per-type memory
+ * accounting, and reports the size of a boxed we now own to the GC
+ * scheduler, so that wrappers for large structs get collected promptly. */
+static void
+boxed_account_instance(JSContext *context,
+                       Boxed     *priv)
+{
+    gsize size;
+
+    if (priv->gboxed == NULL || priv->accounted)
+        return;
+
+    size = priv->not_owning_gboxed ? 0 : g_struct_info_get_size(priv->info);
+    gjs_memory_account_type("boxed", priv->type_name, 1, size);
+    gjs_gc_note_native_alloc(context, size);
+    priv->accounted = true;
+}
+
+static void
+boxed_unaccount_instance(Boxed *priv)
+{
+    gsize size;
+
+    if (!priv->accounted)
+        return;
+
+    size = priv->not_owning_gboxed ? 0 : g_struct_info_get_size(priv->info);
+    gjs_memory_account_type("boxed", priv->type_name, -1, -(gint64) size);
+    priv->accounted = false;
+}
+
 static void
 boxed_new_direct(Boxed       *priv)
 {
@@ -454,6 +487,7 @@ GJS_NATIVE_CONSTRUCTOR_DECLARE(boxed)
 
         if (g_type_is_a (priv->gtype, G_TYPE_BOXED)) {
             priv->gboxed = g_boxed_copy(priv->gtype, source_priv->gboxed);
+            boxed_account_instance(context, priv);
 
             GJS_NATIVE_CONSTRUCTOR_FINISH(boxed);
             return true;
@@ -461,6 +495,7 @@ GJS_NATIVE_CONSTRUCTOR_DECLARE(boxed)
             boxed_new_direct (priv);
             memcpy(priv->gboxed, source_priv->gboxed,
                    g_struct_info_get_size (priv->info));
+            boxed_account_instance(context, priv);
 
             GJS_NATIVE_CONSTRUCTOR_FINISH(boxed);
             return true;
@@ -473,6 +508,7 @@ GJS_NATIVE_CONSTRUCTOR_DECLARE(boxed)
 
     argv.rval().setUndefined();
     retval = boxed_new(context, object, priv, argv);
+    boxed_account_instance(context, priv);
 
     if (argv.rval().isUndefined())
         GJS_NATIVE_CONSTRUCTOR_FINISH(boxed);
@@ -492,6 +528,8 @@ boxed_finalize(JSFreeOp *fop,
     if (priv == NULL)
         return; /* wrong class? */
 
+    boxed_unaccount_instance(priv);
+
     if (priv->gboxed && !priv->not_owning_gboxed) {
         if (priv->allocated_directly) {
             g_slice_free1(g_struct_info_get_size (priv->info), priv->gboxed);
@@ -901,7 +939,7 @@ boxed_trace(JSTracer *tracer,
  */
 struct JSClass gjs_boxed_class = {
     "GObject_Boxed",
-    JSCLASS_HAS_PRIVATE |
+    JSCLASS_HAS_PRIVATE | JSCLASS_IMPLEMENTS_BARRIERS |
     JSCLASS_NEW_RESOLVE |
     JSCLASS_HAS_RESERVED_SLOTS(1),
     JS_PropertyStub,
@@ -1154,6 +1192,15 @@ gjs_define_boxed_class(JSContext       *context,
 
     g_base_info_ref( (GIBaseInfo*) priv->info);
     priv->gtype = g_registered_type_info_get_g_type ((GIRegisteredTypeInfo*) priv->info);
+    if (priv->gtype != G_TYPE_NONE) {
+        priv->type_name = g_type_name(priv->gtype);
+    } else {
+        char *name = g_strdup_printf("%s.%s",
+                                     g_base_info_get_namespace((GIBaseInfo *) info),
+                                     g_base_info_get_name((GIBaseInfo *) info));
+        priv->type_name = g_intern_string(name);
+        g_free(name);
+    }
     JS_SetPrivate(prototype, priv);
 
     gjs_debug(GJS_DEBUG_GBOXED, "Defined class %s prototype is %p class %p in object %p",
@@ -1209,6 +1256,7 @@ gjs_boxed_from_c_struct(JSContext             *context,
          */
         priv->gboxed = gboxed;
         priv->not_owning_gboxed = true;
+        boxed_account_instance(context, priv);
     } else {
         if (priv->gtype != G_TYPE_NONE && g_type_is_a (priv->gtype, G_TYPE_BOXED)) {
             priv->gboxed = g_boxed_copy(priv->gtype, gboxed);
@@ -1222,6 +1270,8 @@ gjs_boxed_from_c_struct(JSContext             *context,
                       "Can't create a Javascript object for %s; no way to copy",
                       g_base_info_get_name( (GIBaseInfo*) priv->info));
         }
+
+        boxed_account_instance(context, priv);
     }
 
     return obj;
@@ -37,6 +37,7 @@ typedef struct {
     JSRuntime *runtime;
     JSContext *context;
     JSObject *obj;
+    guint keep_alive_index;
     guint unref_on_global_object_finalized : 1;
 } Closure;
 
@@ -74,13 +75,26 @@ typedef struct {
  *
  */
 
+/* Drops the reference to the callable, with the pre-barrier needed if an
+ * incremental GC is marking: we may be removing the last edge to it from
+ * an object that was already traced. */
+static void
+clear_js_obj(Closure *c)
+{
+    if (c->obj != NULL && c->runtime != NULL &&
+        JS::IsIncrementalBarrierNeeded(c->runtime))
+        JS::IncrementalObjectBarrier(c->obj);
+
+    c->obj = NULL;
+}
+
 static void
 invalidate_js_pointers(Closure *c)
 {
     if (c->obj == NULL)
         return;
 
-    c->obj = NULL;
+    clear_js_obj(c);
     c->context = NULL;
     c->runtime = NULL;
 
@@ -224,7 +238,8 @@ closure_invalidated(gpointer data,
         gjs_keep_alive_remove_global_child(c->context,
                                            global_context_finalized,
                                            c->obj,
-                                           c);
+                                           c,
+                                           &c->keep_alive_index);
 
         c->obj = NULL;
         c->context = NULL;
@@ -238,7 +253,7 @@ closure_set_invalid(gpointer  data,
 {
     Closure *self = (Closure*) closure;
 
-    self->obj = NULL;
+    clear_js_obj(self);
     self->context = NULL;
     self->runtime = NULL;
 
@@ -369,7 +384,8 @@ gjs_closure_new(JSContext  *context,
         gjs_keep_alive_add_global_child(context,
                                         global_context_finalized,
                                         c->obj,
-                                        c);
+                                        c,
+                                        &c->keep_alive_index);
 
         g_closure_add_invalidate_notifier(&c->base, NULL, closure_invalidated);
     } else {
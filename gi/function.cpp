@@ -50,15 +50,88 @@
  */
 #define GJS_ARG_INDEX_INVALID G_MAXUINT8
 
+/* The enum and flags values that a primitive invoker passes on or returns
+ * without looking at the introspection info, see init_enum_check().
+ * Other values go through the checks in arg.cpp. */
 typedef struct {
+    bool is_flags;
+    bool is_signed;
+    /* enums: bit n is set if min + n is a value */
+    gint64 min;
+    /* flags: the bits that are defined as single-bit values */
+    guint64 valid;
+} GjsEnumCheck;
+
+/* Everything the invoke loop needs to know about one argument, computed
+ * once in init_cached_function_data() so that calling the function does
+ * not have to walk the typelib again. The GIArgInfo and GITypeInfo are
+ * stack-style infos pointing into the Function's info, which outlives
+ * them.
+ */
+typedef struct {
+    GIArgInfo arg_info;
+    GITypeInfo type_info;
+    const char *name;
+
+    GjsParamType param_type;
+    GIDirection direction;
+    GITypeTag type_tag;
+    GITransfer transfer;
+    GjsArgumentType arg_type;
+    GIScopeType scope;
+    bool may_be_null;
+
+    /* For (out caller-allocates); size is 0 if the type is unsupported */
+    bool is_caller_allocates;
+    gsize caller_allocates_size;
+
+    /* Positions of linked arguments in the GI argument list, or -1 */
+    int array_length_pos;
+    int destroy_pos;
+    int closure_pos;
+
+    /* For enum and flags arguments of primitive invokers */
+    GjsEnumCheck enum_check;
+} GjsArgumentCache;
+
+typedef struct _Function Function;
+
+/* Specialized invoker for functions that only take and return numbers,
+ * booleans, enums and flags, see init_primitive_invoker(). Returns false
+ * without throwing if the call has to go through gjs_invoke_c_function()
+ * instead; otherwise the function was called, and @ret_p is set to
+ * whether the return value could be converted.
+ */
+typedef bool (*GjsPrimitiveInvoker)(JSContext          *context,
+                                    Function           *function,
+                                    JS::HandleObject    obj,
+                                    const JS::CallArgs& argv,
+                                    bool               *ret_p);
+
+struct _Function {
     GIFunctionInfo *info;
 
-    GjsParamType *param_types;
+    GjsArgumentCache *arguments;
+    guint8 n_args;
+
+    GITypeInfo return_info;
+    GITypeTag return_tag;
+    GITransfer return_transfer;
+    int return_array_length_pos;
 
+    bool is_method;
+    bool can_throw_gerror;
     guint8 expected_js_argc;
     guint8 js_out_argc;
     GIFunctionInvoker invoker;
-} Function;
+
+    GjsPrimitiveInvoker primitive_invoker;
+    GType instance_gtype;
+    GjsEnumCheck return_enum_check;
+
+    /* Return numeric arrays as typed arrays, see set_typed_arrays() */
+    bool typed_arrays;
+};
 
 extern struct JSClass gjs_function_class;
 
@@ -664,6 +737,37 @@ gjs_fill_method_instance(JSContext       *context,
     return true;
 }
 
+/* Because we can't free a closure while we're in it, we defer
+ * freeing until the next time a C function is invoked.  What
+ * we should really do instead is queue it for a GC thread.
+ */
+static void
+free_completed_trampolines(void)
+{
+    GSList *iter;
+
+    if (completed_trampolines == NULL)
+        return;
+
+    for (iter = completed_trampolines; iter; iter = iter->next) {
+        GjsCallbackTrampoline *trampoline = (GjsCallbackTrampoline *) iter->data;
+        gjs_callback_trampoline_unref(trampoline);
+    }
+    g_slist_free(completed_trampolines);
+    completed_trampolines = NULL;
+}
+
+static bool
+gjs_value_to_cached_arg(JSContext        *context,
+                        JS::HandleValue   value,
+                        GjsArgumentCache *cache,
+                        GIArgument       *arg)
+{
+    return gjs_value_to_g_argument(context, value, &cache->type_info,
+                                   cache->name, cache->arg_type,
+                                   cache->transfer, cache->may_be_null, arg);
+}
+
 /*
  * This function can be called in 2 different ways. You can either use
  * it to create javascript objects by providing a @js_rval argument or
@@ -707,30 +811,17 @@ gjs_invoke_c_function(JSContext                              *context,
     bool failed, postinvoke_release_failed;
 
     bool is_method;
-    GITypeInfo return_info;
     GITypeTag return_tag;
     JS::AutoValueVector return_values(context);
     guint8 next_rval = 0; /* index into return_values */
-    GSList *iter;
 
-    /* Because we can't free a closure while we're in it, we defer
-     * freeing until the next time a C function is invoked.  What
-     * we should really do instead is queue it for a GC thread.
-     */
-    if (completed_trampolines) {
-        for (iter = completed_trampolines; iter; iter = iter->next) {
-            GjsCallbackTrampoline *trampoline = (GjsCallbackTrampoline *) iter->data;
-            gjs_callback_trampoline_unref(trampoline);
-        }
-        g_slist_free(completed_trampolines);
-        completed_trampolines = NULL;
-    }
+    free_completed_trampolines();
 
-    is_method = g_callable_info_is_method(function->info);
-    can_throw_gerror = g_callable_info_can_throw_gerror(function->info);
+    is_method = function->is_method;
+    can_throw_gerror = function->can_throw_gerror;
 
     c_argc = function->invoker.cif.nargs;
-    gi_argc = g_callable_info_get_n_args( (GICallableInfo*) function->info);
+    gi_argc = function->n_args;
 
     /* @c_argc is the number of arguments that the underlying C
      * function takes. @gi_argc is the number of arguments the
@@ -756,8 +847,7 @@ gjs_invoke_c_function(JSContext                              *context,
         return false;
     }
 
-    g_callable_info_load_return_type( (GICallableInfo*) function->info, &return_info);
-    return_tag = g_type_info_get_tag(&return_info);
+    return_tag = function->return_tag;
 
     in_arg_cvalues = g_newa(GArgument, c_argc);
     ffi_arg_pointers = g_newa(gpointer, c_argc);
@@ -778,79 +868,43 @@ gjs_invoke_c_function(JSContext                              *context,
 
     processed_c_args = c_arg_pos;
     for (gi_arg_pos = 0; gi_arg_pos < gi_argc; gi_arg_pos++, c_arg_pos++) {
-        GIDirection direction;
-        GIArgInfo arg_info;
+        GjsArgumentCache *cache = &function->arguments[gi_arg_pos];
+        GIDirection direction = cache->direction;
         bool arg_removed = false;
 
         /* gjs_debug(GJS_DEBUG_GFUNCTION, "gi_arg_pos: %d c_arg_pos: %d js_arg_pos: %d", gi_arg_pos, c_arg_pos, js_arg_pos); */
 
-        g_callable_info_load_arg( (GICallableInfo*) function->info, gi_arg_pos, &arg_info);
-        direction = g_arg_info_get_direction(&arg_info);
-
         g_assert_cmpuint(c_arg_pos, <, c_argc);
         ffi_arg_pointers[c_arg_pos] = &in_arg_cvalues[c_arg_pos];
 
         if (direction == GI_DIRECTION_OUT) {
-            if (g_arg_info_is_caller_allocates(&arg_info)) {
-                GITypeTag type_tag;
-                GITypeInfo ainfo;
-
-                g_arg_info_load_type(&arg_info, &ainfo);
-                type_tag = g_type_info_get_tag(&ainfo);
-
-                if (type_tag == GI_TYPE_TAG_INTERFACE) {
-                    GIBaseInfo* interface_info;
-                    GIInfoType interface_type;
-                    gsize size;
-
-                    interface_info = g_type_info_get_interface(&ainfo);
-                    g_assert(interface_info != NULL);
-
-                    interface_type = g_base_info_get_type(interface_info);
-
-                    if (interface_type == GI_INFO_TYPE_STRUCT) {
-                        size = g_struct_info_get_size((GIStructInfo*)interface_info);
-                    } else if (interface_type == GI_INFO_TYPE_UNION) {
-                        size = g_union_info_get_size((GIUnionInfo*)interface_info);
-                    } else {
-                        failed = true;
-                    }
-
-                    g_base_info_unref((GIBaseInfo*)interface_info);
-
-                    if (!failed) {
-                        in_arg_cvalues[c_arg_pos].v_pointer = g_slice_alloc0(size);
-                        out_arg_cvalues[c_arg_pos].v_pointer = in_arg_cvalues[c_arg_pos].v_pointer;
-                    }
+            if (cache->is_caller_allocates) {
+                if (cache->caller_allocates_size > 0) {
+                    in_arg_cvalues[c_arg_pos].v_pointer = g_slice_alloc0(cache->caller_allocates_size);
+                    out_arg_cvalues[c_arg_pos].v_pointer = in_arg_cvalues[c_arg_pos].v_pointer;
                 } else {
                     failed = true;
+                    gjs_throw(context, "Unsupported type %s for (out caller-allocates)",
+                              g_type_tag_to_string(cache->type_tag));
                 }
-                if (failed)
-                    gjs_throw(context, "Unsupported type %s for (out caller-allocates)", g_type_tag_to_string(type_tag));
             } else {
                 out_arg_cvalues[c_arg_pos].v_pointer = NULL;
                 in_arg_cvalues[c_arg_pos].v_pointer = &out_arg_cvalues[c_arg_pos];
             }
         } else {
             GArgument *in_value;
-            GITypeInfo ainfo;
-            GjsParamType param_type;
-
-            g_arg_info_load_type(&arg_info, &ainfo);
 
             in_value = &in_arg_cvalues[c_arg_pos];
 
-            param_type = function->param_types[gi_arg_pos];
-
-            switch (param_type) {
+            switch (cache->param_type) {
             case PARAM_CALLBACK: {
                 GICallableInfo *callable_info;
-                GIScopeType scope = g_arg_info_get_scope(&arg_info);
+                GIScopeType scope = cache->scope;
                 GjsCallbackTrampoline *trampoline;
                 ffi_closure *closure;
                 JS::HandleValue current_arg = args[js_arg_pos];
 
-                if (current_arg.isNull() && g_arg_info_may_be_null(&arg_info)) {
+                if (current_arg.isNull() && cache->may_be_null) {
                     closure = NULL;
                     trampoline = NULL;
                 } else {
@@ -858,14 +912,14 @@ gjs_invoke_c_function(JSContext                              *context,
                         gjs_throw(context, "Error invoking %s.%s: Expected function for callback argument %s, got %s",
                                   g_base_info_get_namespace( (GIBaseInfo*) function->info),
                                   g_base_info_get_name( (GIBaseInfo*) function->info),
-                                  g_base_info_get_name( (GIBaseInfo*) &arg_info),
+                                  cache->name,
                                   JS_GetTypeName(context,
                                                  JS_TypeOfValue(context, current_arg)));
                         failed = true;
                         break;
                     }
 
-                    callable_info = (GICallableInfo*) g_type_info_get_interface(&ainfo);
+                    callable_info = (GICallableInfo*) g_type_info_get_interface(&cache->type_info);
                     trampoline = gjs_callback_trampoline_new(context,
                                                              current_arg,
                                                              callable_info,
@@ -875,16 +929,16 @@ gjs_invoke_c_function(JSContext                              *context,
                     g_base_info_unref(callable_info);
                 }
 
-                gint destroy_pos = g_arg_info_get_destroy(&arg_info);
-                gint closure_pos = g_arg_info_get_closure(&arg_info);
+                gint destroy_pos = cache->destroy_pos;
+                gint closure_pos = cache->closure_pos;
                 if (destroy_pos >= 0) {
                     gint c_pos = is_method ? destroy_pos + 1 : destroy_pos;
-                    g_assert (function->param_types[destroy_pos] == PARAM_SKIPPED);
+                    g_assert (function->arguments[destroy_pos].param_type == PARAM_SKIPPED);
                     in_arg_cvalues[c_pos].v_pointer = trampoline ? (gpointer) gjs_destroy_notify_callback : NULL;
                 }
                 if (closure_pos >= 0) {
                     gint c_pos = is_method ? closure_pos + 1 : closure_pos;
-                    g_assert (function->param_types[closure_pos] == PARAM_SKIPPED);
+                    g_assert (function->arguments[closure_pos].param_type == PARAM_SKIPPED);
                     in_arg_cvalues[c_pos].v_pointer = trampoline;
                 }
 
@@ -900,29 +954,30 @@ gjs_invoke_c_function(JSContext                              *context,
                 arg_removed = true;
                 break;
             case PARAM_ARRAY: {
-                GIArgInfo array_length_arg;
-
-                gint array_length_pos = g_type_info_get_array_length(&ainfo);
+                gint array_length_pos = cache->array_length_pos;
+                GjsArgumentCache *length_cache = &function->arguments[array_length_pos];
                 gsize length;
 
                 if (!gjs_value_to_explicit_array(context, args[js_arg_pos],
-                                                 &arg_info, in_value, &length)) {
+                                                 &cache->type_info,
+                                                 cache->name,
+                                                 cache->transfer,
+                                                 cache->may_be_null,
+                                                 in_value, &length)) {
                     failed = true;
                     break;
                 }
 
-                g_callable_info_load_arg(function->info, array_length_pos, &array_length_arg);
-
                 array_length_pos += is_method ? 1 : 0;
                 JS::RootedValue v_length(context, JS::Int32Value(length));
-                if (!gjs_value_to_arg(context, v_length, &array_length_arg,
-                                      in_arg_cvalues + array_length_pos)) {
+                if (!gjs_value_to_cached_arg(context, v_length, length_cache,
+                                             in_arg_cvalues + array_length_pos)) {
                     failed = true;
                     break;
                 }
                 /* Also handle the INOUT for the length here */
                 if (direction == GI_DIRECTION_INOUT) {
-                    if (in_value->v_pointer == NULL) { 
+                    if (in_value->v_pointer == NULL) {
                         /* Special case where we were given JS null to
                          * also pass null for length, and not a
                          * pointer to an integer that derefs to 0.
@@ -940,8 +995,8 @@ gjs_invoke_c_function(JSContext                              *context,
             case PARAM_NORMAL: {
                 /* Ok, now just convert argument normally */
                 g_assert_cmpuint(js_arg_pos, <, args.length());
-                if (!gjs_value_to_arg(context, args[js_arg_pos], &arg_info,
-                                      in_value))
+                if (!gjs_value_to_cached_arg(context, args[js_arg_pos], cache,
+                                             in_value))
                     failed = true;
 
                 break;
@@ -1020,39 +1075,44 @@ gjs_invoke_c_function(JSContext                              *context,
             return_values.append(JS::UndefinedValue());
 
         if (return_tag != GI_TYPE_TAG_VOID) {
-            GITransfer transfer = g_callable_info_get_caller_owns((GICallableInfo*) function->info);
+            GITransfer transfer = function->return_transfer;
             bool arg_failed = false;
             gint array_length_pos;
 
             g_assert_cmpuint(next_rval, <, function->js_out_argc);
 
-            gi_type_info_extract_ffi_return_value(&return_info, &return_value, &return_gargument);
+            gi_type_info_extract_ffi_return_value(&function->return_info,
+                                                  &return_value, &return_gargument);
 
-            array_length_pos = g_type_info_get_array_length(&return_info);
+            array_length_pos = function->return_array_length_pos;
             if (array_length_pos >= 0) {
-                GIArgInfo array_length_arg;
-                GITypeInfo arg_type_info;
+                GjsArgumentCache *length_cache = &function->arguments[array_length_pos];
                 JS::RootedValue length(context);
 
-                g_callable_info_load_arg(function->info, array_length_pos, &array_length_arg);
-                g_arg_info_load_type(&array_length_arg, &arg_type_info);
                 array_length_pos += is_method ? 1 : 0;
                 arg_failed = !gjs_value_from_g_argument(context, &length,
-                                                        &arg_type_info,
+                                                        &length_cache->type_info,
                                                         &out_arg_cvalues[array_length_pos],
                                                         true);
                 if (!arg_failed && !js_rval.empty()) {
-                    arg_failed = !gjs_value_from_explicit_array(context,
-                                                                return_values.handleAt(next_rval),
-                                                                &return_info,
-                                                                &return_gargument,
-                                                                length.toInt32());
+                    if (function->typed_arrays)
+                        arg_failed = !gjs_typed_array_from_explicit_array(context,
+                                                                          return_values.handleAt(next_rval),
+                                                                          &function->return_info,
+                                                                          &return_gargument,
+                                                                          length.toInt32());
+                    else
+                        arg_failed = !gjs_value_from_explicit_array(context,
+                                                                    return_values.handleAt(next_rval),
+                                                                    &function->return_info,
+                                                                    &return_gargument,
+                                                                    length.toInt32());
                 }
                 if (!arg_failed &&
                     !r_value &&
                     !gjs_g_argument_release_out_array(context,
                                                       transfer,
-                                                      &return_info,
+                                                      &function->return_info,
                                                       length.toInt32(),
                                                       &return_gargument))
                     failed = true;
@@ -1060,14 +1120,15 @@ gjs_invoke_c_function(JSContext                              *context,
                 if (!js_rval.empty())
                     arg_failed = !gjs_value_from_g_argument(context,
                                                             return_values.handleAt(next_rval),
-                                                            &return_info, &return_gargument,
+                                                            &function->return_info,
+                                                            &return_gargument,
                                                             true);
                 /* Free GArgument, the JS::Value should have ref'd or copied it */
                 if (!arg_failed &&
                     !r_value &&
                     !gjs_g_argument_release(context,
                                             transfer,
-                                            &return_info,
+                                            &function->return_info,
                                             &return_gargument))
                     failed = true;
             }
@@ -1085,16 +1146,9 @@ release:
     c_arg_pos = is_method ? 1 : 0;
     postinvoke_release_failed = false;
     for (gi_arg_pos = 0; gi_arg_pos < gi_argc && c_arg_pos < processed_c_args; gi_arg_pos++, c_arg_pos++) {
-        GIDirection direction;
-        GIArgInfo arg_info;
-        GITypeInfo arg_type_info;
-        GjsParamType param_type;
-
-        g_callable_info_load_arg( (GICallableInfo*) function->info, gi_arg_pos, &arg_info);
-        direction = g_arg_info_get_direction(&arg_info);
-
-        g_arg_info_load_type(&arg_info, &arg_type_info);
-        param_type = function->param_types[gi_arg_pos];
+        GjsArgumentCache *cache = &function->arguments[gi_arg_pos];
+        GIDirection direction = cache->direction;
+        GjsParamType param_type = cache->param_type;
 
         if (direction == GI_DIRECTION_IN || direction == GI_DIRECTION_INOUT) {
             GArgument *arg;
@@ -1102,7 +1156,7 @@ release:
 
             if (direction == GI_DIRECTION_IN) {
                 arg = &in_arg_cvalues[c_arg_pos];
-                transfer = g_arg_info_get_ownership_transfer(&arg_info);
+                transfer = cache->transfer;
             } else {
                 arg = &inout_original_arg_cvalues[c_arg_pos];
                 /* For inout, transfer refers to what we get back from the function; for
@@ -1123,23 +1177,20 @@ release:
                 }
             } else if (param_type == PARAM_ARRAY) {
                 gsize length;
-                GIArgInfo array_length_arg;
-                GITypeInfo array_length_type;
-                gint array_length_pos = g_type_info_get_array_length(&arg_type_info);
+                gint array_length_pos = cache->array_length_pos;
+                GjsArgumentCache *length_cache;
 
                 g_assert(array_length_pos >= 0);
 
-                g_callable_info_load_arg(function->info, array_length_pos, &array_length_arg);
-                g_arg_info_load_type(&array_length_arg, &array_length_type);
-
+                length_cache = &function->arguments[array_length_pos];
                 array_length_pos += is_method ? 1 : 0;
 
                 length = get_length_from_arg(in_arg_cvalues + array_length_pos,
-                                             g_type_info_get_tag(&array_length_type));
+                                             length_cache->type_tag);
 
                 if (!gjs_g_argument_release_in_array(context,
                                                      transfer,
-                                                     &arg_type_info,
+                                                     &cache->type_info,
                                                      length,
                                                      arg)) {
                     postinvoke_release_failed = true;
@@ -1147,7 +1198,7 @@ release:
             } else if (param_type == PARAM_NORMAL) {
                 if (!gjs_g_argument_release_in_arg(context,
                                                    transfer,
-                                                   &arg_type_info,
+                                                   &cache->type_info,
                                                    arg)) {
                     postinvoke_release_failed = true;
                 }
@@ -1166,37 +1217,39 @@ release:
             bool arg_failed = false;
             gint array_length_pos;
             JS::RootedValue array_length(context, JS::Int32Value(0));
-            GITransfer transfer;
 
             g_assert(next_rval < function->js_out_argc);
 
             arg = &out_arg_cvalues[c_arg_pos];
 
-            array_length_pos = g_type_info_get_array_length(&arg_type_info);
+            array_length_pos = cache->array_length_pos;
 
             if (!js_rval.empty()) {
                 if (array_length_pos >= 0) {
-                    GIArgInfo array_length_arg;
-                    GITypeInfo array_length_type_info;
+                    GjsArgumentCache *length_cache = &function->arguments[array_length_pos];
 
-                    g_callable_info_load_arg(function->info, array_length_pos, &array_length_arg);
-                    g_arg_info_load_type(&array_length_arg, &array_length_type_info);
                     array_length_pos += is_method ? 1 : 0;
                     arg_failed = !gjs_value_from_g_argument(context, &array_length,
-                                                            &array_length_type_info,
+                                                            &length_cache->type_info,
                                                             &out_arg_cvalues[array_length_pos],
                                                             true);
-                    if (!arg_failed) {
+                    if (!arg_failed && function->typed_arrays) {
+                        arg_failed = !gjs_typed_array_from_explicit_array(context,
+                                                                          return_values.handleAt(next_rval),
+                                                                          &cache->type_info,
+                                                                          arg,
+                                                                          array_length.toInt32());
+                    } else if (!arg_failed) {
                         arg_failed = !gjs_value_from_explicit_array(context,
                                                                     return_values.handleAt(next_rval),
-                                                                    &arg_type_info,
+                                                                    &cache->type_info,
                                                                     arg,
                                                                     array_length.toInt32());
                     }
                 } else {
                     arg_failed = !gjs_value_from_g_argument(context,
                                                             return_values.handleAt(next_rval),
-                                                            &arg_type_info,
+                                                            &cache->type_info,
                                                             arg,
                                                             true);
                 }
@@ -1206,18 +1259,17 @@ release:
                 postinvoke_release_failed = true;
 
             /* Free GArgument, the JS::Value should have ref'd or copied it */
-            transfer = g_arg_info_get_ownership_transfer(&arg_info);
             if (!arg_failed) {
                 if (array_length_pos >= 0) {
                     gjs_g_argument_release_out_array(context,
-                                                     transfer,
-                                                     &arg_type_info,
+                                                     cache->transfer,
+                                                     &cache->type_info,
                                                      array_length.toInt32(),
                                                      arg);
                 } else {
                     gjs_g_argument_release(context,
-                                           transfer,
-                                           &arg_type_info,
+                                           cache->transfer,
+                                           &cache->type_info,
                                            arg);
                 }
             }
@@ -1231,26 +1283,10 @@ release:
              * this works OK.  We could also alloca() the structure instead
              * of slice allocating.
              */
-            if (g_arg_info_is_caller_allocates(&arg_info)) {
-                GITypeTag type_tag;
-                GIBaseInfo* interface_info;
-                GIInfoType interface_type;
-                gsize size;
-
-                type_tag = g_type_info_get_tag(&arg_type_info);
-                g_assert(type_tag == GI_TYPE_TAG_INTERFACE);
-                interface_info = g_type_info_get_interface(&arg_type_info);
-                interface_type = g_base_info_get_type(interface_info);
-                if (interface_type == GI_INFO_TYPE_STRUCT) {
-                    size = g_struct_info_get_size((GIStructInfo*)interface_info);
-                } else if (interface_type == GI_INFO_TYPE_UNION) {
-                    size = g_union_info_get_size((GIUnionInfo*)interface_info);
-                } else {
-                    g_assert_not_reached();
-                }
-
-                g_slice_free1(size, out_arg_cvalues[c_arg_pos].v_pointer);
-                g_base_info_unref((GIBaseInfo*)interface_info);
+            if (cache->is_caller_allocates) {
+                g_assert(cache->caller_allocates_size > 0);
+                g_slice_free1(cache->caller_allocates_size,
+                              out_arg_cvalues[c_arg_pos].v_pointer);
             }
 
             ++next_rval;
@@ -1297,6 +1333,303 @@ release:
     }
 }
 
+/* Maximum number of arguments for which we install a primitive invoker */
+#define GJS_PRIMITIVE_MAX_ARGS 8
+
+static bool
+type_tag_is_primitive(GITypeTag tag)
+{
+    switch (tag) {
+    case GI_TYPE_TAG_BOOLEAN:
+    case GI_TYPE_TAG_INT8:
+    case GI_TYPE_TAG_UINT8:
+    case GI_TYPE_TAG_INT16:
+    case GI_TYPE_TAG_UINT16:
+    case GI_TYPE_TAG_INT32:
+    case GI_TYPE_TAG_UINT32:
+    case GI_TYPE_TAG_FLOAT:
+    case GI_TYPE_TAG_DOUBLE:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/* Whether @value is known to be valid for the enum or flags type of
+ * @check; if not, it may still be, but only arg.cpp can tell */
+static bool
+enum_value_is_known_valid(const GjsEnumCheck *check,
+                          gint64              value)
+{
+    if (check->is_flags)
+        return value >= 0 && ((guint64) value & ~check->valid) == 0;
+
+    return value >= check->min && value - check->min < 64 &&
+        (check->valid & (G_GUINT64_CONSTANT(1) << (value - check->min))) != 0;
+}
+
+/* Converts @value if it is already a number that fits in the C type (or
+ * anything at all, for booleans, or a known valid value, for enums and
+ * flags.) Returns false otherwise; coercion and error reporting are left
+ * to gjs_value_to_g_argument().
+ */
+static bool
+primitive_arg_from_value(JS::HandleValue         value,
+                         const GjsArgumentCache *cache,
+                         GIArgument             *arg)
+{
+    GITypeTag tag = cache->type_tag;
+    gint32 i;
+    double d;
+
+    if (tag == GI_TYPE_TAG_BOOLEAN) {
+        arg->v_boolean = JS::ToBoolean(value);
+        return true;
+    }
+
+    if (!value.isNumber())
+        return false;
+
+    switch (tag) {
+    case GI_TYPE_TAG_DOUBLE:
+        arg->v_double = value.toNumber();
+        return true;
+    case GI_TYPE_TAG_FLOAT:
+        d = value.toNumber();
+        if (!(d <= G_MAXFLOAT && d >= - G_MAXFLOAT))
+            return false;
+        arg->v_float = (gfloat) d;
+        return true;
+    case GI_TYPE_TAG_UINT32:
+        d = value.toNumber();
+        if (!(d <= G_MAXUINT32 && d >= 0))
+            return false;
+        arg->v_uint32 = (guint32) d;
+        return true;
+    default:
+        break;
+    }
+
+    if (!value.isInt32())
+        return false;
+    i = value.toInt32();
+
+    switch (tag) {
+    case GI_TYPE_TAG_INT8:
+        if (i > G_MAXINT8 || i < G_MININT8)
+            return false;
+        arg->v_int8 = (gint8) i;
+        return true;
+    case GI_TYPE_TAG_UINT8:
+        if (i > G_MAXUINT8 || i < 0)
+            return false;
+        arg->v_uint8 = (guint8) i;
+        return true;
+    case GI_TYPE_TAG_INT16:
+        if (i > G_MAXINT16 || i < G_MININT16)
+            return false;
+        arg->v_int16 = (gint16) i;
+        return true;
+    case GI_TYPE_TAG_UINT16:
+        if (i > G_MAXUINT16 || i < 0)
+            return false;
+        arg->v_uint16 = (guint16) i;
+        return true;
+    case GI_TYPE_TAG_INT32:
+        arg->v_int32 = i;
+        return true;
+    case GI_TYPE_TAG_INTERFACE:
+        /* Stored in v_int whatever the storage type, as in
+         * gjs_value_to_g_argument() */
+        if (!enum_value_is_known_valid(&cache->enum_check, i))
+            return false;
+        arg->v_int = i;
+        return true;
+    default:
+        g_assert_not_reached();
+    }
+}
+
+/* The C function wrote its return value as a full ffi_arg for integer
+ * types, see gi_type_info_extract_ffi_return_value().
+ */
+template<GITypeTag TAG>
+static bool primitive_return_to_value(JSContext             *context,
+                                      Function              *function,
+                                      GIFFIReturnValue      *ret,
+                                      JS::MutableHandleValue rval);
+
+template<> bool
+primitive_return_to_value<GI_TYPE_TAG_VOID>(JSContext             *context,
+                                            Function              *function,
+                                            GIFFIReturnValue      *ret,
+                                            JS::MutableHandleValue rval)
+{
+    rval.setUndefined();
+    return true;
+}
+
+template<> bool
+primitive_return_to_value<GI_TYPE_TAG_BOOLEAN>(JSContext             *context,
+                                               Function              *function,
+                                               GIFFIReturnValue      *ret,
+                                               JS::MutableHandleValue rval)
+{
+    rval.setBoolean(!!(gboolean) ret->v_long);
+    return true;
+}
+
+template<> bool
+primitive_return_to_value<GI_TYPE_TAG_INT8>(JSContext             *context,
+                                            Function              *function,
+                                            GIFFIReturnValue      *ret,
+                                            JS::MutableHandleValue rval)
+{
+    rval.setInt32((gint8) ret->v_long);
+    return true;
+}
+
+template<> bool
+primitive_return_to_value<GI_TYPE_TAG_UINT8>(JSContext             *context,
+                                             Function              *function,
+                                             GIFFIReturnValue      *ret,
+                                             JS::MutableHandleValue rval)
+{
+    rval.setInt32((guint8) ret->v_long);
+    return true;
+}
+
+template<> bool
+primitive_return_to_value<GI_TYPE_TAG_INT16>(JSContext             *context,
+                                             Function              *function,
+                                             GIFFIReturnValue      *ret,
+                                             JS::MutableHandleValue rval)
+{
+    rval.setInt32((gint16) ret->v_long);
+    return true;
+}
+
+template<> bool
+primitive_return_to_value<GI_TYPE_TAG_UINT16>(JSContext             *context,
+                                              Function              *function,
+                                              GIFFIReturnValue      *ret,
+                                              JS::MutableHandleValue rval)
+{
+    rval.setInt32((guint16) ret->v_long);
+    return true;
+}
+
+template<> bool
+primitive_return_to_value<GI_TYPE_TAG_INT32>(JSContext             *context,
+                                             Function              *function,
+                                             GIFFIReturnValue      *ret,
+                                             JS::MutableHandleValue rval)
+{
+    rval.setInt32((gint32) ret->v_long);
+    return true;
+}
+
+template<> bool
+primitive_return_to_value<GI_TYPE_TAG_UINT32>(JSContext             *context,
+                                              Function              *function,
+                                              GIFFIReturnValue      *ret,
+                                              JS::MutableHandleValue rval)
+{
+    rval.setNumber((guint32) ret->v_long);
+    return true;
+}
+
+template<> bool
+primitive_return_to_value<GI_TYPE_TAG_FLOAT>(JSContext             *context,
+                                             Function              *function,
+                                             GIFFIReturnValue      *ret,
+                                             JS::MutableHandleValue rval)
+{
+    rval.setNumber(ret->v_float);
+    return true;
+}
+
+template<> bool
+primitive_return_to_value<GI_TYPE_TAG_DOUBLE>(JSContext             *context,
+                                              Function              *function,
+                                              GIFFIReturnValue      *ret,
+                                              JS::MutableHandleValue rval)
+{
+    rval.setNumber(ret->v_double);
+    return true;
+}
+
+/* Enums and flags come back in 32 bits, see
+ * gi_type_info_extract_ffi_return_value() */
+template<> bool
+primitive_return_to_value<GI_TYPE_TAG_INTERFACE>(JSContext             *context,
+                                                 Function              *function,
+                                                 GIFFIReturnValue      *ret,
+                                                 JS::MutableHandleValue rval)
+{
+    gint32 v = (gint32) ret->v_long;
+    gint64 value = function->return_enum_check.is_signed ? v : (guint32) v;
+    GIArgument arg;
+
+    if (enum_value_is_known_valid(&function->return_enum_check, value)) {
+        rval.setNumber((double) value);
+        return true;
+    }
+
+    /* Let arg.cpp check the value, and throw if it is invalid */
+    arg.v_int = v;
+    return gjs_value_from_g_argument(context, rval, &function->return_info,
+                                     &arg, true);
+}
+
+/* Calls a function whose arguments are all (in) numbers or booleans,
+ * optionally on a GObject instance, converting the JS values straight
+ * into the storage handed to ffi_call(). There are no out arguments,
+ * nothing to release, and a single return value, so none of the
+ * bookkeeping in gjs_invoke_c_function() is needed.
+ */
+template<GITypeTag RETURN_TAG>
+static bool
+invoke_primitive_c_function(JSContext          *context,
+                            Function           *function,
+                            JS::HandleObject    obj,
+                            const JS::CallArgs& argv,
+                            bool               *ret_p)
+{
+    GIArgument in_arg_cvalues[GJS_PRIMITIVE_MAX_ARGS + 1];
+    gpointer ffi_arg_pointers[GJS_PRIMITIVE_MAX_ARGS + 1];
+    GIFFIReturnValue return_value;
+    guint8 gi_arg_pos, c_arg_pos = 0;
+
+    if (argv.length() < function->expected_js_argc)
+        return false;
+
+    if (function->is_method) {
+        if (!gjs_typecheck_object(context, obj, function->instance_gtype, false))
+            return false;
+        in_arg_cvalues[0].v_pointer = gjs_g_object_from_object(context, obj);
+        ffi_arg_pointers[0] = &in_arg_cvalues[0];
+        c_arg_pos++;
+    }
+
+    for (gi_arg_pos = 0; gi_arg_pos < function->n_args; gi_arg_pos++, c_arg_pos++) {
+        if (!primitive_arg_from_value(argv[gi_arg_pos],
+                                      &function->arguments[gi_arg_pos],
+                                      &in_arg_cvalues[c_arg_pos]))
+            return false;
+        ffi_arg_pointers[c_arg_pos] = &in_arg_cvalues[c_arg_pos];
+    }
+
+    free_completed_trampolines();
+
+    ffi_call(&(function->invoker.cif), FFI_FN(function->invoker.native_address),
+             &return_value, ffi_arg_pointers);
+
+    *ret_p = primitive_return_to_value<RETURN_TAG>(context, function,
+                                                   &return_value, argv.rval());
+    return true;
+}
+
 static bool
 function_call(JSContext *context,
               unsigned   js_argc,
@@ -1318,6 +1651,10 @@ function_call(JSContext *context,
     if (priv == NULL)
         return true; /* we are the prototype, or have the wrong class */
 
+    if (priv->primitive_invoker &&
+        priv->primitive_invoker(context, priv, object, js_argv, &success))
+        return success;
+
     /* COMPAT: mozilla::Maybe gains a much more usable API in future versions */
     mozilla::Maybe<JS::MutableHandleValue> m_retval;
     m_retval.construct(&retval);
@@ -1339,8 +1676,8 @@ uninit_cached_function_data (Function *function)
 {
     if (function->info)
         g_base_info_unref( (GIBaseInfo*) function->info);
-    if (function->param_types)
-        g_free(function->param_types);
+    if (function->arguments)
+        g_free(function->arguments);
 
     g_function_invoker_destroy(&function->invoker);
 }
@@ -1374,17 +1711,13 @@ get_num_arguments (JSContext *context,
     if (priv == NULL)
         return false;
 
-    n_args = g_callable_info_get_n_args(priv->info);
+    n_args = priv->n_args;
     n_jsargs = 0;
     for (i = 0; i < n_args; i++) {
-        GIArgInfo arg_info;
-
-        if (priv->param_types[i] == PARAM_SKIPPED)
+        if (priv->arguments[i].param_type == PARAM_SKIPPED)
             continue;
 
-        g_callable_info_load_arg(priv->info, i, &arg_info);
-
-        if (g_arg_info_get_direction(&arg_info) == GI_DIRECTION_OUT)
+        if (priv->arguments[i].direction == GI_DIRECTION_OUT)
             continue;
     }
 
@@ -1392,6 +1725,36 @@ get_num_arguments (JSContext *context,
     return true;
 }
 
+static bool
+get_typed_arrays(JSContext *context,
+                 unsigned   argc,
+                 JS::Value *vp)
+{
+    GJS_GET_PRIV(context, argc, vp, args, to, Function, priv);
+
+    args.rval().setBoolean(priv != NULL && priv->typed_arrays);
+    return true;
+}
+
+/* Opt-in, since typed arrays don't have all the methods of arrays: when
+ * set, arrays of 8, 16 and 32 bit integers, floats and doubles that come
+ * out of this function with an explicit length are copied into typed
+ * arrays in one go, instead of converting each element. */
+static bool
+set_typed_arrays(JSContext *context,
+                 unsigned   argc,
+                 JS::Value *vp)
+{
+    GJS_GET_PRIV(context, argc, vp, args, to, Function, priv);
+
+    if (priv == NULL)
+        return true; /* prototype, not instance */
+
+    priv->typed_arrays = JS::ToBoolean(args[0]);
+    args.rval().setUndefined();
+    return true;
+}
+
 static bool
 function_to_string (JSContext *context,
                     guint      argc,
@@ -1413,25 +1776,23 @@ function_to_string (JSContext *context,
 
     free = true;
 
-    n_args = g_callable_info_get_n_args(priv->info);
+    n_args = priv->n_args;
     n_jsargs = 0;
     arg_names_str = g_string_new("");
     for (i = 0; i < n_args; i++) {
-        GIArgInfo arg_info;
+        GjsArgumentCache *cache = &priv->arguments[i];
 
-        if (priv->param_types[i] == PARAM_SKIPPED)
+        if (cache->param_type == PARAM_SKIPPED)
             continue;
 
-        g_callable_info_load_arg(priv->info, i, &arg_info);
-
-        if (g_arg_info_get_direction(&arg_info) == GI_DIRECTION_OUT)
+        if (cache->direction == GI_DIRECTION_OUT)
             continue;
 
         if (n_jsargs > 0)
             g_string_append(arg_names_str, ", ");
 
         n_jsargs++;
-        g_string_append(arg_names_str, g_base_info_get_name(&arg_info));
+        g_string_append(arg_names_str, cache->name);
     }
     arg_names = g_string_free(arg_names_str, false);
 
@@ -1478,6 +1839,7 @@ struct JSClass gjs_function_class = {
 
 JSPropertySpec gjs_function_proto_props[] = {
     JS_PSG("length", get_num_arguments, JSPROP_PERMANENT),
+    JS_PSGS("typedArrays", get_typed_arrays, set_typed_arrays, JSPROP_PERMANENT),
     JS_PS_END
 };
 
@@ -1488,6 +1850,238 @@ JSFunctionSpec gjs_function_proto_funcs[] = {
     JS_FS_END
 };
 
+/* Loads everything about @function's arguments that doesn't depend on
+ * the values passed in, so that gjs_invoke_c_function() can work from
+ * the cache instead of querying the typelib on each call.
+ */
+static void
+init_argument_cache(Function       *function,
+                    GICallableInfo *info)
+{
+    guint8 i;
+
+    function->is_method = g_callable_info_is_method(info);
+    function->can_throw_gerror = g_callable_info_can_throw_gerror(info);
+
+    g_callable_info_load_return_type(info, &function->return_info);
+    function->return_tag = g_type_info_get_tag(&function->return_info);
+    function->return_transfer = g_callable_info_get_caller_owns(info);
+    function->return_array_length_pos = g_type_info_get_array_length(&function->return_info);
+
+    function->n_args = g_callable_info_get_n_args(info);
+    function->arguments = g_new0(GjsArgumentCache, function->n_args);
+
+    for (i = 0; i < function->n_args; i++) {
+        GjsArgumentCache *cache = &function->arguments[i];
+
+        g_callable_info_load_arg(info, i, &cache->arg_info);
+        g_arg_info_load_type(&cache->arg_info, &cache->type_info);
+
+        cache->name = g_base_info_get_name((GIBaseInfo *) &cache->arg_info);
+        cache->param_type = PARAM_NORMAL;
+        cache->direction = g_arg_info_get_direction(&cache->arg_info);
+        cache->type_tag = g_type_info_get_tag(&cache->type_info);
+        cache->transfer = g_arg_info_get_ownership_transfer(&cache->arg_info);
+        cache->arg_type = g_arg_info_is_return_value(&cache->arg_info) ?
+            GJS_ARGUMENT_RETURN_VALUE : GJS_ARGUMENT_ARGUMENT;
+        cache->scope = g_arg_info_get_scope(&cache->arg_info);
+        cache->may_be_null = g_arg_info_may_be_null(&cache->arg_info);
+        cache->array_length_pos = g_type_info_get_array_length(&cache->type_info);
+        cache->destroy_pos = g_arg_info_get_destroy(&cache->arg_info);
+        cache->closure_pos = g_arg_info_get_closure(&cache->arg_info);
+
+        if (cache->direction == GI_DIRECTION_OUT &&
+            g_arg_info_is_caller_allocates(&cache->arg_info)) {
+            cache->is_caller_allocates = true;
+
+            if (cache->type_tag == GI_TYPE_TAG_INTERFACE) {
+                GIBaseInfo *interface_info;
+                GIInfoType interface_type;
+
+                interface_info = g_type_info_get_interface(&cache->type_info);
+                g_assert(interface_info != NULL);
+
+                interface_type = g_base_info_get_type(interface_info);
+
+                if (interface_type == GI_INFO_TYPE_STRUCT)
+                    cache->caller_allocates_size = g_struct_info_get_size((GIStructInfo*)interface_info);
+                else if (interface_type == GI_INFO_TYPE_UNION)
+                    cache->caller_allocates_size = g_union_info_get_size((GIUnionInfo*)interface_info);
+
+                g_base_info_unref(interface_info);
+            }
+        }
+    }
+}
+
+/* Primitive invokers pass enums and flags as their storage type, like
+ * gjs_array_to_array() does for their arrays, and only look at their
+ * values to tell the valid ones. Returns false if @type_info is not an
+ * enum or flags type, or if it is an enum with values too far apart to be
+ * told with a 64-bit mask.
+ */
+static bool
+init_enum_check(GITypeInfo   *type_info,
+                GjsEnumCheck *check)
+{
+    GIBaseInfo *interface_info;
+    GIInfoType interface_type;
+    GITypeTag storage;
+    bool ret = false;
+    int i, n_values;
+    gint64 *values;
+
+    interface_info = g_type_info_get_interface(type_info);
+    interface_type = g_base_info_get_type(interface_info);
+
+    if (interface_type != GI_INFO_TYPE_ENUM &&
+        interface_type != GI_INFO_TYPE_FLAGS)
+        goto out;
+
+    storage = g_enum_info_get_storage_type((GIEnumInfo *) interface_info);
+    check->is_signed = (storage == GI_TYPE_TAG_INT8 ||
+                        storage == GI_TYPE_TAG_INT16 ||
+                        storage == GI_TYPE_TAG_INT32 ||
+                        storage == GI_TYPE_TAG_INT64);
+    check->is_flags = interface_type == GI_INFO_TYPE_FLAGS;
+    check->min = 0;
+    check->valid = 0;
+
+    if (check->is_flags) {
+        GType gtype;
+        GFlagsClass *klass;
+        guint j;
+
+        /* Same as _gjs_flags_value_is_valid(): every bit that a single-bit
+         * value defines is valid on its own */
+        gtype = g_registered_type_info_get_g_type((GIRegisteredTypeInfo *) interface_info);
+        if (gtype == G_TYPE_NONE) {
+            check->valid = G_MAXUINT32;
+        } else {
+            klass = (GFlagsClass *) g_type_class_ref(gtype);
+            for (j = 0; j < klass->n_values; j++) {
+                guint value = klass->values[j].value;
+                if (value != 0 && (value & (value - 1)) == 0)
+                    check->valid |= value;
+            }
+            g_type_class_unref(klass);
+        }
+        ret = true;
+        goto out;
+    }
+
+    n_values = g_enum_info_get_n_values((GIEnumInfo *) interface_info);
+    if (n_values == 0)
+        goto out;
+
+    values = g_newa(gint64, n_values);
+    for (i = 0; i < n_values; i++) {
+        GIValueInfo *value_info;
+
+        value_info = g_enum_info_get_value((GIEnumInfo *) interface_info, i);
+        values[i] = g_value_info_get_value(value_info);
+        g_base_info_unref((GIBaseInfo *) value_info);
+
+        if (i == 0 || values[i] < check->min)
+            check->min = values[i];
+    }
+
+    for (i = 0; i < n_values; i++) {
+        if (values[i] - check->min >= 64)
+            goto out;
+        check->valid |= G_GUINT64_CONSTANT(1) << (values[i] - check->min);
+    }
+    ret = true;
+
+ out:
+    g_base_info_unref(interface_info);
+    return ret;
+}
+
+/* Installs a specialized invoker if @function only takes and returns
+ * numbers, booleans, enums and flags, and is either a plain function or a
+ * method on a GObject. Must run after the argument cache is complete.
+ */
+static void
+init_primitive_invoker(Function       *function,
+                       GICallableInfo *info)
+{
+    guint8 i;
+
+    if (function->can_throw_gerror ||
+        function->n_args > GJS_PRIMITIVE_MAX_ARGS)
+        return;
+
+    if (function->is_method) {
+        GIBaseInfo *container = g_base_info_get_container((GIBaseInfo *) info);
+        GType gtype;
+
+        if (g_base_info_get_type(container) != GI_INFO_TYPE_OBJECT ||
+            g_callable_info_get_instance_ownership_transfer(info) != GI_TRANSFER_NOTHING)
+            return;
+
+        gtype = g_registered_type_info_get_g_type((GIRegisteredTypeInfo *) container);
+        if (!g_type_is_a(gtype, G_TYPE_OBJECT))
+            return;
+
+        function->instance_gtype = gtype;
+    }
+
+    for (i = 0; i < function->n_args; i++) {
+        GjsArgumentCache *cache = &function->arguments[i];
+
+        if (cache->direction != GI_DIRECTION_IN ||
+            cache->param_type != PARAM_NORMAL)
+            return;
+
+        if (cache->type_tag == GI_TYPE_TAG_INTERFACE) {
+            if (!init_enum_check(&cache->type_info, &cache->enum_check))
+                return;
+        } else if (!type_tag_is_primitive(cache->type_tag)) {
+            return;
+        }
+    }
+
+    switch (function->return_tag) {
+    case GI_TYPE_TAG_VOID:
+        function->primitive_invoker = invoke_primitive_c_function<GI_TYPE_TAG_VOID>;
+        break;
+    case GI_TYPE_TAG_BOOLEAN:
+        function->primitive_invoker = invoke_primitive_c_function<GI_TYPE_TAG_BOOLEAN>;
+        break;
+    case GI_TYPE_TAG_INT8:
+        function->primitive_invoker = invoke_primitive_c_function<GI_TYPE_TAG_INT8>;
+        break;
+    case GI_TYPE_TAG_UINT8:
+        function->primitive_invoker = invoke_primitive_c_function<GI_TYPE_TAG_UINT8>;
+        break;
+    case GI_TYPE_TAG_INT16:
+        function->primitive_invoker = invoke_primitive_c_function<GI_TYPE_TAG_INT16>;
+        break;
+    case GI_TYPE_TAG_UINT16:
+        function->primitive_invoker = invoke_primitive_c_function<GI_TYPE_TAG_UINT16>;
+        break;
+    case GI_TYPE_TAG_INT32:
+        function->primitive_invoker = invoke_primitive_c_function<GI_TYPE_TAG_INT32>;
+        break;
+    case GI_TYPE_TAG_UINT32:
+        function->primitive_invoker = invoke_primitive_c_function<GI_TYPE_TAG_UINT32>;
+        break;
+    case GI_TYPE_TAG_FLOAT:
+        function->primitive_invoker = invoke_primitive_c_function<GI_TYPE_TAG_FLOAT>;
+        break;
+    case GI_TYPE_TAG_DOUBLE:
+        function->primitive_invoker = invoke_primitive_c_function<GI_TYPE_TAG_DOUBLE>;
+        break;
+    case GI_TYPE_TAG_INTERFACE:
+        if (init_enum_check(&function->return_info, &function->return_enum_check))
+            function->primitive_invoker = invoke_primitive_c_function<GI_TYPE_TAG_INTERFACE>;
+        break;
+    default:
+        break;
+    }
+}
+
 static bool
 init_cached_function_data (JSContext      *context,
                            Function       *function,
@@ -1497,7 +2091,6 @@ init_cached_function_data (JSContext      *context,
     guint8 i, n_args;
     int array_length_pos;
     GError *error = NULL;
-    GITypeInfo return_type;
     GIInfoType info_type;
 
     info_type = g_base_info_get_type((GIBaseInfo *)info);
@@ -1529,57 +2122,53 @@ init_cached_function_data (JSContext      *context,
         }
     }
 
-    g_callable_info_load_return_type((GICallableInfo*)info, &return_type);
-    if (g_type_info_get_tag(&return_type) != GI_TYPE_TAG_VOID)
+    init_argument_cache(function, info);
+
+    if (function->return_tag != GI_TYPE_TAG_VOID)
         function->js_out_argc += 1;
 
-    n_args = g_callable_info_get_n_args((GICallableInfo*) info);
-    function->param_types = g_new0(GjsParamType, n_args);
+    n_args = function->n_args;
 
-    array_length_pos = g_type_info_get_array_length(&return_type);
+    array_length_pos = function->return_array_length_pos;
     if (array_length_pos >= 0 && array_length_pos < n_args)
-        function->param_types[array_length_pos] = PARAM_SKIPPED;
+        function->arguments[array_length_pos].param_type = PARAM_SKIPPED;
 
     for (i = 0; i < n_args; i++) {
+        GjsArgumentCache *cache = &function->arguments[i];
         GIDirection direction;
-        GIArgInfo arg_info;
-        GITypeInfo type_info;
         int destroy = -1;
         int closure = -1;
         GITypeTag type_tag;
 
-        if (function->param_types[i] == PARAM_SKIPPED)
+        if (cache->param_type == PARAM_SKIPPED)
             continue;
 
-        g_callable_info_load_arg((GICallableInfo*) info, i, &arg_info);
-        g_arg_info_load_type(&arg_info, &type_info);
-
-        direction = g_arg_info_get_direction(&arg_info);
-        type_tag = g_type_info_get_tag(&type_info);
+        direction = cache->direction;
+        type_tag = cache->type_tag;
 
         if (type_tag == GI_TYPE_TAG_INTERFACE) {
             GIBaseInfo* interface_info;
             GIInfoType interface_type;
 
-            interface_info = g_type_info_get_interface(&type_info);
+            interface_info = g_type_info_get_interface(&cache->type_info);
             interface_type = g_base_info_get_type(interface_info);
             if (interface_type == GI_INFO_TYPE_CALLBACK) {
                 if (strcmp(g_base_info_get_name(interface_info), "DestroyNotify") == 0 &&
                     strcmp(g_base_info_get_namespace(interface_info), "GLib") == 0) {
                     /* Skip GDestroyNotify if they appear before the respective callback */
-                    function->param_types[i] = PARAM_SKIPPED;
+                    cache->param_type = PARAM_SKIPPED;
                 } else {
-                    function->param_types[i] = PARAM_CALLBACK;
+                    cache->param_type = PARAM_CALLBACK;
                     function->expected_js_argc += 1;
 
-                    destroy = g_arg_info_get_destroy(&arg_info);
-                    closure = g_arg_info_get_closure(&arg_info);
+                    destroy = cache->destroy_pos;
+                    closure = cache->closure_pos;
 
                     if (destroy >= 0 && destroy < n_args)
-                        function->param_types[destroy] = PARAM_SKIPPED;
+                        function->arguments[destroy].param_type = PARAM_SKIPPED;
 
                     if (closure >= 0 && closure < n_args)
-                        function->param_types[closure] = PARAM_SKIPPED;
+                        function->arguments[closure].param_type = PARAM_SKIPPED;
 
                     if (destroy >= 0 && closure < 0) {
                         gjs_throw(context, "Function %s.%s has a GDestroyNotify but no user_data, not supported",
@@ -1592,22 +2181,19 @@ init_cached_function_data (JSContext      *context,
             }
             g_base_info_unref(interface_info);
         } else if (type_tag == GI_TYPE_TAG_ARRAY) {
-            if (g_type_info_get_array_type(&type_info) == GI_ARRAY_TYPE_C) {
-                array_length_pos = g_type_info_get_array_length(&type_info);
+            if (g_type_info_get_array_type(&cache->type_info) == GI_ARRAY_TYPE_C) {
+                array_length_pos = cache->array_length_pos;
 
                 if (array_length_pos >= 0 && array_length_pos < n_args) {
-                    GIArgInfo length_arg_info;
-
-                    g_callable_info_load_arg((GICallableInfo*) info, array_length_pos, &length_arg_info);
-                    if (g_arg_info_get_direction(&length_arg_info) != direction) {
+                    if (function->arguments[array_length_pos].direction != direction) {
                         gjs_throw(context, "Function %s.%s has an array with different-direction length arg, not supported",
                                   g_base_info_get_namespace( (GIBaseInfo*) info),
                                   g_base_info_get_name( (GIBaseInfo*) info));
                         return false;
                     }
 
-                    function->param_types[array_length_pos] = PARAM_SKIPPED;
-                    function->param_types[i] = PARAM_ARRAY;
+                    function->arguments[array_length_pos].param_type = PARAM_SKIPPED;
+                    cache->param_type = PARAM_ARRAY;
 
                     if (array_length_pos < i) {
                         /* we already collected array_length_pos, remove it */
@@ -1620,8 +2206,8 @@ init_cached_function_data (JSContext      *context,
             }
         }
 
-        if (function->param_types[i] == PARAM_NORMAL ||
-            function->param_types[i] == PARAM_ARRAY) {
+        if (cache->param_type == PARAM_NORMAL ||
+            cache->param_type == PARAM_ARRAY) {
             if (direction == GI_DIRECTION_IN || direction == GI_DIRECTION_INOUT)
                 function->expected_js_argc += 1;
             if (direction == GI_DIRECTION_OUT || direction == GI_DIRECTION_INOUT)
@@ -1629,6 +2215,8 @@ init_cached_function_data (JSContext      *context,
         }
     }
 
+    init_primitive_invoker(function, info);
+
     function->info = info;
 
     g_base_info_ref((GIBaseInfo*) function->info);
@@ -537,7 +537,7 @@ fundamental_trace(JSTracer *tracer,
  */
 struct JSClass gjs_fundamental_instance_class = {
     "GFundamental_Object",
-    JSCLASS_HAS_PRIVATE |
+    JSCLASS_HAS_PRIVATE | JSCLASS_IMPLEMENTS_BARRIERS |
     JSCLASS_NEW_RESOLVE,
     JS_PropertyStub,
     JS_DeletePropertyStub,
@@ -735,8 +735,12 @@ gjs_object_from_g_fundamental(JSContext    *context,
         return NULL;
 
     JS::RootedObject object(context, _fundamental_lookup_object(gfundamental));
-    if (object)
+    if (object) {
+        /* The table entry is weak; read-barrier it before handing it out
+         * in case an incremental GC is in progress. */
+        JS::ExposeObjectToActiveJS(object);
         return object;
+    }
 
     gjs_debug_marshal(GJS_DEBUG_GFUNDAMENTAL,
                       "Wrapping fundamental %s.%s %p with JSObject",
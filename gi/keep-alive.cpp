@@ -27,16 +27,21 @@
 #include "keep-alive.h"
 
 #include <util/log.h>
-#include <util/glib.h>
 
 typedef struct {
-    GjsUnrootedFunc notify;
     JSObject *child;
+    GjsUnrootedFunc notify;
     void *data;
+    guint *index_p;
 } Child;
 
+/* Children are stored densely, so that tracing is a linear walk over the
+ * array. Each child's owner provides the location where its index in the
+ * array is stored, which gives O(1) removal: the last child is moved into
+ * the removed child's slot, and its index updated.
+ */
 typedef struct {
-    GHashTable *children;
+    GArray *children;
     unsigned int inside_finalize : 1;
     unsigned int inside_trace : 1;
 } KeepAlive;
@@ -45,35 +50,19 @@ extern struct JSClass gjs_keep_alive_class;
 
 GJS_DEFINE_PRIV_FROM_JS(KeepAlive, gjs_keep_alive_class)
 
-static guint
-child_hash(gconstpointer  v)
+static inline Child *
+child_at(KeepAlive *priv,
+         guint      index)
 {
-    const Child *child = (const Child *) v;
-
-    return
-        GPOINTER_TO_UINT(child->notify) ^
-        GPOINTER_TO_UINT(child->child) ^
-        GPOINTER_TO_UINT(child->data);
+    return &g_array_index(priv->children, Child, index);
 }
 
-static gboolean
-child_equal (gconstpointer  v1,
-             gconstpointer  v2)
-{
-    const Child *child1 = (const Child *) v1;
-    const Child *child2 = (const Child *) v2;
-
-    /* notify is most likely to be equal, so check it last */
-    return child1->data == child2->data &&
-        child1->child == child2->child &&
-        child1->notify == child2->notify;
-}
-
-static void
-child_free(void *data)
+static bool
+child_is_at_index(KeepAlive *priv,
+                  guint     *index_p)
 {
-    Child *child = (Child *) data;
-    g_slice_free(Child, child);
+    return *index_p < priv->children->len &&
+        child_at(priv, *index_p)->index_p == index_p;
 }
 
 GJS_NATIVE_CONSTRUCTOR_DEFINE_ABSTRACT(keep_alive)
@@ -83,8 +72,6 @@ keep_alive_finalize(JSFreeOp *fop,
                     JSObject *obj)
 {
     KeepAlive *priv;
-    void *key;
-    void *value;
 
     priv = (KeepAlive *) JS_GetPrivate(obj);
 
@@ -96,39 +83,25 @@ keep_alive_finalize(JSFreeOp *fop,
 
     priv->inside_finalize = true;
 
-    while (gjs_g_hash_table_steal_one(priv->children,
-                                      &key, &value)) {
-        Child *child = (Child *) value;
-        if (child->notify)
-            (* child->notify) (child->child, child->data);
+    while (priv->children->len > 0) {
+        Child child = *child_at(priv, priv->children->len - 1);
 
-        child_free(child);
+        g_array_set_size(priv->children, priv->children->len - 1);
+        if (child.notify)
+            (* child.notify) (child.child, child.data);
     }
 
-    g_hash_table_destroy(priv->children);
+    g_array_free(priv->children, true);
     g_slice_free(KeepAlive, priv);
 }
 
-static void
-trace_foreach(void *key,
-              void *value,
-              void *data)
-{
-    Child *child = (Child *) value;
-    JSTracer *tracer = (JSTracer *) data;
-
-    if (child->child != NULL) {
-        JS::Value val;
-        val = JS::ObjectValue(*(child->child));
-        JS_CallValueTracer(tracer, &val, "keep-alive::val");
-    }
-}
-
 static void
 keep_alive_trace(JSTracer *tracer,
                  JSObject *obj)
 {
     KeepAlive *priv;
+    Child *children;
+    guint i, n_children;
 
     priv = (KeepAlive *) JS_GetPrivate(obj);
 
@@ -137,7 +110,16 @@ keep_alive_trace(JSTracer *tracer,
 
     g_assert(!priv->inside_trace);
     priv->inside_trace = true;
-    g_hash_table_foreach(priv->children, trace_foreach, tracer);
+
+    children = child_at(priv, 0);
+    n_children = priv->children->len;
+    for (i = 0; i < n_children; i++) {
+        if (children[i].child != NULL) {
+            JS::Value val = JS::ObjectValue(*children[i].child);
+            JS_CallValueTracer(tracer, &val, "keep-alive::val");
+        }
+    }
+
     priv->inside_trace = false;
 }
 
@@ -147,7 +129,7 @@ keep_alive_trace(JSTracer *tracer,
  */
 struct JSClass gjs_keep_alive_class = {
     "__private_GjsKeepAlive", /* means "new __private_GjsKeepAlive()" works */
-    JSCLASS_HAS_PRIVATE,
+    JSCLASS_HAS_PRIVATE | JSCLASS_IMPLEMENTS_BARRIERS,
     JS_PropertyStub,
     JS_DeletePropertyStub,
     JS_PropertyStub,
@@ -241,7 +223,7 @@ gjs_keep_alive_new(JSContext *context)
     }
 
     priv = g_slice_new0(KeepAlive);
-    priv->children = g_hash_table_new_full(child_hash, child_equal, NULL, child_free);
+    priv->children = g_array_new(false, false, sizeof(Child));
 
     g_assert(priv_from_js(context, keep_alive) == NULL);
     JS_SetPrivate(keep_alive, priv);
@@ -257,53 +239,74 @@ void
 gjs_keep_alive_add_child(JSObject          *keep_alive,
                          GjsUnrootedFunc    notify,
                          JSObject          *obj,
-                         void              *data)
+                         void              *data,
+                         guint             *index_p)
 {
     KeepAlive *priv;
-    Child *child;
+    Child child;
 
     g_assert(keep_alive != NULL);
+    g_assert(index_p != NULL);
     priv = (KeepAlive *) JS_GetPrivate(keep_alive);
     g_assert(priv != NULL);
 
     g_return_if_fail(!priv->inside_trace);
     g_return_if_fail(!priv->inside_finalize);
+    g_return_if_fail(!child_is_at_index(priv, index_p));
 
-    child = g_slice_new0(Child);
-    child->notify = notify;
-    child->child = obj;
-    child->data = data;
+    /* obj may have been reachable only weakly so far; make sure an
+     * incremental GC in progress doesn't collect it now that we hold it */
+    if (obj != NULL)
+        JS::ExposeObjectToActiveJS(obj);
 
-    /* this is sort of an expensive check, probably */
-    g_return_if_fail(g_hash_table_lookup(priv->children, child) == NULL);
+    child.child = obj;
+    child.notify = notify;
+    child.data = data;
+    child.index_p = index_p;
 
-    /* this overwrites any identical-by-value previous child,
-     * but there should not be one.
-     */
-    g_hash_table_replace(priv->children, child, child);
+    *index_p = priv->children->len;
+    g_array_append_val(priv->children, child);
 }
 
 void
 gjs_keep_alive_remove_child(JSObject          *keep_alive,
                             GjsUnrootedFunc    notify,
                             JSObject          *obj,
-                            void              *data)
+                            void              *data,
+                            guint             *index_p)
 {
     KeepAlive *priv;
-    Child child;
+    Child *child;
+    guint index;
 
     g_assert(keep_alive != NULL);
+    g_assert(index_p != NULL);
     priv = (KeepAlive *) JS_GetPrivate(keep_alive);
     g_assert(priv != NULL);
 
     g_return_if_fail(!priv->inside_trace);
     g_return_if_fail(!priv->inside_finalize);
 
-    child.notify = notify;
-    child.child = obj;
-    child.data = data;
+    if (!child_is_at_index(priv, index_p))
+        return;
+
+    index = *index_p;
+    child = child_at(priv, index);
+    g_return_if_fail(child->child == obj &&
+                     child->notify == notify &&
+                     child->data == data);
 
-    g_hash_table_remove(priv->children, &child);
+    /* Pre-barrier for an incremental GC in progress, since the edge we
+     * are removing may have been the one keeping obj reachable */
+    if (obj != NULL &&
+        JS::IsIncrementalBarrierNeeded(JS_GetObjectRuntime(keep_alive)))
+        JS::IncrementalObjectBarrier(obj);
+
+    g_array_remove_index_fast(priv->children, index);
+
+    /* The last child, if any, was moved into the freed slot */
+    if (index < priv->children->len)
+        *child_at(priv, index)->index_p = index;
 }
 
 static JSObject*
@@ -351,7 +354,8 @@ void
 gjs_keep_alive_add_global_child(JSContext         *context,
                                 GjsUnrootedFunc  notify,
                                 JSObject          *child,
-                                void              *data)
+                                void              *data,
+                                guint             *index_p)
 {
     JSObject *keep_alive;
 
@@ -359,7 +363,7 @@ gjs_keep_alive_add_global_child(JSContext         *context,
 
     keep_alive = gjs_keep_alive_get_global(context);
 
-    gjs_keep_alive_add_child(keep_alive, notify, child, data);
+    gjs_keep_alive_add_child(keep_alive, notify, child, data, index_p);
 
     JS_EndRequest(context);
 }
@@ -368,7 +372,8 @@ void
 gjs_keep_alive_remove_global_child(JSContext         *context,
                                    GjsUnrootedFunc  notify,
                                    JSObject          *child,
-                                   void              *data)
+                                   void              *data,
+                                   guint             *index_p)
 {
     JSObject *keep_alive;
 
@@ -380,15 +385,18 @@ gjs_keep_alive_remove_global_child(JSContext         *context,
         g_error("no keep_alive property on the global object, have you "
                 "previously added this child?");
 
-    gjs_keep_alive_remove_child(keep_alive, notify, child, data);
+    gjs_keep_alive_remove_child(keep_alive, notify, child, data, index_p);
 
     JS_EndRequest(context);
 }
 
 typedef struct {
-    GHashTableIter hashiter;
+    KeepAlive *priv;
+    guint index;
 } GjsRealKeepAliveIter;
 
+G_STATIC_ASSERT(sizeof(GjsRealKeepAliveIter) <= sizeof(GjsKeepAliveIter));
+
 void
 gjs_keep_alive_iterator_init (GjsKeepAliveIter *iter,
                               JSObject         *keep_alive)
@@ -396,7 +404,8 @@ gjs_keep_alive_iterator_init (GjsKeepAliveIter *iter,
     GjsRealKeepAliveIter *real = (GjsRealKeepAliveIter*)iter;
     KeepAlive *priv = (KeepAlive *) JS_GetPrivate(keep_alive);
     g_assert(priv != NULL);
-    g_hash_table_iter_init(&real->hashiter, priv->children);
+    real->priv = priv;
+    real->index = 0;
 }
 
 bool
@@ -406,20 +415,17 @@ gjs_keep_alive_iterator_next (GjsKeepAliveIter  *iter,
                               void             **out_data)
 {
     GjsRealKeepAliveIter *real = (GjsRealKeepAliveIter*)iter;
-    gpointer k, v;
-    bool ret = false;
 
-    while (g_hash_table_iter_next(&real->hashiter, &k, &v)) {
-        Child *child = (Child*)k;
+    while (real->index < real->priv->children->len) {
+        Child *child = child_at(real->priv, real->index++);
 
         if (child->notify != notify_func)
             continue;
 
-        ret = true;
         *out_child = child->child;
         *out_data = child->data;
-        break;
+        return true;
     }
 
-    return ret;
+    return false;
 }
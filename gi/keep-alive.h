@@ -48,6 +48,10 @@ G_BEGIN_DECLS
  * All three fields (notify, child, and data) are optional, so you can have
  * no JSObject - just notification+data - and you can have no notifier,
  * only the keep-alive capability.
+ *
+ * The owner of each child provides storage for an index (index_p), which
+ * the keep alive keeps up to date while the child is in it, and which must
+ * be passed again to remove the child.
  */
 
 typedef void (* GjsUnrootedFunc) (JSObject *obj,
@@ -57,21 +61,25 @@ typedef void (* GjsUnrootedFunc) (JSObject *obj,
 void      gjs_keep_alive_add_child                 (JSObject          *keep_alive,
                                                     GjsUnrootedFunc    notify,
                                                     JSObject          *child,
-                                                    void              *data);
+                                                    void              *data,
+                                                    guint             *index_p);
 void      gjs_keep_alive_remove_child              (JSObject          *keep_alive,
                                                     GjsUnrootedFunc    notify,
                                                     JSObject          *child,
-                                                    void              *data);
+                                                    void              *data,
+                                                    guint             *index_p);
 JSObject* gjs_keep_alive_get_global                (JSContext         *context);
 JSObject* gjs_keep_alive_get_global_if_exists      (JSContext         *context);
 void      gjs_keep_alive_add_global_child          (JSContext         *context,
                                                     GjsUnrootedFunc  notify,
                                                     JSObject          *child,
-                                                    void              *data);
+                                                    void              *data,
+                                                    guint             *index_p);
 void      gjs_keep_alive_remove_global_child       (JSContext         *context,
                                                     GjsUnrootedFunc  notify,
                                                     JSObject          *child,
-                                                    void              *data);
+                                                    void              *data,
+                                                    guint             *index_p);
 
 typedef struct GjsKeepAliveIter GjsKeepAliveIter;
 struct GjsKeepAliveIter {
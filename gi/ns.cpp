@@ -36,12 +36,34 @@
 
 typedef struct {
     char *gi_namespace;
+    GHashTable *misses;  /* jsids known not to name an info */
 } Ns;
 
+/* Maximum number of names remembered as missing from a namespace */
+#define MISS_CACHE_MAX_SIZE 512
+
 extern struct JSClass gjs_ns_class;
 
 GJS_DEFINE_PRIV_FROM_JS(Ns, gjs_ns_class)
 
+/* Return value is false on OOM/exception */
+static bool
+remember_miss(JSContext   *context,
+              Ns          *priv,
+              JS::HandleId id)
+{
+    if (g_hash_table_size(priv->misses) >= MISS_CACHE_MAX_SIZE)
+        return true;
+
+    /* Pin the atom, so that no other name can ever get the same jsid */
+    JS::RootedString str(context, JSID_TO_STRING(id));
+    if (!JS_InternJSString(context, str))
+        return false;
+
+    g_hash_table_add(priv->misses, GSIZE_TO_POINTER(JSID_BITS(id)));
+    return true;
+}
+
 /*
  * The *objp out parameter, on success, should be null to indicate that id
  * was not resolved; and non-null, referring to obj or one of its prototypes,
@@ -60,6 +82,14 @@ ns_new_resolve(JSContext *context,
     bool ret = false;
     bool defined;
 
+    priv = priv_from_js(context, obj);
+
+    /* Repeated misses, e.g. from 'foo' in Gtk checks, are answered
+     * without converting the id to a string */
+    if (priv != NULL && JSID_IS_STRING(id) &&
+        g_hash_table_contains(priv->misses, GSIZE_TO_POINTER(JSID_BITS(id))))
+        return true;
+
     if (!gjs_get_string_id(context, id, &name))
         return true; /* not resolved, but no error */
 
@@ -70,7 +100,6 @@ ns_new_resolve(JSContext *context,
         goto out;
     }
 
-    priv = priv_from_js(context, obj);
     gjs_debug_jsprop(GJS_DEBUG_GNAMESPACE,
                      "Resolve prop '%s' hook obj %p priv %p",
                      name, obj.get(), priv);
@@ -87,8 +116,8 @@ ns_new_resolve(JSContext *context,
     info = g_irepository_find_by_name(repo, priv->gi_namespace, name);
     if (info == NULL) {
         /* No property defined, but no error either, so return true */
+        ret = remember_miss(context, priv, id);
         JS_EndRequest(context);
-        ret = true;
         goto out;
     }
 
@@ -102,7 +131,7 @@ ns_new_resolve(JSContext *context,
         g_base_info_unref(info);
         if (defined)
             objp.set(obj); /* we defined the property in this object */
-        ret = true;
+        ret = defined || remember_miss(context, priv, id);
     } else {
         gjs_debug(GJS_DEBUG_GNAMESPACE,
                   "Failed to define info '%s'",
@@ -130,6 +159,53 @@ get_name (JSContext *context,
     return gjs_string_from_utf8(context, priv->gi_namespace, -1, args.rval());
 }
 
+/* Defines all the infos of the namespace at once, so that a namespace
+ * that is going to be used heavily can be populated when the program is
+ * idle instead of one name at a time when it is busy. Infos that fail to
+ * be defined are skipped, so that the error is thrown when they are
+ * actually used. */
+static bool
+materialize_func(JSContext *context,
+                 unsigned   argc,
+                 JS::Value *vp)
+{
+    GJS_GET_PRIV(context, argc, vp, args, obj, Ns, priv);
+    GIRepository *repo;
+    int n_infos, i;
+
+    if (priv == NULL)
+        return false;
+
+    repo = g_irepository_get_default();
+    n_infos = g_irepository_get_n_infos(repo, priv->gi_namespace);
+
+    gjs_debug(GJS_DEBUG_GNAMESPACE, "Materializing %d infos of namespace '%s'",
+              n_infos, priv->gi_namespace);
+
+    for (i = 0; i < n_infos; i++) {
+        GIBaseInfo *info = g_irepository_get_info(repo, priv->gi_namespace, i);
+        bool found, defined;
+
+        /* Already resolved, or replaced by an override */
+        if (!JS_AlreadyHasOwnProperty(context, obj,
+                                      g_base_info_get_name(info), &found)) {
+            g_base_info_unref(info);
+            return false;
+        }
+
+        if (!found && !gjs_define_info(context, obj, info, &defined)) {
+            gjs_debug(GJS_DEBUG_GNAMESPACE, "Failed to define info '%s'",
+                      g_base_info_get_name(info));
+            JS_ClearPendingException(context);
+        }
+
+        g_base_info_unref(info);
+    }
+
+    args.rval().setUndefined();
+    return true;
+}
+
 GJS_NATIVE_CONSTRUCTOR_DEFINE_ABSTRACT(ns)
 
 static void
@@ -146,6 +222,7 @@ ns_finalize(JSFreeOp *fop,
 
     if (priv->gi_namespace)
         g_free(priv->gi_namespace);
+    g_hash_table_destroy(priv->misses);
 
     GJS_DEC_COUNTER(ns);
     g_slice_free(Ns, priv);
@@ -175,6 +252,7 @@ JSPropertySpec gjs_ns_proto_props[] = {
 };
 
 JSFunctionSpec gjs_ns_proto_funcs[] = {
+    JS_FS("__materialize__", materialize_func, 0, 0),
     JS_FS_END
 };
 
@@ -238,6 +316,7 @@ ns_new(JSContext    *context,
 
     priv = priv_from_js(context, ns);
     priv->gi_namespace = g_strdup(ns_name);
+    priv->misses = g_hash_table_new(NULL, NULL);
     return ns;
 }
 
@@ -23,6 +23,7 @@
 
 #include <config.h>
 
+#include <deque>
 #include <memory>
 #include <stack>
 #include <string.h>
@@ -46,6 +47,7 @@
 #include "gjs/jsapi-wrapper.h"
 #include "gjs/context-private.h"
 #include "gjs/mem.h"
+#include "gjs/startup-profile.h"
 #include "gjs/type-module.h"
 
 #include <util/log.h>
@@ -56,6 +58,7 @@ typedef struct {
     GIObjectInfo *info;
     GObject *gobj; /* NULL if we are the prototype and not an instance */
     JSObject *keep_alive; /* NULL if we are not added to it */
+    guint keep_alive_index; /* our position in keep_alive */
     GType gtype;
 
     /* a list of all signal connections, used when tracing */
@@ -64,8 +67,38 @@ typedef struct {
     /* the GObjectClass wrapped by this JS Object (only used for
        prototypes) */
     GTypeClass *klass;
+
+    /* interned jsid -> GParamSpec, or NULL if the name is not a GObject
+       property (only used for prototypes) */
+    GHashTable *property_cache;
+
+    /* interned jsid -> ObjectSignal (only used for prototypes) */
+    GHashTable *signal_cache;
 } ObjectInstance;
 
+typedef bool (*ObjectSignalConvertFunc) (JSContext      *context,
+                                         JS::HandleValue value,
+                                         GValue         *gvalue);
+
+/* How emit() converts one signal parameter. init_value is a GValue that
+ * is already initialized to the parameter type, when that type can be
+ * initialized by copying it; otherwise it is G_VALUE_INIT and gtype is
+ * initialized on each emission. */
+typedef struct {
+    GType gtype;
+    GValue init_value;
+    ObjectSignalConvertFunc convert;
+} ObjectSignalParam;
+
+typedef struct {
+    guint signal_id;
+    GQuark detail;
+    GSignalQuery query;
+    /* one per parameter, only set for signals from the cache, which
+       owns them */
+    ObjectSignalParam *params;
+} ObjectSignal;
+
 typedef struct {
     ObjectInstance *obj;
     GList *link;
@@ -82,7 +115,6 @@ typedef struct
 {
     GObject         *gobj;
     ToggleDirection  direction;
-    guint            needs_unref : 1;
 } ToggleRefNotifyOperation;
 
 enum {
@@ -95,7 +127,18 @@ static GHashTable *class_init_properties;
 
 extern struct JSClass gjs_object_instance_class;
 static GThread *gjs_eval_thread;
-static volatile gint pending_idle_toggles;
+
+/* Toggle notifications coming from other threads than gjs_eval_thread are
+ * queued here, and handled in batches by a single idle source in the main
+ * context. toggle_queue_pending maps each GObject to the mask of directions
+ * that are queued for it; operations in toggle_queue whose bit was cleared
+ * in the meantime, because they were coalesced or cancelled, are skipped.
+ */
+static GMutex toggle_queue_lock;
+static std::deque<ToggleRefNotifyOperation> toggle_queue;
+static GHashTable *toggle_queue_pending;
+static bool toggle_queue_dispatch_scheduled;
+static volatile gint toggle_queue_depth;
 
 GJS_DEFINE_PRIV_FROM_JS(ObjectInstance, gjs_object_instance_class)
 
@@ -106,6 +149,8 @@ static void            set_js_obj   (GObject   *gobj,
                                      JSObject  *obj);
 static void            poison_js_obj(GObject   *gobj);
 
+static gchar          *hyphen_to_underscore (gchar *string);
+
 static void            disassociate_js_gobject (GObject *gobj);
 static void            invalidate_all_signals (ObjectInstance *priv);
 typedef enum {
@@ -144,26 +189,6 @@ gjs_object_priv_quark (void)
     return val;
 }
 
-static GQuark
-gjs_toggle_down_quark (void)
-{
-    static GQuark val = 0;
-    if (G_UNLIKELY (!val))
-        val = g_quark_from_static_string ("gjs::toggle-down-quark");
-
-    return val;
-}
-
-static GQuark
-gjs_toggle_up_quark (void)
-{
-    static GQuark val = 0;
-    if (G_UNLIKELY (!val))
-        val = g_quark_from_static_string ("gjs::toggle-up-quark");
-
-    return val;
-}
-
 /* Plain g_type_query fails and leaves @query uninitialized for
    dynamic types.
    See https://bugzilla.gnome.org/show_bug.cgi?id=687184 and
@@ -253,134 +278,195 @@ proto_priv_from_js(JSContext       *context,
     return priv_from_js(context, proto);
 }
 
-/* a hook on getting a property; set value_p to override property's value.
+/* Maximum number of names remembered in a prototype's property cache */
+#define PROPERTY_CACHE_MAX_SIZE 512
+
+/* Finds the GParamSpec for the GObject property named by @id on @priv's
+ * object, setting @param_p to NULL if there is none. Results, including
+ * misses, are cached on the prototype so that repeated accesses don't have
+ * to convert @id to a hyphenated C string and search the class again.
  * Return value is false on OOM/exception.
  */
 static bool
-object_instance_get_prop(JSContext              *context,
-                         JS::HandleObject        obj,
-                         JS::HandleId            id,
-                         JS::MutableHandleValue  value_p)
+find_param_spec_for_id(JSContext       *context,
+                       JS::HandleObject obj,
+                       ObjectInstance  *priv,
+                       JS::HandleId     id,
+                       GParamSpec     **param_p)
 {
-    ObjectInstance *priv;
+    ObjectInstance *proto_priv;
+    GHashTable *cache = NULL;
+    gpointer key = GSIZE_TO_POINTER(JSID_BITS(id));
+    gpointer cached;
     char *name;
     char *gname;
-    GParamSpec *param;
-    GValue gvalue = { 0, };
-    bool ret = true;
+
+    *param_p = NULL;
+
+    if (!JSID_IS_STRING(id))
+        return true;
+
+    proto_priv = proto_priv_from_js(context, obj);
+    if (proto_priv != NULL && proto_priv->gobj == NULL &&
+        proto_priv->gtype == G_OBJECT_TYPE(priv->gobj)) {
+        if (proto_priv->property_cache == NULL)
+            proto_priv->property_cache = g_hash_table_new(NULL, NULL);
+        cache = proto_priv->property_cache;
+
+        if (g_hash_table_lookup_extended(cache, key, NULL, &cached)) {
+            *param_p = (GParamSpec *) cached;
+            return true;
+        }
+    }
 
     if (!gjs_get_string_id(context, id, &name))
         return true; /* not resolved, but no error */
 
+    gname = gjs_hyphen_from_camel(name);
+    *param_p = g_object_class_find_property(G_OBJECT_GET_CLASS(priv->gobj),
+                                            gname);
+    gjs_debug_jsprop(GJS_DEBUG_GOBJECT,
+                     "Looked up prop '%s' (%s) on %s: %p", name, gname,
+                     g_type_name(G_OBJECT_TYPE(priv->gobj)), *param_p);
+    g_free(gname);
+    g_free(name);
+
+    if (cache != NULL && g_hash_table_size(cache) < PROPERTY_CACHE_MAX_SIZE) {
+        /* Pin the atom, so that no other name can ever get the same jsid.
+         * The param spec belongs to proto_priv->klass, which we hold a
+         * reference to. */
+        JS::RootedString str(context, JSID_TO_STRING(id));
+        if (!JS_InternJSString(context, str))
+            return false;
+        g_hash_table_insert(cache, key, *param_p);
+    }
+
+    return true;
+}
+
+/* Getter defined on the prototype for each GObject property; obj is the
+ * object the property was looked up on. Return value is false on
+ * OOM/exception.
+ */
+static bool
+object_prop_getter(JSContext              *context,
+                   JS::HandleObject        obj,
+                   JS::HandleId            id,
+                   JS::MutableHandleValue  value_p)
+{
+    ObjectInstance *priv;
+    GParamSpec *param;
+    GValue gvalue = { 0, };
+    bool ret = true;
+
     priv = priv_from_js(context, obj);
     gjs_debug_jsprop(GJS_DEBUG_GOBJECT,
-                     "Get prop '%s' hook obj %p priv %p",
-                     name, obj.get(), priv);
+                     "Get prop obj %p priv %p", obj.get(), priv);
 
     if (priv == NULL) {
-        /* If we reach this point, either object_instance_new_resolve
-         * did not throw (so name == "_init"), or the property actually
-         * exists and it's not something we should be concerned with */
-        goto out;
+        /* Either the wrapper wasn't initialized yet, or obj only has
+         * one of our prototypes on its prototype chain */
+        return true;
     }
     if (priv->gobj == NULL) /* prototype, not an instance. */
-        goto out;
+        return true;
 
-    gname = gjs_hyphen_from_camel(name);
-    param = g_object_class_find_property(G_OBJECT_GET_CLASS(priv->gobj),
-                                         gname);
-    g_free(gname);
+    if (!find_param_spec_for_id(context, obj, priv, id, &param))
+        return false;
 
     if (param == NULL) {
         /* leave value_p as it was */
-        goto out;
+        return true;
     }
 
     /* Do not fetch JS overridden properties from GObject, to avoid
      * infinite recursion. */
     if (g_param_spec_get_qdata(param, gjs_is_custom_property_quark()))
-        goto out;
+        return true;
 
     if ((param->flags & G_PARAM_READABLE) == 0)
-        goto out;
+        return true;
 
     gjs_debug_jsprop(GJS_DEBUG_GOBJECT,
-                     "Overriding %s with GObject prop %s",
-                     name, param->name);
+                     "Overriding with GObject prop %s", param->name);
 
     g_value_init(&gvalue, G_PARAM_SPEC_VALUE_TYPE(param));
     g_object_get_property(priv->gobj, param->name,
                           &gvalue);
-    if (!gjs_value_from_g_value(context, value_p, &gvalue)) {
-        g_value_unset(&gvalue);
+    if (!gjs_value_from_g_value(context, value_p, &gvalue))
         ret = false;
-        goto out;
-    }
     g_value_unset(&gvalue);
 
- out:
-    g_free(name);
     return ret;
 }
 
-/* a hook on setting a property; set value_p to override property value to
- * be set. Return value is false on OOM/exception.
+/* Setter defined on the prototype for each GObject property. Return value
+ * is false on OOM/exception.
  */
 static bool
-object_instance_set_prop(JSContext              *context,
-                         JS::HandleObject        obj,
-                         JS::HandleId            id,
-                         bool                    strict,
-                         JS::MutableHandleValue  value_p)
+object_prop_setter(JSContext              *context,
+                   JS::HandleObject        obj,
+                   JS::HandleId            id,
+                   bool                    strict,
+                   JS::MutableHandleValue  value_p)
 {
     ObjectInstance *priv;
-    char *name;
-    GParameter param = { NULL, { 0, }};
-    bool ret = true;
-
-    if (!gjs_get_string_id(context, id, &name))
-        return true; /* not resolved, but no error */
+    GParamSpec *param;
+    GValue gvalue = { 0, };
 
     priv = priv_from_js(context, obj);
     gjs_debug_jsprop(GJS_DEBUG_GOBJECT,
-                     "Set prop '%s' hook obj %p priv %p",
-                     name, obj.get(), priv);
+                     "Set prop obj %p priv %p", obj.get(), priv);
 
-    if (priv == NULL) {
-        /* see the comment in object_instance_get_prop() on this */
-        goto out;
+    if (priv == NULL || priv->gobj == NULL) {
+        /* A prototype, a wrapper that isn't initialized yet, or an object
+         * that only has one of our prototypes on its prototype chain: the
+         * value is stored in a plain JS property, as it would be without
+         * the accessor, so that e.g. Foo.prototype.bar = function() {}
+         * still defines a method */
+        return JS_DefinePropertyById(context, obj, id, value_p,
+                                     JSPROP_ENUMERATE);
     }
-    if (priv->gobj == NULL) /* prototype, not an instance. */
-        goto out;
 
-    switch (init_g_param_from_property(context, name,
-                                       value_p,
-                                       G_TYPE_FROM_INSTANCE(priv->gobj),
-                                       &param,
-                                       false /* constructing */)) {
-    case SOME_ERROR_OCCURRED:
-        ret = false;
-    case NO_SUCH_G_PROPERTY:
-        goto out;
-    case VALUE_WAS_SET:
-    default:
-        break;
+    if (!find_param_spec_for_id(context, obj, priv, id, &param))
+        return false;
+
+    if (param == NULL) {
+        /* not a GObject prop, so nothing else to do */
+        return true;
     }
 
-    g_object_set_property(priv->gobj, param.name,
-                          &param.value);
+    /* Do not set JS overridden properties through GObject, to avoid
+     * infinite recursion */
+    if (g_param_spec_get_qdata(param, gjs_is_custom_property_quark()))
+        return true;
 
-    g_value_unset(&param.value);
+    if ((param->flags & G_PARAM_WRITABLE) == 0) {
+        char *name;
 
-    /* note that the prop will also have been set in JS, which I think
-     * is OK, since we hook get and set so will always override that
-     * value. We could also use JS_DefineProperty though and specify a
-     * getter/setter maybe, don't know if that is better.
-     */
+        /* prevent setting the prop even in JS */
+        if (gjs_get_string_id(context, id, &name)) {
+            gjs_throw(context, "Property %s (GObject %s) is not writable",
+                      name, param->name);
+            g_free(name);
+        }
+        return false;
+    }
 
- out:
-    g_free(name);
-    return ret;
+    gjs_debug_jsprop(GJS_DEBUG_GOBJECT,
+                     "Syncing to GObject prop %s", param->name);
+
+    g_value_init(&gvalue, G_PARAM_SPEC_VALUE_TYPE(param));
+    if (!gjs_value_to_g_value(context, value_p, &gvalue)) {
+        g_value_unset(&gvalue);
+        return false;
+    }
+
+    g_object_set_property(priv->gobj, param->name, &gvalue);
+
+    g_value_unset(&gvalue);
+
+    return true;
 }
 
 static bool
@@ -759,62 +845,73 @@ gobj_no_longer_kept_alive_func(JSObject *obj,
     priv->keep_alive = NULL;
 }
 
-static GQuark
-get_qdata_key_for_toggle_direction(ToggleDirection direction)
+#define TOGGLE_QUEUED_MASK(direction) (1u << (direction))
+
+/* Clears the bit for a queued toggle in @direction. Must be called with
+ * toggle_queue_lock held. Returns true if such a toggle was queued.
+ */
+static bool
+toggle_queue_clear_locked(GObject         *gobj,
+                          ToggleDirection  direction)
 {
-    GQuark quark;
+    guint mask;
 
-    switch (direction) {
-        case TOGGLE_UP:
-            quark = gjs_toggle_up_quark();
-            break;
-        case TOGGLE_DOWN:
-            quark = gjs_toggle_down_quark();
-            break;
-        default:
-            g_assert_not_reached();
-    }
+    if (toggle_queue_pending == NULL)
+        return false;
+
+    mask = GPOINTER_TO_UINT(g_hash_table_lookup(toggle_queue_pending, gobj));
+    if ((mask & TOGGLE_QUEUED_MASK(direction)) == 0)
+        return false;
+
+    mask &= ~TOGGLE_QUEUED_MASK(direction);
+    if (mask == 0)
+        g_hash_table_remove(toggle_queue_pending, gobj);
+    else
+        g_hash_table_insert(toggle_queue_pending, gobj, GUINT_TO_POINTER(mask));
 
-    return quark;
+    g_atomic_int_add(&toggle_queue_depth, -1);
+    return true;
 }
 
 static bool
-clear_toggle_idle_source(GObject          *gobj,
-                         ToggleDirection   direction)
+toggle_queue_clear(GObject         *gobj,
+                   ToggleDirection  direction)
 {
-    GQuark qdata_key;
+    bool was_queued;
 
-    qdata_key = get_qdata_key_for_toggle_direction(direction);
+    g_mutex_lock(&toggle_queue_lock);
+    was_queued = toggle_queue_clear_locked(gobj, direction);
+    g_mutex_unlock(&toggle_queue_lock);
 
-    return g_object_steal_qdata(gobj, qdata_key) != NULL;
+    return was_queued;
 }
 
 static bool
-toggle_idle_source_is_queued(GObject          *gobj,
-                             ToggleDirection   direction)
+toggle_is_queued(GObject         *gobj,
+                 ToggleDirection  direction)
 {
-    GQuark qdata_key;
+    guint mask = 0;
 
-    qdata_key = get_qdata_key_for_toggle_direction(direction);
+    g_mutex_lock(&toggle_queue_lock);
+    if (toggle_queue_pending != NULL)
+        mask = GPOINTER_TO_UINT(g_hash_table_lookup(toggle_queue_pending, gobj));
+    g_mutex_unlock(&toggle_queue_lock);
 
-    return g_object_get_qdata(gobj, qdata_key) != NULL;
+    return (mask & TOGGLE_QUEUED_MASK(direction)) != 0;
 }
 
 static bool
 cancel_toggle_idle(GObject         *gobj,
                    ToggleDirection  direction)
 {
-    GQuark qdata_key;
-    GSource *source;
-
-    qdata_key = get_qdata_key_for_toggle_direction(direction);
-
-    source = (GSource*) g_object_steal_qdata(gobj, qdata_key);
+    if (!toggle_queue_clear(gobj, direction))
+        return false;
 
-    if (source)
-        g_source_destroy(source);
+    /* Queued toggle ups hold a reference, see queue_toggle_idle() */
+    if (direction == TOGGLE_UP)
+        g_object_unref(gobj);
 
-    return source != 0;
+    return true;
 }
 
 static void
@@ -839,7 +936,8 @@ handle_toggle_down(GObject *gobj)
         gjs_keep_alive_remove_child(priv->keep_alive,
                                     gobj_no_longer_kept_alive_func,
                                     obj,
-                                    priv);
+                                    priv,
+                                    &priv->keep_alive_index);
         priv->keep_alive = NULL;
     }
 }
@@ -877,95 +975,111 @@ handle_toggle_up(GObject   *gobj)
         gjs_keep_alive_add_child(priv->keep_alive,
                                  gobj_no_longer_kept_alive_func,
                                  obj,
-                                 priv);
+                                 priv,
+                                 &priv->keep_alive_index);
     }
 }
 
 static gboolean
-idle_handle_toggle(gpointer data)
+idle_handle_toggles(gpointer data)
 {
-    ToggleRefNotifyOperation *operation = (ToggleRefNotifyOperation *) data;
+    std::deque<ToggleRefNotifyOperation> batch;
 
-    if (!clear_toggle_idle_source(operation->gobj, operation->direction)) {
-        /* Already cleared, the JSObject is going away, abort mission */
-        goto out;
-    }
+    g_mutex_lock(&toggle_queue_lock);
+    batch.swap(toggle_queue);
+    toggle_queue_dispatch_scheduled = false;
+    g_mutex_unlock(&toggle_queue_lock);
 
-    switch (operation->direction) {
-        case TOGGLE_UP:
-            handle_toggle_up(operation->gobj);
-            break;
-        case TOGGLE_DOWN:
-            handle_toggle_down(operation->gobj);
-            break;
-        default:
-            g_assert_not_reached();
+    for (const ToggleRefNotifyOperation& operation : batch) {
+        if (!toggle_queue_clear(operation.gobj, operation.direction)) {
+            /* Coalesced with a later toggle, or already cancelled because
+             * the JSObject is going away */
+            continue;
+        }
+
+        switch (operation.direction) {
+            case TOGGLE_UP:
+                handle_toggle_up(operation.gobj);
+                g_object_unref(operation.gobj);
+                break;
+            case TOGGLE_DOWN:
+                handle_toggle_down(operation.gobj);
+                break;
+            default:
+                g_assert_not_reached();
+        }
     }
 
-out:
     return G_SOURCE_REMOVE;
 }
 
-static void
-toggle_ref_notify_operation_free(ToggleRefNotifyOperation *operation)
-{
-    if (operation->needs_unref)
-        g_object_unref (operation->gobj);
-    g_slice_free(ToggleRefNotifyOperation, operation);
-    g_atomic_int_add(&pending_idle_toggles, -1);
-}
-
 static void
 queue_toggle_idle(GObject         *gobj,
                   ToggleDirection  direction)
 {
-    ToggleRefNotifyOperation *operation;
-    GQuark qdata_key;
-    GSource *source;
+    guint mask;
 
-    operation = g_slice_new0(ToggleRefNotifyOperation);
-    operation->direction = direction;
+    g_mutex_lock(&toggle_queue_lock);
+
+    if (toggle_queue_pending == NULL)
+        toggle_queue_pending = g_hash_table_new(NULL, NULL);
+
+    mask = GPOINTER_TO_UINT(g_hash_table_lookup(toggle_queue_pending, gobj));
+
+    if (direction == TOGGLE_UP && (mask & TOGGLE_QUEUED_MASK(TOGGLE_DOWN))) {
+        /* A toggle down followed by a toggle up leaves the wrapper
+         * rooted, as it is now, so we can drop both. */
+        toggle_queue_clear_locked(gobj, TOGGLE_DOWN);
+        g_mutex_unlock(&toggle_queue_lock);
+        return;
+    }
 
     switch (direction) {
         case TOGGLE_UP:
             /* If we're toggling up we take a reference to the object now,
              * so it won't toggle down before we process it. This ensures we
-             * only ever have at most two toggle notifications queued.
-             * (either only up, or down-up)
+             * only ever have one toggle notification queued per object,
+             * since a toggle down queued before is coalesced above.
+             * Taking the reference can't cause another toggle notification,
+             * since there are already two references.
              */
-            operation->gobj = (GObject*) g_object_ref(gobj);
-            operation->needs_unref = true;
+            g_object_ref(gobj);
             break;
         case TOGGLE_DOWN:
             /* If we're toggling down, we don't need to take a reference since
              * the associated JSObject already has one, and that JSObject won't
              * get finalized until we've completed toggling (since it's rooted,
-             * until we unroot it when we dispatch the toggle down idle).
+             * until we unroot it when we handle the toggle down).
              *
              * Taking a reference now would be bad anyway, since it would force
              * the object to toggle back up again.
              */
-            operation->gobj = gobj;
             break;
         default:
             g_assert_not_reached();
     }
 
-    qdata_key = get_qdata_key_for_toggle_direction(direction);
+    g_hash_table_insert(toggle_queue_pending, gobj,
+                        GUINT_TO_POINTER(mask | TOGGLE_QUEUED_MASK(direction)));
+    toggle_queue.push_back({ gobj, direction });
+    g_atomic_int_inc(&toggle_queue_depth);
 
-    source = g_idle_source_new();
-    g_source_set_priority(source, G_PRIORITY_HIGH);
-    g_source_set_callback(source,
-                          idle_handle_toggle,
-                          operation,
-                          (GDestroyNotify) toggle_ref_notify_operation_free);
+    if (!toggle_queue_dispatch_scheduled) {
+        GSource *source = g_idle_source_new();
+        g_source_set_priority(source, G_PRIORITY_HIGH);
+        g_source_set_callback(source, idle_handle_toggles, NULL, NULL);
+        g_source_attach(source, NULL);
+        g_source_unref(source);
+        toggle_queue_dispatch_scheduled = true;
+    }
 
-    g_atomic_int_inc(&pending_idle_toggles);
-    g_object_set_qdata (gobj, qdata_key, source);
-    g_source_attach (source, NULL);
+    g_mutex_unlock(&toggle_queue_lock);
+}
 
-    /* object qdata is piggy-backing off the main loop's ref of the source */
-    g_source_unref (source);
+int
+gjs_object_get_toggle_queue_depth(void)
+{
+    return g_atomic_int_get(&toggle_queue_depth);
 }
 
 static void
@@ -1026,8 +1140,8 @@ wrapped_gobj_toggle_notify(gpointer      data,
         is_sweeping = false;
     }
 
-    toggle_up_queued = toggle_idle_source_is_queued(gobj, TOGGLE_UP);
-    toggle_down_queued = toggle_idle_source_is_queued(gobj, TOGGLE_DOWN);
+    toggle_up_queued = toggle_is_queued(gobj, TOGGLE_UP);
+    toggle_down_queued = toggle_is_queued(gobj, TOGGLE_DOWN);
 
     if (is_last_ref) {
         /* We've transitions from 2 -> 1 references,
@@ -1097,7 +1211,7 @@ gjs_object_prepare_shutdown (JSContext *context)
 
     /* First, get rid of anything left over on the main context */
     while (g_main_context_pending(NULL) &&
-           g_atomic_int_get(&pending_idle_toggles) > 0) {
+           g_atomic_int_get(&toggle_queue_depth) > 0) {
         g_main_context_iteration(NULL, false);
     }
 
@@ -1116,6 +1230,18 @@ gjs_object_prepare_shutdown (JSContext *context)
     }
 }
 
+/* Per-type accounting of wrapper instances, see gjs/mem.h */
+static void
+object_account_instance(ObjectInstance *priv,
+                        int             delta)
+{
+    GTypeQuery query;
+
+    g_type_query_dynamic_safe(priv->gtype, &query);
+    gjs_memory_account_type("object", g_type_name(priv->gtype), delta,
+                            (gint64) delta * query.instance_size);
+}
+
 static ObjectInstance *
 init_object_private (JSContext       *context,
                      JS::HandleObject object)
@@ -1144,6 +1270,8 @@ init_object_private (JSContext       *context,
     if (priv->info)
         g_base_info_ref( (GIBaseInfo*) priv->info);
 
+    object_account_instance(priv, 1);
+
     JS_EndRequest(context);
     return priv;
 }
@@ -1180,7 +1308,8 @@ associate_js_gobject (JSContext       *context,
     gjs_keep_alive_add_child(priv->keep_alive,
                              gobj_no_longer_kept_alive_func,
                              object,
-                             priv);
+                             priv,
+                             &priv->keep_alive_index);
 
     g_object_add_toggle_ref(gobj, wrapped_gobj_toggle_notify, NULL);
 }
@@ -1262,7 +1391,7 @@ object_instance_init (JSContext                  *context,
 
     g_type_query_dynamic_safe(gtype, &query);
     if (G_LIKELY (query.type))
-        JS_updateMallocCounter(context, query.instance_size);
+        gjs_gc_note_native_alloc(context, query.instance_size);
 
     if (G_IS_INITIALLY_UNOWNED(gobj) &&
         !g_object_is_floating(gobj)) {
@@ -1418,7 +1547,8 @@ object_instance_finalize(JSFreeOp  *fop,
         gjs_keep_alive_remove_child(priv->keep_alive,
                                     gobj_no_longer_kept_alive_func,
                                     obj,
-                                    priv);
+                                    priv,
+                                    &priv->keep_alive_index);
     }
 
     if (priv->info) {
@@ -1426,9 +1556,22 @@ object_instance_finalize(JSFreeOp  *fop,
         priv->info = NULL;
     }
 
+    if (priv->property_cache) {
+        g_hash_table_destroy(priv->property_cache);
+        priv->property_cache = NULL;
+    }
+
+    if (priv->signal_cache) {
+        g_hash_table_destroy(priv->signal_cache);
+        priv->signal_cache = NULL;
+    }
+
     if (priv->klass) {
+        /* Only prototypes have a class */
         g_type_class_unref (priv->klass);
         priv->klass = NULL;
+    } else {
+        object_account_instance(priv, -1);
     }
 
     GJS_DEC_COUNTER(object);
@@ -1524,6 +1667,250 @@ signal_connection_invalidated (gpointer  user_data,
     g_slice_free(ConnectData, connect_data);
 }
 
+/* Converters used by emit() for the parameter types that are most common
+ * in signals; they behave like gjs_value_to_g_value() does for those
+ * types, without the type checks. */
+static bool
+signal_param_from_int(JSContext      *context,
+                      JS::HandleValue value,
+                      GValue         *gvalue)
+{
+    gint32 i;
+
+    if (!JS::ToInt32(context, value, &i)) {
+        gjs_throw(context, "Wrong type %s; integer expected",
+                  gjs_get_type_name(value));
+        return false;
+    }
+    g_value_set_int(gvalue, i);
+    return true;
+}
+
+static bool
+signal_param_from_uint(JSContext      *context,
+                       JS::HandleValue value,
+                       GValue         *gvalue)
+{
+    guint32 i;
+
+    if (!JS::ToUint32(context, value, &i)) {
+        gjs_throw(context, "Wrong type %s; unsigned integer expected",
+                  gjs_get_type_name(value));
+        return false;
+    }
+    g_value_set_uint(gvalue, i);
+    return true;
+}
+
+static bool
+signal_param_from_double(JSContext      *context,
+                         JS::HandleValue value,
+                         GValue         *gvalue)
+{
+    double d;
+
+    if (!JS::ToNumber(context, value, &d)) {
+        gjs_throw(context, "Wrong type %s; double expected",
+                  gjs_get_type_name(value));
+        return false;
+    }
+    g_value_set_double(gvalue, d);
+    return true;
+}
+
+static bool
+signal_param_from_boolean(JSContext      *context,
+                          JS::HandleValue value,
+                          GValue         *gvalue)
+{
+    /* JS::ToBoolean() can't fail */
+    g_value_set_boolean(gvalue, JS::ToBoolean(value));
+    return true;
+}
+
+static bool
+signal_param_from_string(JSContext      *context,
+                         JS::HandleValue value,
+                         GValue         *gvalue)
+{
+    char *utf8_string;
+
+    if (value.isNull()) {
+        g_value_set_string(gvalue, NULL);
+        return true;
+    }
+
+    if (!value.isString()) {
+        gjs_throw(context, "Wrong type %s; string expected",
+                  gjs_get_type_name(value));
+        return false;
+    }
+
+    if (!gjs_string_to_utf8(context, value, &utf8_string))
+        return false;
+    g_value_take_string(gvalue, utf8_string);
+    return true;
+}
+
+/* Picks the converter for each parameter of a signal, once, when the
+ * signal is added to a prototype's signal cache */
+static ObjectSignalParam *
+object_signal_params_new(const GSignalQuery *query)
+{
+    ObjectSignalParam *params;
+    unsigned i;
+
+    params = g_new0(ObjectSignalParam, query->n_params);
+
+    for (i = 0; i < query->n_params; i++) {
+        ObjectSignalParam *param = &params[i];
+        bool static_scope;
+
+        static_scope = (query->param_types[i] & G_SIGNAL_TYPE_STATIC_SCOPE) != 0;
+        param->gtype = query->param_types[i] & ~G_SIGNAL_TYPE_STATIC_SCOPE;
+
+        if (param->gtype == G_TYPE_INT)
+            param->convert = signal_param_from_int;
+        else if (param->gtype == G_TYPE_UINT)
+            param->convert = signal_param_from_uint;
+        else if (param->gtype == G_TYPE_DOUBLE)
+            param->convert = signal_param_from_double;
+        else if (param->gtype == G_TYPE_BOOLEAN)
+            param->convert = signal_param_from_boolean;
+        else if (param->gtype == G_TYPE_STRING)
+            param->convert = signal_param_from_string;
+
+        if (param->convert != NULL) {
+            /* Initializing these fundamental types only zeroes the value,
+             * so the initialized value can be copied on each emission */
+            g_value_init(&param->init_value, param->gtype);
+        } else if (static_scope) {
+            param->convert = gjs_value_to_g_value_no_copy;
+        } else {
+            param->convert = gjs_value_to_g_value;
+        }
+    }
+
+    return params;
+}
+
+static gint64
+object_signal_size(const ObjectSignal *signal)
+{
+    return sizeof(ObjectSignal) +
+        signal->query.n_params * sizeof(ObjectSignalParam);
+}
+
+static void
+object_signal_free(gpointer data)
+{
+    ObjectSignal *signal = (ObjectSignal *) data;
+
+    gjs_memory_account_type("cache", g_intern_static_string("ObjectSignal"),
+                            -1, -object_signal_size(signal));
+
+    g_free(signal->params);
+    g_slice_free(ObjectSignal, signal);
+}
+
+/* Maximum number of signal names remembered in a prototype's signal cache */
+#define SIGNAL_CACHE_MAX_SIZE 256
+
+/* Resolves the signal given to connect() or emit(), either as a detailed
+ * signal name or as a signal id as returned by GObject.signal_lookup().
+ * Names are cached on the prototype by their atom, so that connecting to
+ * or emitting the same signal again skips the UTF-8 conversion, parsing
+ * and querying, and so that emit() can reuse the parameter converters.
+ */
+static bool
+resolve_signal(JSContext       *context,
+               JS::HandleObject obj,
+               ObjectInstance  *priv,
+               JS::HandleValue  signal_value,
+               ObjectSignal    *signal_p)
+{
+    GType gtype = G_OBJECT_TYPE(priv->gobj);
+    ObjectInstance *proto_priv;
+    GHashTable *cache = NULL;
+    JS::RootedId id(context);
+    gpointer key = NULL;
+    char *signal_name;
+
+    signal_p->params = NULL;
+
+    if (signal_value.isNumber()) {
+        double signal_id = signal_value.toNumber();
+
+        if (signal_id >= 1 && signal_id <= G_MAXUINT &&
+            signal_id == (guint) signal_id) {
+            g_signal_query((guint) signal_id, &signal_p->query);
+            if (signal_p->query.signal_id != 0 &&
+                g_type_is_a(gtype, signal_p->query.itype)) {
+                signal_p->signal_id = signal_p->query.signal_id;
+                signal_p->detail = 0;
+                return true;
+            }
+        }
+
+        gjs_throw(context, "No signal with id %g on object '%s'",
+                  signal_id, g_type_name(gtype));
+        return false;
+    }
+
+    /* Atomizing is cheap for the strings that are atoms already, such as
+     * literals, and names built at runtime get the same atom as the
+     * literal they are equal to. */
+    if (!JS_ValueToId(context, signal_value, &id))
+        return false;
+
+    proto_priv = proto_priv_from_js(context, obj);
+    if (JSID_IS_STRING(id) && proto_priv != NULL &&
+        proto_priv->gobj == NULL && proto_priv->gtype == gtype) {
+        ObjectSignal *cached;
+
+        if (proto_priv->signal_cache == NULL)
+            proto_priv->signal_cache = g_hash_table_new_full(NULL, NULL, NULL,
+                                                             object_signal_free);
+        cache = proto_priv->signal_cache;
+        key = GSIZE_TO_POINTER(JSID_BITS(id));
+
+        cached = (ObjectSignal *) g_hash_table_lookup(cache, key);
+        if (cached != NULL) {
+            *signal_p = *cached;
+            return true;
+        }
+    }
+
+    if (!gjs_string_to_utf8(context, signal_value, &signal_name))
+        return false;
+
+    if (!g_signal_parse_name(signal_name, gtype,
+                             &signal_p->signal_id, &signal_p->detail,
+                             true)) {
+        gjs_throw(context, "No signal '%s' on object '%s'",
+                  signal_name, g_type_name(gtype));
+        g_free(signal_name);
+        return false;
+    }
+    g_free(signal_name);
+
+    g_signal_query(signal_p->signal_id, &signal_p->query);
+
+    if (cache != NULL && g_hash_table_size(cache) < SIGNAL_CACHE_MAX_SIZE) {
+        /* Pin the atom, so that no other name can ever get the same jsid */
+        JS::RootedString str(context, JSID_TO_STRING(id));
+        if (!JS_InternJSString(context, str))
+            return false;
+
+        signal_p->params = object_signal_params_new(&signal_p->query);
+        g_hash_table_insert(cache, key, g_slice_dup(ObjectSignal, signal_p));
+        gjs_memory_account_type("cache", g_intern_static_string("ObjectSignal"),
+                                1, object_signal_size(signal_p));
+    }
+
+    return true;
+}
+
 static bool
 real_connect_func(JSContext *context,
                   unsigned   argc,
@@ -1533,11 +1920,8 @@ real_connect_func(JSContext *context,
     GJS_GET_PRIV(context, argc, vp, argv, obj, ObjectInstance, priv);
     GClosure *closure;
     gulong id;
-    guint signal_id;
-    char *signal_name;
-    GQuark signal_detail;
+    ObjectSignal signal;
     ConnectData *connect_data;
-    bool ret = false;
 
     gjs_debug_gsignal("connect obj %p priv %p argc %d", obj.get(), priv, argc);
     if (priv == NULL) {
@@ -1558,29 +1942,18 @@ real_connect_func(JSContext *context,
      * JSClass::call, for example.
      */
 
-    if (argc != 2 || !argv[0].isString() || !argv[1].isObject()) {
+    if (argc != 2 || !(argv[0].isString() || argv[0].isNumber()) ||
+        !argv[1].isObject()) {
         gjs_throw(context, "connect() takes two args, the signal name and the callback");
         return false;
     }
 
-    if (!gjs_string_to_utf8(context, argv[0], &signal_name)) {
+    if (!resolve_signal(context, obj, priv, argv[0], &signal))
         return false;
-    }
 
-    if (!g_signal_parse_name(signal_name,
-                             G_OBJECT_TYPE(priv->gobj),
-                             &signal_id,
-                             &signal_detail,
-                             true)) {
-        gjs_throw(context, "No signal '%s' on object '%s'",
-                     signal_name,
-                     g_type_name(G_OBJECT_TYPE(priv->gobj)));
-        goto out;
-    }
-
-    closure = gjs_closure_new_for_signal(context, &argv[1].toObject(), "signal callback", signal_id);
+    closure = gjs_closure_new_for_signal(context, &argv[1].toObject(), "signal callback", signal.signal_id);
     if (closure == NULL)
-        goto out;
+        return false;
 
     connect_data = g_slice_new(ConnectData);
     priv->signals = g_list_prepend(priv->signals, connect_data);
@@ -1591,17 +1964,14 @@ real_connect_func(JSContext *context,
     g_closure_add_invalidate_notifier(closure, connect_data, signal_connection_invalidated);
 
     id = g_signal_connect_closure_by_id(priv->gobj,
-                                        signal_id,
-                                        signal_detail,
+                                        signal.signal_id,
+                                        signal.detail,
                                         closure,
                                         after);
 
     argv.rval().setDouble(id);
 
-    ret = true;
- out:
-    g_free(signal_name);
-    return ret;
+    return true;
 }
 
 static bool
@@ -1626,15 +1996,12 @@ emit_func(JSContext *context,
           JS::Value *vp)
 {
     GJS_GET_PRIV(context, argc, vp, argv, obj, ObjectInstance, priv);
-    guint signal_id;
-    GQuark signal_detail;
-    GSignalQuery signal_query;
-    char *signal_name;
+    ObjectSignal signal;
+    const GSignalQuery *signal_query = &signal.query;
     GValue *instance_and_args;
     GValue rvalue = G_VALUE_INIT;
     unsigned int i;
     bool failed;
-    bool ret = false;
 
     gjs_debug_gsignal("emit obj %p priv %p argc %d", obj.get(), priv, argc);
 
@@ -1651,67 +2018,64 @@ emit_func(JSContext *context,
         return false;
     }
 
-    if (argc < 1 || !argv[0].isString()) {
+    if (argc < 1 || !(argv[0].isString() || argv[0].isNumber())) {
         gjs_throw(context, "emit() first arg is the signal name");
         return false;
     }
 
-    if (!gjs_string_to_utf8(context, argv[0], &signal_name))
+    if (!resolve_signal(context, obj, priv, argv[0], &signal))
         return false;
 
-    if (!g_signal_parse_name(signal_name,
-                             G_OBJECT_TYPE(priv->gobj),
-                             &signal_id,
-                             &signal_detail,
-                             false)) {
-        gjs_throw(context, "No signal '%s' on object '%s'",
-                     signal_name,
-                     g_type_name(G_OBJECT_TYPE(priv->gobj)));
-        goto out;
-    }
-
-    g_signal_query(signal_id, &signal_query);
-
-    if ((argc - 1) != signal_query.n_params) {
+    if ((argc - 1) != signal_query->n_params) {
         gjs_throw(context, "Signal '%s' on %s requires %d args got %d",
-                     signal_name,
+                     signal_query->signal_name,
                      g_type_name(G_OBJECT_TYPE(priv->gobj)),
-                     signal_query.n_params,
+                     signal_query->n_params,
                      argc - 1);
-        goto out;
+        return false;
     }
 
-    if (signal_query.return_type != G_TYPE_NONE) {
-        g_value_init(&rvalue, signal_query.return_type & ~G_SIGNAL_TYPE_STATIC_SCOPE);
+    if (signal_query->return_type != G_TYPE_NONE) {
+        g_value_init(&rvalue, signal_query->return_type & ~G_SIGNAL_TYPE_STATIC_SCOPE);
     }
 
-    instance_and_args = g_newa(GValue, signal_query.n_params + 1);
-    memset(instance_and_args, 0, sizeof(GValue) * (signal_query.n_params + 1));
+    instance_and_args = g_newa(GValue, signal_query->n_params + 1);
+    memset(instance_and_args, 0, sizeof(GValue) * (signal_query->n_params + 1));
 
     g_value_init(&instance_and_args[0], G_TYPE_FROM_INSTANCE(priv->gobj));
     g_value_set_instance(&instance_and_args[0], priv->gobj);
 
     failed = false;
-    for (i = 0; i < signal_query.n_params; ++i) {
+    for (i = 0; i < signal_query->n_params; ++i) {
         GValue *value;
         value = &instance_and_args[i + 1];
 
-        g_value_init(value, signal_query.param_types[i] & ~G_SIGNAL_TYPE_STATIC_SCOPE);
-        if ((signal_query.param_types[i] & G_SIGNAL_TYPE_STATIC_SCOPE) != 0)
-            failed = !gjs_value_to_g_value_no_copy(context, argv[i + 1], value);
-        else
-            failed = !gjs_value_to_g_value(context, argv[i + 1], value);
+        if (signal.params != NULL) {
+            const ObjectSignalParam *param = &signal.params[i];
+
+            if (G_VALUE_TYPE(&param->init_value) != G_TYPE_INVALID)
+                *value = param->init_value;
+            else
+                g_value_init(value, param->gtype);
+            failed = !param->convert(context, argv[i + 1], value);
+        } else {
+            g_value_init(value, signal_query->param_types[i] & ~G_SIGNAL_TYPE_STATIC_SCOPE);
+            if ((signal_query->param_types[i] & G_SIGNAL_TYPE_STATIC_SCOPE) != 0)
+                failed = !gjs_value_to_g_value_no_copy(context, argv[i + 1], value);
+            else
+                failed = !gjs_value_to_g_value(context, argv[i + 1], value);
+        }
 
         if (failed)
             break;
     }
 
     if (!failed) {
-        g_signal_emitv(instance_and_args, signal_id, signal_detail,
+        g_signal_emitv(instance_and_args, signal.signal_id, signal.detail,
                        &rvalue);
     }
 
-    if (signal_query.return_type != G_TYPE_NONE) {
+    if (signal_query->return_type != G_TYPE_NONE) {
         if (!gjs_value_from_g_value(context, argv.rval(), &rvalue))
             failed = true;
 
@@ -1720,14 +2084,11 @@ emit_func(JSContext *context,
         argv.rval().setUndefined();
     }
 
-    for (i = 0; i < (signal_query.n_params + 1); ++i) {
+    for (i = 0; i < (signal_query->n_params + 1); ++i) {
         g_value_unset(&instance_and_args[i]);
     }
 
-    ret = !failed;
- out:
-    g_free(signal_name);
-    return ret;
+    return !failed;
 }
 
 static bool
@@ -1747,14 +2108,61 @@ to_string_func(JSContext *context,
                                      priv->gobj, rec.rval());
 }
 
+/* Sets several properties at once: all values are converted before any of
+ * them is set, and notifications are held back until the last one is set,
+ * so that handlers see the object in its final state.
+ */
+static bool
+set_func(JSContext *context,
+         unsigned   argc,
+         JS::Value *vp)
+{
+    GJS_GET_PRIV(context, argc, vp, argv, obj, ObjectInstance, priv);
+    std::vector<GParameter> params;
+    size_t i;
+
+    if (priv == NULL) {
+        throw_priv_is_null_error(context);
+        return false; /* wrong class passed in */
+    }
+
+    if (priv->gobj == NULL) {
+        /* prototype, not an instance. */
+        gjs_throw(context, "Can't set properties on %s.%s.prototype; only on instances",
+                  priv->info ? g_base_info_get_namespace( (GIBaseInfo*) priv->info) : "",
+                  priv->info ? g_base_info_get_name( (GIBaseInfo*) priv->info) : g_type_name(priv->gtype));
+        return false;
+    }
+
+    if (argc < 1 || !argv[0].isObject()) {
+        gjs_throw(context, "set() takes an object with the properties to set");
+        return false;
+    }
+
+    if (!object_instance_props_to_g_parameters(context, obj, argv,
+                                               G_OBJECT_TYPE(priv->gobj),
+                                               params))
+        return false;
+
+    g_object_freeze_notify(priv->gobj);
+    for (i = 0; i < params.size(); i++)
+        g_object_set_property(priv->gobj, params[i].name, &params[i].value);
+    g_object_thaw_notify(priv->gobj);
+
+    free_g_params(params.data(), params.size());
+
+    argv.rval().setUndefined();
+    return true;
+}
+
 struct JSClass gjs_object_instance_class = {
     "GObject_Object",
-    JSCLASS_HAS_PRIVATE |
+    JSCLASS_HAS_PRIVATE | JSCLASS_IMPLEMENTS_BARRIERS |
     JSCLASS_NEW_RESOLVE,
     JS_PropertyStub,
     JS_DeletePropertyStub,
-    object_instance_get_prop,
-    object_instance_set_prop,
+    JS_PropertyStub,
+    JS_StrictPropertyStub,
     JS_EnumerateStub,
     (JSResolveOp) object_instance_new_resolve, /* needs cast since it's the new resolve signature */
     JS_ConvertStub,
@@ -1794,6 +2202,7 @@ JSFunctionSpec gjs_object_instance_proto_funcs[] = {
     JS_FS("connect", connect_func, 0, 0),
     JS_FS("connect_after", connect_after_func, 0, 0),
     JS_FS("emit", emit_func, 0, 0),
+    JS_FS("set", set_func, 1, 0),
     JS_FS("toString", to_string_func, 0, 0),
     JS_FS_END
 };
@@ -1854,6 +2263,121 @@ gjs_object_define_static_methods(JSContext       *context,
     return true;
 }
 
+/* Whether @name is a method of @gtype, of one of its parent classes, or of
+ * an interface that any of them implements; that is, a method that the
+ * resolve hook would define on the prototype chain */
+static bool
+object_type_has_method(GType       gtype,
+                       const char *name)
+{
+    for (; gtype != G_TYPE_INVALID; gtype = g_type_parent(gtype)) {
+        GIBaseInfo *info;
+        GIFunctionInfo *method_info = NULL;
+
+        info = g_irepository_find_by_gtype(g_irepository_get_default(), gtype);
+
+        if (info != NULL) {
+            if (g_base_info_get_type(info) == GI_INFO_TYPE_OBJECT)
+                method_info = g_object_info_find_method_using_interfaces((GIObjectInfo *) info,
+                                                                         name, NULL);
+            g_base_info_unref(info);
+        } else {
+            /* Types without introspection info still get the methods of
+             * their interfaces, see object_instance_new_resolve_no_info() */
+            GType *interfaces;
+            guint n_interfaces, i;
+
+            interfaces = g_type_interfaces(gtype, &n_interfaces);
+            for (i = 0; method_info == NULL && i < n_interfaces; i++) {
+                info = g_irepository_find_by_gtype(g_irepository_get_default(),
+                                                   interfaces[i]);
+                if (info == NULL)
+                    continue;
+                if (g_base_info_get_type(info) == GI_INFO_TYPE_INTERFACE)
+                    method_info = g_interface_info_find_method((GIInterfaceInfo *) info,
+                                                               name);
+                g_base_info_unref(info);
+            }
+            g_free(interfaces);
+        }
+
+        if (method_info != NULL) {
+            g_base_info_unref((GIBaseInfo *) method_info);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool
+define_object_prop_accessor(JSContext       *context,
+                            ObjectInstance  *priv,
+                            JS::HandleObject proto,
+                            const char      *name)
+{
+    bool found;
+
+    /* Methods take precedence over properties with the same name, as they
+     * would if they had been resolved before the property was looked up;
+     * this includes the methods of parent classes, which a subclass
+     * property must not shadow */
+    if (object_type_has_method(priv->gtype, name))
+        return true;
+
+    if (!JS_AlreadyHasOwnProperty(context, proto, name, &found))
+        return false;
+    if (found)
+        return true;
+
+    /* Not permanent, so that assigning to the property on a prototype can
+     * replace the accessor, see object_prop_setter() */
+    return JS_DefineProperty(context, proto, name, JS::NullHandleValue,
+                             JSPROP_SHARED,
+                             object_prop_getter, object_prop_setter);
+}
+
+/* Defines accessors on the prototype for the GObject properties introduced
+ * by priv->gtype, under the names a property can be accessed by: with
+ * underscores, in camelCase and with hyphens. Inherited properties already
+ * have accessors on the parent prototypes, and properties overridden in JS
+ * are left to the JS class.
+ */
+static bool
+define_object_class_properties(JSContext       *context,
+                               ObjectInstance  *priv,
+                               JS::HandleObject proto)
+{
+    GParamSpec **properties;
+    guint n_properties, i;
+    bool ret = true;
+
+    properties = g_object_class_list_properties(G_OBJECT_CLASS(priv->klass),
+                                                &n_properties);
+
+    for (i = 0; ret && i < n_properties; i++) {
+        GParamSpec *param = properties[i];
+        char *underscore_name, *camel_name;
+
+        if (param->owner_type != priv->gtype ||
+            g_param_spec_get_qdata(param, gjs_is_custom_property_quark()))
+            continue;
+
+        underscore_name = hyphen_to_underscore((gchar *) param->name);
+        camel_name = gjs_camel_from_hyphen(param->name);
+
+        ret = define_object_prop_accessor(context, priv, proto, underscore_name) &&
+            define_object_prop_accessor(context, priv, proto, camel_name) &&
+            define_object_prop_accessor(context, priv, proto, param->name);
+
+        g_free(underscore_name);
+        g_free(camel_name);
+    }
+
+    g_free(properties);
+    return ret;
+}
+
 void
 gjs_define_object_class(JSContext              *context,
                         JS::HandleObject        in_object,
@@ -1871,6 +2395,10 @@ gjs_define_object_class(JSContext              *context,
     g_assert(in_object != NULL);
     g_assert(gtype != G_TYPE_INVALID);
 
+    GjsProfileScope profile(GJS_PROFILE_GI_CLASS,
+                            info ? g_base_info_get_namespace((GIBaseInfo *) info) : NULL,
+                            info ? g_base_info_get_name((GIBaseInfo *) info) : g_type_name(gtype));
+
     /*   http://egachine.berlios.de/embedding-sm-best-practice/apa.html
      *   http://www.sitepoint.com/blogs/2006/01/17/javascript-inheritance/
      *   http://www.cs.rit.edu/~atk/JavaScript/manuals/jsobj/
@@ -1949,6 +2477,9 @@ gjs_define_object_class(JSContext              *context,
               constructor_name, prototype.get(), JS_GetClass(prototype),
               in_object.get());
 
+    if (!define_object_class_properties(context, priv, prototype))
+        g_error("Can't define properties of class %s", constructor_name);
+
     if (info)
         gjs_object_define_static_methods(context, constructor, gtype, info);
 
@@ -2044,6 +2575,10 @@ gjs_object_from_g_object(JSContext    *context,
         g_object_unref(gobj);
 
         g_assert(peek_js_obj(gobj) == obj);
+    } else {
+        /* The wrapper is only weakly referenced from the GObject, so
+         * this is a read barrier for an incremental GC in progress */
+        JS::ExposeObjectToActiveJS(obj);
     }
 
  out:
@@ -39,6 +39,7 @@
 #include "gjs/jsapi-wrapper.h"
 #include "gjs/jsapi-private.h"
 #include "gjs/mem.h"
+#include "gjs/startup-profile.h"
 
 #include <util/misc.h>
 
@@ -99,7 +100,10 @@ resolve_namespace_object(JSContext       *context,
     repo = g_irepository_get_default();
 
     error = NULL;
-    g_irepository_require(repo, ns_name, version, (GIRepositoryLoadFlags) 0, &error);
+    {
+        GjsProfileScope profile(GJS_PROFILE_GI_REQUIRE, NULL, ns_name);
+        g_irepository_require(repo, ns_name, version, (GIRepositoryLoadFlags) 0, &error);
+    }
     if (error != NULL) {
         gjs_throw(context,
                   "Requiring %s, version %s: %s",
@@ -428,6 +432,10 @@ gjs_define_info(JSContext       *context,
     _gjs_log_info_usage(info);
 #endif
 
+    GjsProfileScope profile(GJS_PROFILE_GI_DEFINE,
+                            g_base_info_get_namespace(info),
+                            g_base_info_get_name(info));
+
     *defined = true;
 
     switch (g_base_info_get_type(info)) {
@@ -40,11 +40,24 @@
 
 #include <girepository.h>
 
+/* Everything closure_marshal() needs to know about a signal that doesn't
+ * change between emissions. Signal ids are never reused, so entries are
+ * kept for the lifetime of the process.
+ */
+typedef struct {
+    GSignalQuery query;
+    bool *skip;
+    int *array_len_indices_for;
+    GITypeInfo **type_info_for;
+} GjsSignalCache;
+
+static GHashTable *signal_cache_table = NULL;  /* signal id -> GjsSignalCache */
+
 static bool gjs_value_from_g_value_internal(JSContext             *context,
                                             JS::MutableHandleValue value_p,
                                             const GValue          *gvalue,
                                             bool                   no_copy,
-                                            GSignalQuery          *signal_query,
+                                            GjsSignalCache        *signal,
                                             int                    arg_n);
 
 /*
@@ -78,6 +91,68 @@ get_signal_info_if_available(GSignalQuery *signal_query)
     return signal_info;
 }
 
+/*
+ * Returns the cached information about @signal_id, filling it in on first use,
+ * or NULL if the signal id is invalid.
+ */
+static GjsSignalCache *
+get_signal_cache(guint signal_id)
+{
+    GjsSignalCache *signal;
+    GISignalInfo *signal_info;
+    guint i, n_param_values;
+
+    if (signal_cache_table == NULL)
+        signal_cache_table = g_hash_table_new(NULL, NULL);
+
+    signal = (GjsSignalCache *) g_hash_table_lookup(signal_cache_table,
+                                                    GUINT_TO_POINTER(signal_id));
+    if (signal != NULL)
+        return signal;
+
+    signal = g_slice_new0(GjsSignalCache);
+    g_signal_query(signal_id, &signal->query);
+    if (!signal->query.signal_id) {
+        g_slice_free(GjsSignalCache, signal);
+        return NULL;
+    }
+
+    /* Check if any parameters, such as array lengths, need to be eliminated
+     * before we invoke the closure.
+     */
+    n_param_values = signal->query.n_params + 1;
+    signal->skip = g_new0(bool, n_param_values);
+    signal->array_len_indices_for = g_new(int, n_param_values);
+    for (i = 0; i < n_param_values; i++)
+        signal->array_len_indices_for[i] = -1;
+    signal->type_info_for = g_new0(GITypeInfo *, n_param_values);
+
+    signal_info = get_signal_info_if_available(&signal->query);
+    if (signal_info) {
+        /* Start at argument 1, skip the instance parameter */
+        for (i = 1; i < n_param_values; ++i) {
+            GIArgInfo *arg_info;
+            int array_len_pos;
+
+            arg_info = g_callable_info_get_arg(signal_info, i - 1);
+            signal->type_info_for[i] = g_arg_info_get_type(arg_info);
+
+            array_len_pos = g_type_info_get_array_length(signal->type_info_for[i]);
+            if (array_len_pos != -1) {
+                signal->skip[array_len_pos + 1] = true;
+                signal->array_len_indices_for[i] = array_len_pos + 1;
+            }
+
+            g_base_info_unref((GIBaseInfo *)arg_info);
+        }
+
+        g_base_info_unref((GIBaseInfo *)signal_info);
+    }
+
+    g_hash_table_insert(signal_cache_table, GUINT_TO_POINTER(signal_id), signal);
+    return signal;
+}
+
 /*
  * Fill in value_p with a JS array, converted from a C array stored as a pointer
  * in array_value, with its length stored in array_length_value.
@@ -89,7 +164,7 @@ gjs_value_from_array_and_length_values(JSContext             *context,
                                        const GValue          *array_value,
                                        const GValue          *array_length_value,
                                        bool                   no_copy,
-                                       GSignalQuery          *signal_query,
+                                       GjsSignalCache        *signal,
                                        int                    array_length_arg_n)
 {
     JS::RootedValue array_length(context);
@@ -100,7 +175,7 @@ gjs_value_from_array_and_length_values(JSContext             *context,
 
     if (!gjs_value_from_g_value_internal(context, &array_length,
                                          array_length_value, no_copy,
-                                         signal_query, array_length_arg_n))
+                                         signal, array_length_arg_n))
         return false;
 
     array_arg.v_pointer = g_value_get_pointer(array_value);
@@ -121,11 +196,7 @@ closure_marshal(GClosure        *closure,
     JSRuntime *runtime;
     JSObject *obj;
     unsigned i;
-    GSignalQuery signal_query = { 0, };
-    GISignalInfo *signal_info;
-    bool *skip;
-    int *array_len_indices_for;
-    GITypeInfo **type_info_for;
+    GjsSignalCache *signal = NULL;
 
     gjs_debug_marshal(GJS_DEBUG_GCLOSURE,
                       "Marshal closure %p",
@@ -147,6 +218,7 @@ closure_marshal(GClosure        *closure,
                    "using the destroy() or dispose() vfuncs. Because it would crash the "
                    "application, it has been blocked and the JS callback not invoked.");
         if (hint) {
+            GSignalQuery signal_query = { 0, };
             gpointer instance;
             g_signal_query(hint->signal_id, &signal_query);
 
@@ -172,54 +244,21 @@ closure_marshal(GClosure        *closure,
 
         signal_id = GPOINTER_TO_UINT(marshal_data);
 
-        g_signal_query(signal_id, &signal_query);
+        signal = get_signal_cache(signal_id);
 
-        if (!signal_query.signal_id) {
+        if (signal == NULL) {
             gjs_debug(GJS_DEBUG_GCLOSURE,
                       "Signal handler being called on invalid signal");
             return;
         }
 
-        if (signal_query.n_params + 1 != n_param_values) {
+        if (signal->query.n_params + 1 != n_param_values) {
             gjs_debug(GJS_DEBUG_GCLOSURE,
                       "Signal handler being called with wrong number of parameters");
             return;
         }
     }
 
-    /* Check if any parameters, such as array lengths, need to be eliminated
-     * before we invoke the closure.
-     */
-    skip = g_newa(bool, n_param_values);
-    memset(skip, 0, sizeof (bool) * n_param_values);
-    array_len_indices_for = g_newa(int, n_param_values);
-    for(i = 0; i < n_param_values; i++)
-        array_len_indices_for[i] = -1;
-    type_info_for = g_newa(GITypeInfo *, n_param_values);
-    memset(type_info_for, 0, sizeof (gpointer) * n_param_values);
-
-    signal_info = get_signal_info_if_available(&signal_query);
-    if (signal_info) {
-        /* Start at argument 1, skip the instance parameter */
-        for (i = 1; i < n_param_values; ++i) {
-            GIArgInfo *arg_info;
-            int array_len_pos;
-
-            arg_info = g_callable_info_get_arg(signal_info, i - 1);
-            type_info_for[i] = g_arg_info_get_type(arg_info);
-
-            array_len_pos = g_type_info_get_array_length(type_info_for[i]);
-            if (array_len_pos != -1) {
-                skip[array_len_pos + 1] = true;
-                array_len_indices_for[i] = array_len_pos + 1;
-            }
-
-            g_base_info_unref((GIBaseInfo *)arg_info);
-        }
-
-        g_base_info_unref((GIBaseInfo *)signal_info);
-    }
-
     JS::AutoValueVector argv(context);
     argv.reserve(n_param_values);  /* May end up being less */
     JS::RootedValue argv_to_append(context);
@@ -229,28 +268,28 @@ closure_marshal(GClosure        *closure,
         int array_len_index;
         bool res;
 
-        if (skip[i])
+        if (signal && signal->skip[i])
             continue;
 
         no_copy = false;
 
-        if (i >= 1 && signal_query.signal_id) {
-            no_copy = (signal_query.param_types[i - 1] & G_SIGNAL_TYPE_STATIC_SCOPE) != 0;
+        if (i >= 1 && signal) {
+            no_copy = (signal->query.param_types[i - 1] & G_SIGNAL_TYPE_STATIC_SCOPE) != 0;
         }
 
-        array_len_index = array_len_indices_for[i];
+        array_len_index = signal ? signal->array_len_indices_for[i] : -1;
         if (array_len_index != -1) {
             const GValue *array_len_gval = &param_values[array_len_index];
             res = gjs_value_from_array_and_length_values(context,
                                                          &argv_to_append,
-                                                         type_info_for[i],
+                                                         signal->type_info_for[i],
                                                          gval, array_len_gval,
-                                                         no_copy, &signal_query,
+                                                         no_copy, signal,
                                                          array_len_index);
         } else {
             res = gjs_value_from_g_value_internal(context,
                                                   &argv_to_append,
-                                                  gval, no_copy, &signal_query,
+                                                  gval, no_copy, signal,
                                                   i);
         }
 
@@ -265,10 +304,6 @@ closure_marshal(GClosure        *closure,
         argv.append(argv_to_append);
     }
 
-    for (i = 1; i < n_param_values; i++)
-        if (type_info_for[i])
-            g_base_info_unref((GIBaseInfo *)type_info_for[i]);
-
     JS::RootedValue rval(context);
     gjs_closure_invoke(closure, argv, &rval);
 
@@ -770,7 +805,7 @@ gjs_value_from_g_value_internal(JSContext             *context,
                                 JS::MutableHandleValue value_p,
                                 const GValue          *gvalue,
                                 bool                   no_copy,
-                                GSignalQuery          *signal_query,
+                                GjsSignalCache        *signal,
                                 int                    arg_n)
 {
     GType gtype;
@@ -912,43 +947,23 @@ gjs_value_from_g_value_internal(JSContext             *context,
 
         obj = gjs_param_from_g_param(context, gparam);
         value_p.setObjectOrNull(obj);
-    } else if (signal_query && g_type_is_a(gtype, G_TYPE_POINTER)) {
-        bool res;
+    } else if (signal && g_type_is_a(gtype, G_TYPE_POINTER)) {
         GArgument arg;
-        GIArgInfo *arg_info;
-        GIBaseInfo *obj;
-        GISignalInfo *signal_info;
-        GITypeInfo type_info;
+        GITypeInfo *type_info = signal->type_info_for[arg_n];
 
-        obj = g_irepository_find_by_gtype(NULL, signal_query->itype);
-        if (!obj) {
+        if (type_info == NULL) {
             gjs_throw(context, "Signal argument with GType %s isn't introspectable",
-                      g_type_name(signal_query->itype));
-            return false;
-        }
-
-        signal_info = g_object_info_find_signal((GIObjectInfo*)obj, signal_query->signal_name);
-
-        if (!signal_info) {
-            gjs_throw(context, "Unknown signal.");
-            g_base_info_unref((GIBaseInfo*)obj);
+                      g_type_name(signal->query.itype));
             return false;
         }
-        arg_info = g_callable_info_get_arg(signal_info, arg_n - 1);
-        g_arg_info_load_type(arg_info, &type_info);
 
         g_assert(((void) "Check gjs_value_from_array_and_length_values() before"
                   " calling gjs_value_from_g_value_internal()",
-                  g_type_info_get_array_length(&type_info) == -1));
+                  g_type_info_get_array_length(type_info) == -1));
 
         arg.v_pointer = g_value_get_pointer(gvalue);
 
-        res = gjs_value_from_g_argument(context, value_p, &type_info, &arg, true);
-
-        g_base_info_unref((GIBaseInfo*)arg_info);
-        g_base_info_unref((GIBaseInfo*)signal_info);
-        g_base_info_unref((GIBaseInfo*)obj);
-        return res;
+        return gjs_value_from_g_argument(context, value_p, type_info, &arg, true);
     } else if (g_type_is_a(gtype, G_TYPE_POINTER)) {
         gpointer pointer;
 
@@ -22,18 +22,23 @@
  */
 
 #include <config.h>
+#include <errno.h>
+#include <math.h>
 #include <string.h>
 #include <glib.h>
 #include "byteArray.h"
 #include "gi/boxed.h"
 #include "jsapi-wrapper.h"
 #include "jsapi-util-args.h"
+#include "mem.h"
 #include <girepository.h>
 #include <util/log.h>
 
 typedef struct {
     GByteArray *array;
     GBytes     *bytes;
+    gsize       accounted_len; /* length in the memory accounting */
+    bool        accounted;
 } ByteArrayInstance;
 
 extern struct JSClass gjs_byte_array_class;
@@ -95,6 +100,63 @@ byte_array_ensure_array (ByteArrayInstance  *priv)
     }
 }
 
+static inline void
+byte_array_peek(ByteArrayInstance *priv,
+                guint8           **data_p,
+                gsize             *len_p)
+{
+    if (priv->array != NULL) {
+        *data_p = priv->array->data;
+        *len_p = priv->array->len;
+    } else if (priv->bytes != NULL) {
+        *data_p = (guint8 *) g_bytes_get_data(priv->bytes, len_p);
+    } else {
+        g_assert_not_reached();
+    }
+}
+
+static gsize
+byte_array_get_length(ByteArrayInstance *priv)
+{
+    if (priv->array != NULL)
+        return priv->array->len;
+    else if (priv->bytes != NULL)
+        return g_bytes_get_size(priv->bytes);
+    return 0;
+}
+
+/* Brings the per-type memory accounting up to date with the current
+ * length, and reports any growth to the GC scheduler so that large byte
+ * arrays are taken into account when deciding to collect. Since C code
+ * can resize the array too, this only catches up when we next touch it. */
+static void
+byte_array_account(JSContext         *context,
+                   ByteArrayInstance *priv)
+{
+    gsize len = byte_array_get_length(priv);
+
+    if (priv->accounted && len == priv->accounted_len)
+        return;
+
+    gjs_memory_account_type("byteArray", g_intern_static_string("ByteArray"),
+                            priv->accounted ? 0 : 1,
+                            (gint64) len - (gint64) priv->accounted_len);
+    if (len > priv->accounted_len)
+        gjs_gc_note_native_alloc(context, len - priv->accounted_len);
+
+    priv->accounted = true;
+    priv->accounted_len = len;
+}
+
+static void
+byte_array_set_size(JSContext         *context,
+                    ByteArrayInstance *priv,
+                    gsize              len)
+{
+    g_byte_array_set_size(priv->array, len);
+    byte_array_account(context, priv);
+}
+
 static void
 byte_array_ensure_gbytes (ByteArrayInstance  *priv)
 {
@@ -167,8 +229,9 @@ byte_array_get_index(JSContext         *context,
 {
     gsize len;
     guint8 *data;
-    
-    gjs_byte_array_peek_data(context, obj, &data, &len);
+
+    /* Reading doesn't need a GByteArray, so a GBytes isn't converted */
+    byte_array_peek(priv, &data, &len);
 
     if (idx >= len) {
         gjs_throw(context,
@@ -199,6 +262,11 @@ byte_array_get_prop(JSContext *context,
     if (priv == NULL)
         return true; /* prototype, not an instance. */
 
+    /* Integer ids are never negative, so the common case of indexing with
+     * a small integer skips the conversion to a value */
+    if (JSID_IS_INT(id))
+        return byte_array_get_index(context, obj, priv, JSID_TO_INT(id), value_p);
+
     JS::RootedValue id_value(context);
     if (!JS_IdToValue(context, id, &id_value))
         return false;
@@ -255,7 +323,7 @@ byte_array_length_setter(JSContext *context,
                   "Can't set ByteArray length to non-integer");
         return false;
     }
-    g_byte_array_set_size(priv->array, len);
+    byte_array_set_size(context, priv, len);
     args.rval().setUndefined();
     return true;
 }
@@ -269,16 +337,16 @@ byte_array_set_index(JSContext         *context,
 {
     guint8 v;
 
-    if (!gjs_value_to_byte(context, value_p, &v)) {
+    if (value_p.isInt32() && (guint32) value_p.toInt32() < 256)
+        v = value_p.toInt32();
+    else if (!gjs_value_to_byte(context, value_p, &v))
         return false;
-    }
 
     byte_array_ensure_array(priv);
 
     /* grow the array if necessary */
     if (idx >= priv->array->len) {
-        g_byte_array_set_size(priv->array,
-                              idx + 1);
+        byte_array_set_size(context, priv, idx + 1);
     }
 
     g_array_index(priv->array, guint8, idx) = v;
@@ -306,6 +374,9 @@ byte_array_set_prop(JSContext *context,
     if (priv == NULL)
         return true; /* prototype, not an instance. */
 
+    if (JSID_IS_INT(id))
+        return byte_array_set_index(context, obj, priv, JSID_TO_INT(id), value_p);
+
     JS::RootedValue id_value(context);
     if (!JS_IdToValue(context, id, &id_value))
         return false;
@@ -366,6 +437,7 @@ GJS_NATIVE_CONSTRUCTOR_DECLARE(byte_array)
 
     priv = g_slice_new0(ByteArrayInstance);
     priv->array = gjs_g_byte_array_new(preallocated_length);
+    byte_array_account(context, priv);
     g_assert(priv_from_js(context, object) == NULL);
     JS_SetPrivate(object, priv);
 
@@ -385,6 +457,10 @@ byte_array_finalize(JSFreeOp *fop,
     if (priv == NULL)
         return; /* prototype, not instance */
 
+    if (priv->accounted)
+        gjs_memory_account_type("byteArray", g_intern_static_string("ByteArray"),
+                                -1, -(gint64) priv->accounted_len);
+
     if (priv->array) {
         g_byte_array_free(priv->array, true);
         priv->array = NULL;
@@ -395,6 +471,164 @@ byte_array_finalize(JSFreeOp *fop,
     g_slice_free(ByteArrayInstance, priv);
 }
 
+/* iconv descriptors are costly to open, so each thread keeps the ones it
+ * has used, keyed by "to\nfrom" codesets. */
+static GPrivate converters = G_PRIVATE_INIT((GDestroyNotify) g_hash_table_unref);
+
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+#define UTF16_HOST_ENDIAN "UTF-16LE"
+#else
+#define UTF16_HOST_ENDIAN "UTF-16BE"
+#endif
+
+static void
+converter_close(gpointer data)
+{
+    g_iconv_close((GIConv) data);
+}
+
+static GIConv
+get_converter(const char *to_codeset,
+              const char *from_codeset,
+              GError    **error)
+{
+    GHashTable *table = (GHashTable *) g_private_get(&converters);
+    GIConv converter;
+    char *key;
+
+    if (table == NULL) {
+        table = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                      g_free, converter_close);
+        g_private_set(&converters, table);
+    }
+
+    key = g_strconcat(to_codeset, "\n", from_codeset, NULL);
+    converter = (GIConv) g_hash_table_lookup(table, key);
+    if (converter != NULL) {
+        /* Clear any state left from the last conversion */
+        g_iconv(converter, NULL, NULL, NULL, NULL);
+        g_free(key);
+        return converter;
+    }
+
+    converter = g_iconv_open(to_codeset, from_codeset);
+    if (converter == (GIConv) -1) {
+        g_set_error(error, G_CONVERT_ERROR, G_CONVERT_ERROR_NO_CONVERSION,
+                    "Conversion from character set '%s' to '%s' is not supported",
+                    from_codeset, to_codeset);
+        g_free(key);
+        return converter;
+    }
+
+    g_hash_table_insert(table, key, converter);
+    return converter;
+}
+
+/* Converts @in_len bytes of @in, appending the result to @out; unlike
+ * g_convert() this doesn't go through a temporary buffer.
+ *
+ * If @partial_p is not %NULL, the input is a chunk of a stream: an
+ * incomplete sequence at its end is not an error, its length is stored in
+ * @partial_p, and @converter keeps its shift state for the next chunk.
+ * Otherwise @converter is flushed at the end of the input.
+ */
+static bool
+convert_into(GIConv      converter,
+             const char *in,
+             gsize       in_len,
+             GByteArray *out,
+             gsize      *partial_p,
+             GError    **error)
+{
+    char *inbuf = (char *) in;
+    gsize in_left = in_len;
+    gsize written = out->len;
+    gsize room = in_len + 16;
+    bool flushing = false;
+
+    if (partial_p != NULL)
+        *partial_p = 0;
+
+    while (true) {
+        char *outbuf;
+        gsize out_left, res;
+
+        g_byte_array_set_size(out, written + room);
+        outbuf = (char *) out->data + written;
+        out_left = room;
+
+        /* Once the input is consumed, flush any pending shift sequence */
+        if (flushing)
+            res = g_iconv(converter, NULL, NULL, &outbuf, &out_left);
+        else
+            res = g_iconv(converter, &inbuf, &in_left, &outbuf, &out_left);
+
+        written += room - out_left;
+
+        if (res != (gsize) -1) {
+            if (flushing || partial_p != NULL)
+                break;
+            flushing = true;
+        } else if (errno == E2BIG) {
+            room = MAX(room, in_left * 2 + 16);
+        } else if (errno == EINVAL && partial_p != NULL) {
+            *partial_p = in_left;
+            break;
+        } else {
+            if (errno == EILSEQ)
+                g_set_error_literal(error, G_CONVERT_ERROR,
+                                    G_CONVERT_ERROR_ILLEGAL_SEQUENCE,
+                                    "Invalid byte sequence in conversion input");
+            else if (errno == EINVAL)
+                g_set_error_literal(error, G_CONVERT_ERROR,
+                                    G_CONVERT_ERROR_PARTIAL_INPUT,
+                                    "Partial character sequence at end of input");
+            else
+                g_set_error(error, G_CONVERT_ERROR, G_CONVERT_ERROR_FAILED,
+                            "Error during conversion: %s", g_strerror(errno));
+            g_byte_array_set_size(out, written);
+            return false;
+        }
+    }
+
+    g_byte_array_set_size(out, written);
+    return true;
+}
+
+/* Makes a JS string out of host-endian UTF-16 in @u16, which is consumed;
+ * the string takes over its buffer instead of copying it. */
+static bool
+string_from_utf16_array(JSContext             *context,
+                        GByteArray            *u16,
+                        JS::MutableHandleValue value_p)
+{
+    static const guint8 nul[2] = { 0, 0 };
+    gsize n_units;
+    char16_t *u16_chars;
+    JSString *s;
+
+    g_assert((u16->len % 2) == 0);
+    n_units = u16->len / 2;
+    if (n_units == 0) {
+        g_byte_array_free(u16, true);
+        value_p.set(JS_GetEmptyStringValue(context));
+        return true;
+    }
+
+    g_byte_array_append(u16, nul, sizeof(nul));
+    u16_chars = (char16_t *) g_byte_array_free(u16, false);
+
+    /* Avoid a copy - assumes that g_malloc == js_malloc == malloc */
+    s = JS_NewUCString(context, u16_chars, n_units);
+    if (s == NULL) {
+        g_free(u16_chars);
+        return false;
+    }
+
+    value_p.setString(s);
+    return true;
+}
+
 /* implement toString() with an optional encoding arg */
 static bool
 to_string_func(JSContext *context,
@@ -402,85 +636,58 @@ to_string_func(JSContext *context,
                JS::Value *vp)
 {
     GJS_GET_PRIV(context, argc, vp, argv, to, ByteArrayInstance, priv);
-    char *encoding;
-    bool encoding_is_utf8;
-    gchar *data;
+    char *encoding = NULL;
+    guint8 *data;
+    gsize len;
 
     if (priv == NULL)
         return true; /* prototype, not instance */
 
-    byte_array_ensure_array(priv);
-
     if (argc >= 1 && argv[0].isString()) {
         if (!gjs_string_to_utf8(context, argv[0], &encoding))
             return false;
 
         /* maybe we should be smarter about utf8 synonyms here.
-         * doesn't matter much though. encoding_is_utf8 is
+         * doesn't matter much though. Treating it separately is
          * just an optimization anyway.
          */
-        if (strcmp(encoding, "UTF-8") == 0) {
-            encoding_is_utf8 = true;
-            g_free(encoding);
-            encoding = NULL;
-        } else {
-            encoding_is_utf8 = false;
-        }
-    } else {
-        encoding_is_utf8 = true;
+        if (strcmp(encoding, "UTF-8") == 0)
+            g_clear_pointer(&encoding, g_free);
     }
 
-    if (priv->array->len == 0)
+    byte_array_peek(priv, &data, &len);
+    if (len == 0)
         /* the internal data pointer could be NULL in this case */
-        data = (gchar*)"";
-    else
-        data = (gchar*)priv->array->data;
+        data = (guint8 *) "";
 
-    if (encoding_is_utf8) {
+    if (encoding == NULL) {
         /* optimization, avoids iconv overhead and runs
-         * libmozjs hardwired utf8-to-utf16
+         * libmozjs hardwired utf8-to-utf16; ASCII is only widened
          */
-        return gjs_string_from_utf8(context, data, priv->array->len,
+        return gjs_string_from_utf8(context, (const char *) data, len,
                                     argv.rval());
     } else {
-        bool ok = false;
-        gsize bytes_written;
-        GError *error;
-        JSString *s;
-        char *u16_str;
-        char16_t *u16_out;
-
-        error = NULL;
-        u16_str = g_convert(data,
-                           priv->array->len,
-                           "UTF-16",
-                           encoding,
-                           NULL, /* bytes read */
-                           &bytes_written,
-                           &error);
+        GError *error = NULL;
+        GIConv converter;
+        GByteArray *u16;
+
+        converter = get_converter(UTF16_HOST_ENDIAN, encoding, &error);
         g_free(encoding);
-        if (u16_str == NULL) {
+        if (converter == (GIConv) -1) {
             /* frees the GError */
             gjs_throw_g_error(context, error);
             return false;
         }
 
-        /* bytes_written should be bytes in a UTF-16 string so
-         * should be a multiple of 2
-         */
-        g_assert((bytes_written % 2) == 0);
-
-        u16_out = g_new(char16_t, bytes_written / 2);
-        memcpy(u16_out, u16_str, bytes_written);
-        s = JS_NewUCStringCopyN(context, u16_out, bytes_written / 2);
-        if (s != NULL) {
-            ok = true;
-            argv.rval().setString(s);
+        /* Convert straight into the buffer that the string will adopt */
+        u16 = g_byte_array_sized_new(len * 2 + 2);
+        if (!convert_into(converter, (const char *) data, len, u16, NULL, &error)) {
+            g_byte_array_free(u16, true);
+            gjs_throw_g_error(context, error);
+            return false;
         }
 
-        g_free(u16_str);
-        g_free(u16_out);
-        return ok;
+        return string_from_utf16_array(context, u16, argv.rval());
     }
 }
 
@@ -549,8 +756,9 @@ from_string_func(JSContext *context,
 {
     JS::CallArgs argv = JS::CallArgsFromVp (argc, vp);
     ByteArrayInstance *priv;
-    char *encoding;
-    bool encoding_is_utf8;
+    char *encoding = NULL;
+    const char16_t *u16_chars;
+    gsize u16_len;
     JS::RootedObject obj(context, byte_array_new(context));
 
     if (obj == NULL)
@@ -574,65 +782,62 @@ from_string_func(JSContext *context,
             return false;
 
         /* maybe we should be smarter about utf8 synonyms here.
-         * doesn't matter much though. encoding_is_utf8 is
+         * doesn't matter much though. Treating it separately is
          * just an optimization anyway.
          */
-        if (strcmp(encoding, "UTF-8") == 0) {
-            encoding_is_utf8 = true;
-            g_free(encoding);
-            encoding = NULL;
-        } else {
-            encoding_is_utf8 = false;
-        }
-    } else {
-        encoding_is_utf8 = true;
+        if (strcmp(encoding, "UTF-8") == 0)
+            g_clear_pointer(&encoding, g_free);
     }
 
-    if (encoding_is_utf8) {
-        /* optimization? avoids iconv overhead and runs
-         * libmozjs hardwired utf16-to-utf8.
-         */
-        char *utf8 = NULL;
-        if (!gjs_string_to_utf8(context,
-                                argv[0],
-                                &utf8))
-            return false;
+    u16_chars = JS_GetStringCharsAndLength(context, argv[0].toString(), &u16_len);
+    if (u16_chars == NULL) {
+        g_free(encoding);
+        return false;
+    }
+
+    if (encoding == NULL) {
+        char16_t bits = 0;
+        gsize i;
+
+        /* Both loops are simple enough for the compiler to vectorize */
+        for (i = 0; i < u16_len; i++)
+            bits |= u16_chars[i];
 
-        g_byte_array_set_size(priv->array, 0);
-        g_byte_array_append(priv->array, (guint8*) utf8, strlen(utf8));
-        g_free(utf8);
+        if (bits < 0x80) {
+            /* ASCII is narrowed straight into the array */
+            g_byte_array_set_size(priv->array, u16_len);
+            for (i = 0; i < u16_len; i++)
+                priv->array->data[i] = u16_chars[i];
+        } else {
+            /* optimization? avoids iconv overhead and runs
+             * libmozjs hardwired utf16-to-utf8.
+             */
+            char *utf8 = NULL;
+            if (!gjs_string_to_utf8(context,
+                                    argv[0],
+                                    &utf8))
+                return false;
+
+            g_byte_array_append(priv->array, (guint8*) utf8, strlen(utf8));
+            g_free(utf8);
+        }
     } else {
-        char *encoded;
-        gsize bytes_written;
-        GError *error;
-        const char16_t *u16_chars;
-        gsize u16_len;
-
-        u16_chars = JS_GetStringCharsAndLength(context, argv[0].toString(), &u16_len);
-        if (u16_chars == NULL)
-            return false;
+        GError *error = NULL;
+        GIConv converter;
 
-        error = NULL;
-        encoded = g_convert((char*) u16_chars,
-                            u16_len * 2,
-                            encoding, /* to_encoding */
-                            "UTF-16", /* from_encoding */
-                            NULL, /* bytes read */
-                            &bytes_written,
-                            &error);
+        converter = get_converter(encoding, UTF16_HOST_ENDIAN, &error);
         g_free(encoding);
-        if (encoded == NULL) {
+        if (converter == (GIConv) -1 ||
+            !convert_into(converter, (const char *) u16_chars, u16_len * 2,
+                          priv->array, NULL, &error)) {
             /* frees the GError */
             gjs_throw_g_error(context, error);
             return false;
         }
-
-        g_byte_array_set_size(priv->array, 0);
-        g_byte_array_append(priv->array, (guint8*) encoded, bytes_written);
-
-        g_free(encoded);
     }
 
+    byte_array_account(context, priv);
+
     argv.rval().setObject(*obj);
     return true;
 }
@@ -660,6 +865,18 @@ from_array_func(JSContext *context,
     priv->array = gjs_g_byte_array_new(0);
 
     JS::RootedObject array_obj(context, &argv[0].toObject());
+
+    /* Byte-sized typed arrays are copied in one go */
+    if (JS_IsUint8Array(array_obj) || JS_IsUint8ClampedArray(array_obj)) {
+        len = JS_GetTypedArrayLength(array_obj);
+        byte_array_set_size(context, priv, len);
+        if (len > 0)
+            memcpy(priv->array->data, JS_GetArrayBufferViewData(array_obj), len);
+
+        argv.rval().setObject(*obj);
+        return true;
+    }
+
     if (!JS_IsArrayObject(context, array_obj)) {
         gjs_throw(context,
                   "byteArray.fromArray() called with non-array as first arg");
@@ -672,7 +889,7 @@ from_array_func(JSContext *context,
         return false;
     }
 
-    g_byte_array_set_size(priv->array, len);
+    byte_array_set_size(context, priv, len);
 
     JS::RootedValue elem(context);
     for (i = 0; i < len; ++i) {
@@ -725,122 +942,1174 @@ from_gbytes_func(JSContext *context,
     g_assert (priv != NULL);
 
     priv->bytes = g_bytes_ref(gbytes);
+    byte_array_account(context, priv);
 
     argv.rval().setObject(*obj);
     return true;
 }
 
-JSObject *
-gjs_byte_array_from_byte_array (JSContext *context,
-                                GByteArray *array)
+/* toUint8Array() function implementation, copies the contents of a
+ * GBytes or a ByteArray into a Uint8Array in one go */
+static bool
+to_uint8_array_func(JSContext *context,
+                    unsigned   argc,
+                    JS::Value *vp)
 {
-    ByteArrayInstance *priv;
+    JS::CallArgs argv = JS::CallArgsFromVp (argc, vp);
+    JS::RootedObject bytes_obj(context);
+    guint8 *data;
+    gsize len;
 
-    g_return_val_if_fail(context != NULL, NULL);
-    g_return_val_if_fail(array != NULL, NULL);
+    if (!gjs_parse_call_args(context, "toUint8Array", argv, "o",
+                             "bytes", &bytes_obj))
+        return false;
 
-    JS::RootedObject proto(context, byte_array_get_prototype(context));
-    JS::RootedObject object(context,
-        JS_NewObject(context, &gjs_byte_array_class, proto, JS::NullPtr()));
+    if (gjs_typecheck_bytearray(context, bytes_obj, false)) {
+        gjs_byte_array_peek_data(context, bytes_obj, &data, &len);
+    } else {
+        GBytes *gbytes;
 
-    if (!object) {
-        gjs_throw(context, "failed to create byte array");
-        return NULL;
+        if (!gjs_typecheck_boxed(context, bytes_obj, NULL, G_TYPE_BYTES, true))
+            return false;
+
+        gbytes = (GBytes*) gjs_c_struct_from_boxed(context, bytes_obj);
+        data = (guint8 *) g_bytes_get_data(gbytes, &len);
     }
 
-    priv = g_slice_new0(ByteArrayInstance);
-    g_assert(priv_from_js(context, object) == NULL);
-    JS_SetPrivate(object, priv);
-    priv->array = g_byte_array_new();
-    priv->array->data = (guint8*) g_memdup(array->data, array->len);
-    priv->array->len = array->len;
+    if (len > G_MAXUINT32) {
+        gjs_throw(context, "%" G_GSIZE_FORMAT " bytes is too large for a "
+                  "Uint8Array", len);
+        return false;
+    }
 
-    return object;
+    JS::RootedObject obj(context, JS_NewUint8Array(context, len));
+    if (obj == NULL)
+        return false;
+
+    if (len > 0)
+        memcpy(JS_GetArrayBufferViewData(obj), data, len);
+
+    argv.rval().setObject(*obj);
+    return true;
 }
 
-GBytes *
-gjs_byte_array_get_bytes (JSContext       *context,
-                          JS::HandleObject object)
+/* Converts an index argument to an integer, like ToInteger() in the spec */
+static bool
+byte_array_index_to_integer(JSContext      *context,
+                            JS::HandleValue value,
+                            double         *d_p)
 {
-    ByteArrayInstance *priv;
-    priv = priv_from_js(context, object);
-    g_assert(priv != NULL);
+    double d;
 
-    byte_array_ensure_gbytes(priv);
+    if (value.isInt32()) {
+        *d_p = value.toInt32();
+        return true;
+    }
 
-    return g_bytes_ref (priv->bytes);
+    if (!JS::ToNumber(context, value, &d))
+        return false;
+    if (mozilla::IsNaN(d))
+        d = 0;
+    *d_p = d < 0 ? ceil(d) : floor(d);
+    return true;
 }
 
-GByteArray *
-gjs_byte_array_get_byte_array (JSContext       *context,
-                               JS::HandleObject obj)
+/* Converts an optional index argument of the bulk operations below the
+ * way typed arrays do: negative values count from the end, and the result
+ * is clamped to [0, len]. */
+static bool
+byte_array_relative_index(JSContext      *context,
+                          JS::HandleValue value,
+                          gsize           len,
+                          gsize           default_idx,
+                          gsize          *idx_p)
 {
-    ByteArrayInstance *priv;
-    priv = priv_from_js(context, obj);
-    g_assert(priv != NULL);
+    double d;
 
-    byte_array_ensure_array(priv);
+    if (value.isUndefined()) {
+        *idx_p = default_idx;
+        return true;
+    }
 
-    return g_byte_array_ref (priv->array);
+    if (!byte_array_index_to_integer(context, value, &d))
+        return false;
+
+    if (d < 0)
+        d = MAX(d + len, 0);
+    *idx_p = (gsize) MIN(d, (double) len);
+    return true;
 }
 
-void
-gjs_byte_array_peek_data (JSContext       *context,
-                          JS::HandleObject obj,
-                          guint8         **out_data,
-                          gsize           *out_len)
+/* Gets the contents of a ByteArray, Uint8Array or Uint8ClampedArray
+ * argument. A typed array's data may move in the next GC, so use it before
+ * allocating anything. */
+static bool
+byte_array_peek_arg(JSContext      *context,
+                    JS::HandleValue value,
+                    const char     *func_name,
+                    guint8        **data_p,
+                    gsize          *len_p)
+{
+    if (value.isObject()) {
+        JS::RootedObject obj(context, &value.toObject());
+
+        if (gjs_typecheck_bytearray(context, obj, false)) {
+            gjs_byte_array_peek_data(context, obj, data_p, len_p);
+            return true;
+        }
+
+        if (JS_IsUint8Array(obj) || JS_IsUint8ClampedArray(obj)) {
+            *data_p = (guint8 *) JS_GetArrayBufferViewData(obj);
+            *len_p = JS_GetTypedArrayLength(obj);
+            return true;
+        }
+    }
+
+    gjs_throw(context, "%s() needs a ByteArray or Uint8Array argument",
+              func_name);
+    return false;
+}
+
+/* Returns a new ByteArray of @len zeroed bytes */
+static JSObject *
+byte_array_new_sized(JSContext *context,
+                     gsize      len)
 {
     ByteArrayInstance *priv;
+    JS::RootedObject obj(context, byte_array_new(context));
+
+    if (obj == NULL)
+        return NULL;
+
     priv = priv_from_js(context, obj);
-    g_assert(priv != NULL);
-    
-    if (priv->array != NULL) {
-        *out_data = (guint8*)priv->array->data;
-        *out_len = (gsize)priv->array->len;
-    } else if (priv->bytes != NULL) {
-        *out_data = (guint8*)g_bytes_get_data(priv->bytes, out_len);
-    } else {
-        g_assert_not_reached();
-    }
+    priv->array = gjs_g_byte_array_new(len);
+    byte_array_account(context, priv);
+
+    return obj;
 }
 
-JSPropertySpec gjs_byte_array_proto_props[] = {
-    JS_PSGS("length", byte_array_length_getter, byte_array_length_setter,
-            JSPROP_PERMANENT),
-    JS_PS_END
-};
+/* slice() function implementation */
+static bool
+slice_func(JSContext *context,
+           unsigned   argc,
+           JS::Value *vp)
+{
+    GJS_GET_PRIV(context, argc, vp, argv, to, ByteArrayInstance, priv);
+    gsize len, start, end;
+    guint8 *data;
 
-JSFunctionSpec gjs_byte_array_proto_funcs[] = {
-    JS_FS("toString", to_string_func, 0, 0),
-    JS_FS("toGBytes", to_gbytes_func, 0, 0),
-    JS_FS_END
-};
+    if (priv == NULL)
+        return true; /* prototype, not instance */
 
-static JSFunctionSpec gjs_byte_array_module_funcs[] = {
-    JS_FS("fromString", from_string_func, 1, 0),
-    JS_FS("fromArray", from_array_func, 1, 0),
-    JS_FS("fromGBytes", from_gbytes_func, 1, 0),
-    JS_FS_END
-};
+    len = byte_array_get_length(priv);
+    if (!byte_array_relative_index(context, argv.get(0), len, 0, &start) ||
+        !byte_array_relative_index(context, argv.get(1), len, len, &end))
+        return false;
 
-bool
-gjs_define_byte_array_stuff(JSContext              *context,
-                            JS::MutableHandleObject module)
+    /* valueOf() of the arguments could have resized us */
+    len = byte_array_get_length(priv);
+    end = MIN(end, len);
+    start = MIN(start, end);
+
+    JS::RootedObject obj(context, byte_array_new_sized(context, end - start));
+    if (obj == NULL)
+        return false;
+
+    byte_array_peek(priv, &data, &len);
+    if (end > start)
+        memcpy(priv_from_js(context, obj)->array->data, data + start, end - start);
+
+    argv.rval().setObject(*obj);
+    return true;
+}
+
+/* Shared by indexOf() and lastIndexOf(); the needle is either a byte value
+ * or a sequence of bytes. */
+static bool
+byte_array_find(JSContext *context,
+                unsigned   argc,
+                JS::Value *vp,
+                bool       reverse)
 {
-    JSObject *prototype;
+    GJS_GET_PRIV(context, argc, vp, argv, to, ByteArrayInstance, priv);
+    gsize len, from, needle_len;
+    guint8 byte, *data, *needle;
+    gssize found = -1;
+    bool before_start = false;
 
-    module.set(JS_NewObject(context, NULL, JS::NullPtr(), JS::NullPtr()));
+    if (priv == NULL)
+        return true; /* prototype, not instance */
 
-    prototype = JS_InitClass(context, module, JS::NullPtr(),
-                             &gjs_byte_array_class,
-                             gjs_byte_array_constructor,
-                             0,
-                             &gjs_byte_array_proto_props[0],
-                             &gjs_byte_array_proto_funcs[0],
-                             NULL,
-                             NULL);
+    len = byte_array_get_length(priv);
+    if (reverse && !argv.get(1).isUndefined()) {
+        double d;
 
-    if (!JS_DefineFunctions(context, module, &gjs_byte_array_module_funcs[0]))
+        /* lastIndexOf() from before the start finds nothing, rather than
+         * searching from 0 */
+        if (!byte_array_index_to_integer(context, argv[1], &d))
+            return false;
+        if (d < 0)
+            d += len;
+        before_start = d < 0;
+        from = (gsize) CLAMP(d, 0, (double) len);
+    } else if (!byte_array_relative_index(context, argv.get(1), len,
+                                          reverse ? len : 0, &from)) {
+        return false;
+    }
+
+    if (argv.get(0).isNumber()) {
+        if (!gjs_value_to_byte(context, argv[0], &byte))
+            return false;
+        needle = &byte;
+        needle_len = 1;
+    } else if (!byte_array_peek_arg(context, argv.get(0),
+                                    reverse ? "ByteArray.lastIndexOf" : "ByteArray.indexOf",
+                                    &needle, &needle_len)) {
+        return false;
+    }
+
+    byte_array_peek(priv, &data, &len);
+    from = MIN(from, len);
+
+    if (before_start) {
+        found = -1;
+    } else if (needle_len == 0) {
+        found = from;
+    } else if (needle_len <= len && !reverse) {
+        gsize last = len - needle_len;
+        gsize pos = from;
+
+        /* memchr() for the first byte is vectorized by the C library */
+        while (pos <= last) {
+            guint8 *hit = (guint8 *) memchr(data + pos, needle[0], last - pos + 1);
+            if (hit == NULL)
+                break;
+            pos = hit - data;
+            if (memcmp(hit, needle, needle_len) == 0) {
+                found = pos;
+                break;
+            }
+            pos++;
+        }
+    } else if (needle_len <= len) {
+        gsize pos = MIN(from, len - needle_len);
+
+        while (true) {
+            if (data[pos] == needle[0] &&
+                memcmp(data + pos, needle, needle_len) == 0) {
+                found = pos;
+                break;
+            }
+            if (pos == 0)
+                break;
+            pos--;
+        }
+    }
+
+    argv.rval().setNumber((double) found);
+    return true;
+}
+
+/* indexOf() function implementation */
+static bool
+index_of_func(JSContext *context,
+              unsigned   argc,
+              JS::Value *vp)
+{
+    return byte_array_find(context, argc, vp, false);
+}
+
+/* lastIndexOf() function implementation */
+static bool
+last_index_of_func(JSContext *context,
+                   unsigned   argc,
+                   JS::Value *vp)
+{
+    return byte_array_find(context, argc, vp, true);
+}
+
+/* copyWithin() function implementation */
+static bool
+copy_within_func(JSContext *context,
+                 unsigned   argc,
+                 JS::Value *vp)
+{
+    GJS_GET_PRIV(context, argc, vp, argv, to, ByteArrayInstance, priv);
+    gsize len, target, start, end;
+
+    if (priv == NULL)
+        return true; /* prototype, not instance */
+
+    len = byte_array_get_length(priv);
+    if (!byte_array_relative_index(context, argv.get(0), len, 0, &target) ||
+        !byte_array_relative_index(context, argv.get(1), len, 0, &start) ||
+        !byte_array_relative_index(context, argv.get(2), len, len, &end))
+        return false;
+
+    byte_array_ensure_array(priv);
+    len = priv->array->len;
+    target = MIN(target, len);
+    end = MIN(end, len);
+
+    if (end > start)
+        memmove(priv->array->data + target, priv->array->data + start,
+                MIN(end - start, len - target));
+
+    argv.rval().setObject(*to);
+    return true;
+}
+
+/* fill() function implementation */
+static bool
+fill_func(JSContext *context,
+          unsigned   argc,
+          JS::Value *vp)
+{
+    GJS_GET_PRIV(context, argc, vp, argv, to, ByteArrayInstance, priv);
+    gsize len, start, end;
+    guint8 v;
+
+    if (priv == NULL)
+        return true; /* prototype, not instance */
+
+    len = byte_array_get_length(priv);
+    if (!gjs_value_to_byte(context, argv.get(0), &v) ||
+        !byte_array_relative_index(context, argv.get(1), len, 0, &start) ||
+        !byte_array_relative_index(context, argv.get(2), len, len, &end))
+        return false;
+
+    byte_array_ensure_array(priv);
+    end = MIN(end, priv->array->len);
+
+    if (end > start)
+        memset(priv->array->data + start, v, end - start);
+
+    argv.rval().setObject(*to);
+    return true;
+}
+
+/* concat() function implementation, takes any number of ByteArrays or
+ * Uint8Arrays */
+static bool
+concat_func(JSContext *context,
+            unsigned   argc,
+            JS::Value *vp)
+{
+    GJS_GET_PRIV(context, argc, vp, argv, to, ByteArrayInstance, priv);
+    gsize total, len, offset;
+    guint8 *data, *dest;
+    unsigned i;
+
+    if (priv == NULL)
+        return true; /* prototype, not instance */
+
+    /* Sizes first, since allocating the result may move typed array data */
+    total = byte_array_get_length(priv);
+    for (i = 0; i < argc; i++) {
+        if (!byte_array_peek_arg(context, argv[i], "ByteArray.concat",
+                                 &data, &len))
+            return false;
+        total += len;
+    }
+
+    JS::RootedObject obj(context, byte_array_new_sized(context, total));
+    if (obj == NULL)
+        return false;
+    dest = priv_from_js(context, obj)->array->data;
+
+    byte_array_peek(priv, &data, &len);
+    memcpy(dest, data, len);
+    offset = len;
+
+    for (i = 0; i < argc; i++) {
+        byte_array_peek_arg(context, argv[i], "ByteArray.concat", &data, &len);
+        memcpy(dest + offset, data, len);
+        offset += len;
+    }
+
+    argv.rval().setObject(*obj);
+    return true;
+}
+
+/* compare() function implementation; orders byte by byte like memcmp(),
+ * then shorter arrays first */
+static bool
+compare_func(JSContext *context,
+             unsigned   argc,
+             JS::Value *vp)
+{
+    GJS_GET_PRIV(context, argc, vp, argv, to, ByteArrayInstance, priv);
+    guint8 *data, *other_data;
+    gsize len, other_len;
+    int result;
+
+    if (priv == NULL)
+        return true; /* prototype, not instance */
+
+    if (!byte_array_peek_arg(context, argv.get(0), "ByteArray.compare",
+                             &other_data, &other_len))
+        return false;
+    byte_array_peek(priv, &data, &len);
+
+    result = memcmp(data, other_data, MIN(len, other_len));
+    if (result == 0)
+        result = len < other_len ? -1 : len > other_len ? 1 : 0;
+
+    argv.rval().setInt32(result < 0 ? -1 : result > 0 ? 1 : 0);
+    return true;
+}
+
+/* Decoder keeps state between chunks of a stream, in the spirit of
+ * TextDecoder with {stream: true}, while each Encoder.encodeInto() call is
+ * self-contained like TextEncoder.encodeInto(). UTF-8 is handled directly;
+ * other encodings get an iconv descriptor of their own, since it carries
+ * the shift state of a conversion.
+ */
+
+typedef struct {
+    GIConv converter;   /* (GIConv) -1 for UTF-8 */
+    guint8 pending[16]; /* incomplete sequence at the end of the last chunk */
+    gsize  n_pending;
+} ByteArrayDecoder;
+
+typedef struct {
+    GIConv converter;   /* (GIConv) -1 for UTF-8 */
+} ByteArrayEncoder;
+
+extern struct JSClass gjs_byte_array_decoder_class;
+extern struct JSClass gjs_byte_array_encoder_class;
+
+static bool
+open_stream_converter(JSContext      *context,
+                      JS::HandleValue encoding_value,
+                      bool            decoding,
+                      GIConv         *converter_p)
+{
+    char *encoding;
+
+    *converter_p = (GIConv) -1;
+    if (encoding_value.isUndefined())
+        return true;
+
+    if (!gjs_string_to_utf8(context, encoding_value, &encoding))
+        return false;
+
+    if (strcmp(encoding, "UTF-8") != 0) {
+        const char *to_codeset = decoding ? UTF16_HOST_ENDIAN : encoding;
+        const char *from_codeset = decoding ? encoding : UTF16_HOST_ENDIAN;
+
+        *converter_p = g_iconv_open(to_codeset, from_codeset);
+        if (*converter_p == (GIConv) -1) {
+            gjs_throw(context,
+                      "Conversion from character set '%s' to '%s' is not supported",
+                      from_codeset, to_codeset);
+            g_free(encoding);
+            return false;
+        }
+    }
+
+    g_free(encoding);
+    return true;
+}
+
+static gsize
+utf8_sequence_length(guint8 lead)
+{
+    /* Stray continuation bytes count as 1, and fail validation later */
+    if (lead < 0xc0)
+        return 1;
+    if (lead < 0xe0)
+        return 2;
+    if (lead < 0xf0)
+        return 3;
+    if (lead < 0xf8)
+        return 4;
+    return 1;
+}
+
+/* A missing chunk is an empty one, which ends the stream */
+static bool
+decoder_peek_input(JSContext      *context,
+                   JS::HandleValue value,
+                   guint8        **data_p,
+                   gsize          *len_p)
+{
+    if (value.isUndefined() || value.isNull()) {
+        *data_p = (guint8 *) "";
+        *len_p = 0;
+        return true;
+    }
+
+    if (!byte_array_peek_arg(context, value, "Decoder.decode", data_p, len_p))
+        return false;
+
+    /* iconv() takes a NULL input buffer as a request to flush */
+    if (*len_p == 0)
+        *data_p = (guint8 *) "";
+    return true;
+}
+
+/* Unlike gjs_string_from_utf8(), which stops at the first nul byte as
+ * toString() always has, the decoder keeps the nul bytes in its output */
+static bool
+string_from_utf8_with_nuls(JSContext             *context,
+                           const char            *data,
+                           gsize                  len,
+                           JS::MutableHandleValue value_p)
+{
+    static const gunichar2 nul_unit = 0;
+    const char *end = data + len;
+    const char *nul;
+    GByteArray *u16;
+
+    nul = (const char *) memchr(data, '\0', len);
+    if (nul == NULL)
+        return gjs_string_from_utf8(context, data, len, value_p);
+
+    /* No JS allocation happens until the string is made, so @data, which
+     * may belong to a typed array, stays valid */
+    u16 = g_byte_array_sized_new(len * 2 + 2);
+    while (true) {
+        const char *segment_end = nul != NULL ? nul : end;
+        gunichar2 *units;
+        glong n_units;
+        GError *error = NULL;
+
+        units = g_utf8_to_utf16(data, segment_end - data, NULL, &n_units,
+                                &error);
+        if (units == NULL) {
+            g_byte_array_free(u16, true);
+            gjs_throw(context,
+                      "Failed to convert UTF-8 string to JS string: %s",
+                      error->message);
+            g_error_free(error);
+            return false;
+        }
+        g_byte_array_append(u16, (const guint8 *) units,
+                            n_units * sizeof(gunichar2));
+        g_free(units);
+
+        if (nul == NULL)
+            break;
+
+        g_byte_array_append(u16, (const guint8 *) &nul_unit,
+                            sizeof(nul_unit));
+        data = nul + 1;
+        nul = (const char *) memchr(data, '\0', end - data);
+    }
+
+    return string_from_utf16_array(context, u16, value_p);
+}
+
+static bool
+decode_utf8(JSContext             *context,
+            ByteArrayDecoder      *priv,
+            JS::HandleValue        input,
+            bool                   stream,
+            JS::MutableHandleValue value_p)
+{
+    guint8 *data, tail[4];
+    gsize len, taken = 0, n_tail = 0, body_len;
+    JS::RootedValue head(context), body(context);
+
+    if (!decoder_peek_input(context, input, &data, &len))
+        return false;
+
+    /* Complete the sequence left over from the last chunk */
+    if (priv->n_pending > 0) {
+        gsize needed = utf8_sequence_length(priv->pending[0]) - priv->n_pending;
+
+        taken = MIN(needed, len);
+        memcpy(priv->pending + priv->n_pending, data, taken);
+        priv->n_pending += taken;
+
+        if (priv->n_pending < utf8_sequence_length(priv->pending[0])) {
+            /* The whole chunk went into it, and it is still incomplete */
+            if (stream) {
+                value_p.set(JS_GetEmptyStringValue(context));
+                return true;
+            }
+
+            gjs_throw(context, "Partial character sequence at end of input");
+            return false;
+        }
+    }
+
+    /* Hold back an incomplete sequence at the end for the next chunk */
+    if (stream) {
+        gsize i, start = len - MIN(len - taken, 3);
+
+        for (i = len; i > start; i--) {
+            guint8 b = data[i - 1];
+
+            if ((b & 0xc0) == 0x80)
+                continue;
+            if (b >= 0xc0 && utf8_sequence_length(b) > len - (i - 1))
+                n_tail = len - (i - 1);
+            break;
+        }
+
+        memcpy(tail, data + len - n_tail, n_tail);
+    }
+
+    if (priv->n_pending > 0) {
+        if (!string_from_utf8_with_nuls(context, (const char *) priv->pending,
+                                        priv->n_pending, &head))
+            return false;
+        priv->n_pending = 0;
+    }
+
+    body_len = len - taken - n_tail;
+    if (body_len > 0) {
+        /* Creating the head string may have moved a typed array's data */
+        if (!decoder_peek_input(context, input, &data, &len) ||
+            !string_from_utf8_with_nuls(context, (const char *) data + taken,
+                                        body_len, &body))
+            return false;
+    } else {
+        body.set(JS_GetEmptyStringValue(context));
+    }
+
+    memcpy(priv->pending, tail, n_tail);
+    priv->n_pending = n_tail;
+
+    if (head.isUndefined()) {
+        value_p.set(body);
+        return true;
+    }
+
+    JS::RootedString head_str(context, head.toString());
+    JS::RootedString body_str(context, body.toString());
+    JSString *s = JS_ConcatStrings(context, head_str, body_str);
+    if (s == NULL)
+        return false;
+
+    value_p.setString(s);
+    return true;
+}
+
+static bool
+decode_iconv(JSContext             *context,
+             ByteArrayDecoder      *priv,
+             JS::HandleValue        input,
+             bool                   stream,
+             JS::MutableHandleValue value_p)
+{
+    GByteArray *u16, *joined = NULL;
+    guint8 *data;
+    gsize len, partial = 0;
+    GError *error = NULL;
+
+    if (!decoder_peek_input(context, input, &data, &len))
+        return false;
+
+    /* The sequence left over from the last chunk has to go first */
+    if (priv->n_pending > 0) {
+        joined = g_byte_array_sized_new(priv->n_pending + len);
+        g_byte_array_append(joined, priv->pending, priv->n_pending);
+        g_byte_array_append(joined, data, len);
+        data = joined->data;
+        len = joined->len;
+        priv->n_pending = 0;
+    }
+
+    u16 = g_byte_array_sized_new(len * 2 + 2);
+    if (!convert_into(priv->converter, (const char *) data, len, u16,
+                      stream ? &partial : NULL, &error)) {
+        g_byte_array_free(u16, true);
+        if (joined != NULL)
+            g_byte_array_free(joined, true);
+        /* frees the GError */
+        gjs_throw_g_error(context, error);
+        return false;
+    }
+
+    if (partial > sizeof(priv->pending)) {
+        g_byte_array_free(u16, true);
+        if (joined != NULL)
+            g_byte_array_free(joined, true);
+        gjs_throw(context, "Partial character sequence of %" G_GSIZE_FORMAT
+                  " bytes is too long", partial);
+        return false;
+    }
+
+    memcpy(priv->pending, data + len - partial, partial);
+    priv->n_pending = partial;
+
+    if (joined != NULL)
+        g_byte_array_free(joined, true);
+
+    return string_from_utf16_array(context, u16, value_p);
+}
+
+/* decode() implementation. decode(bytes, {stream: true}) keeps an
+ * incomplete sequence at the end of @bytes for the next call; decode()
+ * without {stream: true} ends the stream, and throws if a sequence is
+ * left incomplete. */
+static bool
+decoder_decode_func(JSContext *context,
+                    unsigned   argc,
+                    JS::Value *vp)
+{
+    GJS_GET_THIS(context, argc, vp, argv, to);
+    ByteArrayDecoder *priv;
+    bool stream = false, ok;
+
+    if (!gjs_typecheck_instance(context, to, &gjs_byte_array_decoder_class, true))
+        return false;
+
+    priv = (ByteArrayDecoder *) JS_GetPrivate(to);
+    if (priv == NULL)
+        return true; /* prototype, not instance */
+
+    if (argv.get(1).isObject()) {
+        JS::RootedObject options(context, &argv[1].toObject());
+        JS::RootedValue stream_value(context);
+
+        if (!JS_GetProperty(context, options, "stream", &stream_value))
+            return false;
+        stream = JS::ToBoolean(stream_value);
+    }
+
+    if (priv->converter == (GIConv) -1)
+        ok = decode_utf8(context, priv, argv.get(0), stream, argv.rval());
+    else
+        ok = decode_iconv(context, priv, argv.get(0), stream, argv.rval());
+
+    /* After the end of the stream, or an error, start over */
+    if (!ok || !stream) {
+        priv->n_pending = 0;
+        if (priv->converter != (GIConv) -1)
+            g_iconv(priv->converter, NULL, NULL, NULL, NULL);
+    }
+
+    return ok;
+}
+
+GJS_NATIVE_CONSTRUCTOR_DECLARE(byte_array_decoder)
+{
+    GJS_NATIVE_CONSTRUCTOR_VARIABLES(byte_array_decoder)
+    ByteArrayDecoder *priv;
+    GIConv converter;
+
+    GJS_NATIVE_CONSTRUCTOR_PRELUDE(byte_array_decoder);
+
+    if (!open_stream_converter(context, argv.get(0), true, &converter))
+        return false;
+
+    priv = g_slice_new0(ByteArrayDecoder);
+    priv->converter = converter;
+    JS_SetPrivate(object, priv);
+
+    GJS_NATIVE_CONSTRUCTOR_FINISH(byte_array_decoder);
+
+    return true;
+}
+
+static void
+byte_array_decoder_finalize(JSFreeOp *fop,
+                            JSObject *obj)
+{
+    ByteArrayDecoder *priv = (ByteArrayDecoder *) JS_GetPrivate(obj);
+
+    if (priv == NULL)
+        return; /* prototype, not instance */
+
+    if (priv->converter != (GIConv) -1)
+        g_iconv_close(priv->converter);
+
+    g_slice_free(ByteArrayDecoder, priv);
+}
+
+struct JSClass gjs_byte_array_decoder_class = {
+    "Decoder",
+    JSCLASS_HAS_PRIVATE |
+    JSCLASS_BACKGROUND_FINALIZE,
+    JS_PropertyStub,
+    JS_DeletePropertyStub,
+    JS_PropertyStub,
+    JS_StrictPropertyStub,
+    JS_EnumerateStub,
+    JS_ResolveStub,
+    JS_ConvertStub,
+    byte_array_decoder_finalize
+};
+
+static JSFunctionSpec gjs_byte_array_decoder_proto_funcs[] = {
+    JS_FS("decode", decoder_decode_func, 2, 0),
+    JS_FS_END
+};
+
+/* Encodes as many whole characters of @chars as fit in @room bytes; lone
+ * surrogates become U+FFFD, as in TextEncoder */
+static void
+encode_utf8(const char16_t *chars,
+            gsize           n_chars,
+            guint8         *dest,
+            gsize           room,
+            gsize          *read_p,
+            gsize          *written_p)
+{
+    gsize i = 0, j = 0;
+
+    while (i < n_chars) {
+        gunichar c = chars[i];
+        gsize units = 1, n_bytes;
+
+        if (c < 0x80) {
+            if (j == room)
+                break;
+            dest[j++] = c;
+            i++;
+            continue;
+        }
+
+        if (c >= 0xd800 && c < 0xdc00 && i + 1 < n_chars &&
+            chars[i + 1] >= 0xdc00 && chars[i + 1] < 0xe000) {
+            c = 0x10000 + ((c - 0xd800) << 10) + (chars[i + 1] - 0xdc00);
+            units = 2;
+        } else if (c >= 0xd800 && c < 0xe000) {
+            c = 0xfffd;
+        }
+
+        n_bytes = g_unichar_to_utf8(c, NULL);
+        if (j + n_bytes > room)
+            break;
+
+        g_unichar_to_utf8(c, (char *) dest + j);
+        j += n_bytes;
+        i += units;
+    }
+
+    *read_p = i;
+    *written_p = j;
+}
+
+/* Starts in the initial shift state and returns to it at the end, so that
+ * stateful encodings like ISO-2022-JP get their closing escape sequence;
+ * if it doesn't fit after the last character, fewer characters are
+ * encoded. */
+static bool
+encode_iconv(JSContext      *context,
+             GIConv          converter,
+             const char16_t *chars,
+             gsize           n_chars,
+             guint8         *dest,
+             gsize           room,
+             gsize          *read_p,
+             gsize          *written_p)
+{
+    gsize limit = room;
+
+    while (true) {
+        char *inbuf = (char *) chars;
+        char *outbuf = (char *) dest;
+        gsize in_left = n_chars * 2, out_left = limit, converted;
+
+        g_iconv(converter, NULL, NULL, NULL, NULL);
+
+        /* Running out of room, or a surrogate pair cut at the end, just
+         * stops the conversion early */
+        if (g_iconv(converter, &inbuf, &in_left, &outbuf, &out_left) == (gsize) -1 &&
+            errno != E2BIG && errno != EINVAL) {
+            gjs_throw(context, "Character at index %" G_GSIZE_FORMAT " can't be "
+                      "represented in the target encoding",
+                      (n_chars * 2 - in_left) / 2);
+            return false;
+        }
+
+        converted = limit - out_left;
+        out_left += room - limit;
+        if (g_iconv(converter, NULL, NULL, &outbuf, &out_left) != (gsize) -1) {
+            *read_p = (n_chars * 2 - in_left) / 2;
+            *written_p = room - out_left;
+            return true;
+        }
+
+        if (errno != E2BIG || converted == 0) {
+            gjs_throw(context, "Error during conversion: %s", g_strerror(errno));
+            return false;
+        }
+
+        /* Leave more room for the escape sequence, and try again */
+        limit = converted - 1;
+    }
+}
+
+/* Gets the writable contents of the destination of encodeInto() */
+static bool
+encoder_peek_dest(JSContext       *context,
+                  JS::HandleObject obj,
+                  guint8         **data_p,
+                  gsize           *len_p)
+{
+    if (gjs_typecheck_bytearray(context, obj, false)) {
+        ByteArrayInstance *priv = priv_from_js(context, obj);
+
+        byte_array_ensure_array(priv);
+        *data_p = priv->array->data;
+        *len_p = priv->array->len;
+        return true;
+    }
+
+    if (JS_IsUint8Array(obj) || JS_IsUint8ClampedArray(obj)) {
+        *data_p = (guint8 *) JS_GetArrayBufferViewData(obj);
+        *len_p = JS_GetTypedArrayLength(obj);
+        return true;
+    }
+
+    gjs_throw(context, "Encoder.encodeInto() needs a ByteArray or Uint8Array "
+              "to write to");
+    return false;
+}
+
+/* encodeInto() implementation. encodeInto(string, dest, offset) writes
+ * as much of @string as fits in @dest from @offset on, without growing
+ * it, and returns {read, written}: the number of UTF-16 code units of
+ * @string consumed and the number of bytes written. */
+static bool
+encoder_encode_into_func(JSContext *context,
+                         unsigned   argc,
+                         JS::Value *vp)
+{
+    GJS_GET_THIS(context, argc, vp, argv, to);
+    ByteArrayEncoder *priv;
+    const char16_t *chars;
+    gsize n_chars, len, offset, read, written;
+    guint8 *dest;
+
+    if (!gjs_typecheck_instance(context, to, &gjs_byte_array_encoder_class, true))
+        return false;
+
+    priv = (ByteArrayEncoder *) JS_GetPrivate(to);
+    if (priv == NULL)
+        return true; /* prototype, not instance */
+
+    if (!argv.get(0).isString()) {
+        gjs_throw(context, "Encoder.encodeInto() needs a string to encode");
+        return false;
+    }
+    if (!argv.get(1).isObject()) {
+        gjs_throw(context, "Encoder.encodeInto() needs a ByteArray or Uint8Array "
+                  "to write to");
+        return false;
+    }
+
+    JS::RootedObject dest_obj(context, &argv[1].toObject());
+
+    chars = JS_GetStringCharsAndLength(context, argv[0].toString(), &n_chars);
+    if (chars == NULL)
+        return false;
+
+    if (!encoder_peek_dest(context, dest_obj, &dest, &len) ||
+        !byte_array_relative_index(context, argv.get(2), len, 0, &offset))
+        return false;
+
+    /* The offset's valueOf() could have run a GC, so look again */
+    encoder_peek_dest(context, dest_obj, &dest, &len);
+    offset = MIN(offset, len);
+
+    if (priv->converter == (GIConv) -1)
+        encode_utf8(chars, n_chars, dest + offset, len - offset, &read, &written);
+    else if (!encode_iconv(context, priv->converter, chars, n_chars,
+                           dest + offset, len - offset, &read, &written))
+        return false;
+
+    JS::RootedObject result(context,
+        JS_NewObject(context, NULL, JS::NullPtr(), JS::NullPtr()));
+    if (result == NULL)
+        return false;
+
+    JS::RootedValue v(context, JS::NumberValue((double) read));
+    if (!JS_DefineProperty(context, result, "read", v, JSPROP_ENUMERATE))
+        return false;
+    v.setNumber((double) written);
+    if (!JS_DefineProperty(context, result, "written", v, JSPROP_ENUMERATE))
+        return false;
+
+    argv.rval().setObject(*result);
+    return true;
+}
+
+GJS_NATIVE_CONSTRUCTOR_DECLARE(byte_array_encoder)
+{
+    GJS_NATIVE_CONSTRUCTOR_VARIABLES(byte_array_encoder)
+    ByteArrayEncoder *priv;
+    GIConv converter;
+
+    GJS_NATIVE_CONSTRUCTOR_PRELUDE(byte_array_encoder);
+
+    if (!open_stream_converter(context, argv.get(0), false, &converter))
+        return false;
+
+    priv = g_slice_new0(ByteArrayEncoder);
+    priv->converter = converter;
+    JS_SetPrivate(object, priv);
+
+    GJS_NATIVE_CONSTRUCTOR_FINISH(byte_array_encoder);
+
+    return true;
+}
+
+static void
+byte_array_encoder_finalize(JSFreeOp *fop,
+                            JSObject *obj)
+{
+    ByteArrayEncoder *priv = (ByteArrayEncoder *) JS_GetPrivate(obj);
+
+    if (priv == NULL)
+        return; /* prototype, not instance */
+
+    if (priv->converter != (GIConv) -1)
+        g_iconv_close(priv->converter);
+
+    g_slice_free(ByteArrayEncoder, priv);
+}
+
+struct JSClass gjs_byte_array_encoder_class = {
+    "Encoder",
+    JSCLASS_HAS_PRIVATE |
+    JSCLASS_BACKGROUND_FINALIZE,
+    JS_PropertyStub,
+    JS_DeletePropertyStub,
+    JS_PropertyStub,
+    JS_StrictPropertyStub,
+    JS_EnumerateStub,
+    JS_ResolveStub,
+    JS_ConvertStub,
+    byte_array_encoder_finalize
+};
+
+static JSFunctionSpec gjs_byte_array_encoder_proto_funcs[] = {
+    JS_FS("encodeInto", encoder_encode_into_func, 2, 0),
+    JS_FS_END
+};
+
+JSObject *
+gjs_byte_array_from_byte_array (JSContext *context,
+                                GByteArray *array)
+{
+    ByteArrayInstance *priv;
+
+    g_return_val_if_fail(context != NULL, NULL);
+    g_return_val_if_fail(array != NULL, NULL);
+
+    JS::RootedObject proto(context, byte_array_get_prototype(context));
+    JS::RootedObject object(context,
+        JS_NewObject(context, &gjs_byte_array_class, proto, JS::NullPtr()));
+
+    if (!object) {
+        gjs_throw(context, "failed to create byte array");
+        return NULL;
+    }
+
+    priv = g_slice_new0(ByteArrayInstance);
+    g_assert(priv_from_js(context, object) == NULL);
+    JS_SetPrivate(object, priv);
+    priv->array = g_byte_array_new();
+    priv->array->data = (guint8*) g_memdup(array->data, array->len);
+    priv->array->len = array->len;
+    byte_array_account(context, priv);
+
+    return object;
+}
+
+GBytes *
+gjs_byte_array_get_bytes (JSContext       *context,
+                          JS::HandleObject object)
+{
+    ByteArrayInstance *priv;
+    priv = priv_from_js(context, object);
+    g_assert(priv != NULL);
+
+    byte_array_ensure_gbytes(priv);
+
+    return g_bytes_ref (priv->bytes);
+}
+
+GByteArray *
+gjs_byte_array_get_byte_array (JSContext       *context,
+                               JS::HandleObject obj)
+{
+    ByteArrayInstance *priv;
+    priv = priv_from_js(context, obj);
+    g_assert(priv != NULL);
+
+    byte_array_ensure_array(priv);
+
+    return g_byte_array_ref (priv->array);
+}
+
+void
+gjs_byte_array_peek_data (JSContext       *context,
+                          JS::HandleObject obj,
+                          guint8         **out_data,
+                          gsize           *out_len)
+{
+    ByteArrayInstance *priv;
+    priv = priv_from_js(context, obj);
+    g_assert(priv != NULL);
+
+    byte_array_peek(priv, out_data, out_len);
+}
+
+JSPropertySpec gjs_byte_array_proto_props[] = {
+    JS_PSGS("length", byte_array_length_getter, byte_array_length_setter,
+            JSPROP_PERMANENT),
+    JS_PS_END
+};
+
+JSFunctionSpec gjs_byte_array_proto_funcs[] = {
+    JS_FS("toString", to_string_func, 0, 0),
+    JS_FS("toGBytes", to_gbytes_func, 0, 0),
+    JS_FS("slice", slice_func, 2, 0),
+    JS_FS("indexOf", index_of_func, 1, 0),
+    JS_FS("lastIndexOf", last_index_of_func, 1, 0),
+    JS_FS("copyWithin", copy_within_func, 2, 0),
+    JS_FS("fill", fill_func, 1, 0),
+    JS_FS("concat", concat_func, 1, 0),
+    JS_FS("compare", compare_func, 1, 0),
+    JS_FS_END
+};
+
+static JSFunctionSpec gjs_byte_array_module_funcs[] = {
+    JS_FS("fromString", from_string_func, 1, 0),
+    JS_FS("fromArray", from_array_func, 1, 0),
+    JS_FS("fromGBytes", from_gbytes_func, 1, 0),
+    JS_FS("toUint8Array", to_uint8_array_func, 1, 0),
+    JS_FS_END
+};
+
+bool
+gjs_define_byte_array_stuff(JSContext              *context,
+                            JS::MutableHandleObject module)
+{
+    JSObject *prototype;
+
+    module.set(JS_NewObject(context, NULL, JS::NullPtr(), JS::NullPtr()));
+
+    prototype = JS_InitClass(context, module, JS::NullPtr(),
+                             &gjs_byte_array_class,
+                             gjs_byte_array_constructor,
+                             0,
+                             &gjs_byte_array_proto_props[0],
+                             &gjs_byte_array_proto_funcs[0],
+                             NULL,
+                             NULL);
+
+    if (!JS_DefineFunctions(context, module, &gjs_byte_array_module_funcs[0]))
+        return false;
+
+    if (!JS_InitClass(context, module, JS::NullPtr(),
+                      &gjs_byte_array_decoder_class,
+                      gjs_byte_array_decoder_constructor, 0,
+                      NULL, &gjs_byte_array_decoder_proto_funcs[0],
+                      NULL, NULL) ||
+        !JS_InitClass(context, module, JS::NullPtr(),
+                      &gjs_byte_array_encoder_class,
+                      gjs_byte_array_encoder_constructor, 0,
+                      NULL, &gjs_byte_array_encoder_proto_funcs[0],
+                      NULL, NULL))
         return false;
 
     g_assert(gjs_get_global_slot(context, GJS_GLOBAL_SLOT_BYTE_ARRAY_PROTOTYPE).isUndefined());
@@ -0,0 +1,312 @@
+/* -*- mode: C; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* On-disk cache of compiled scripts.
+ *
+ * Scripts loaded from files are compiled once, and their bytecode is
+ * serialized with SpiderMonkey's XDR into $XDG_CACHE_HOME/gjs/bytecode,
+ * one file per source file. Later runs decode the bytecode instead of
+ * parsing the source again.
+ *
+ * A cache file starts with a header holding the engine id, so that
+ * bytecode from another SpiderMonkey or GJS build is never used, and the
+ * key of the source it was compiled from: its path, modification time
+ * and size for local files, or a checksum of the contents for other
+ * files such as GResources. The header is padded to a multiple of 8
+ * bytes before the bytecode.
+ *
+ * Set GJS_DISABLE_BYTECODE_CACHE in the environment to disable it. It is
+ * also disabled when a debugger is attached, since decoded scripts aren't
+ * reported to Debugger.onNewScript.
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <string.h>
+
+#include "bytecode-cache.h"
+#include "jsapi-util.h"
+#include <util/log.h>
+
+#define CACHE_MAGIC "GJSXDR1"  /* 8 bytes with the nul */
+#define CACHE_HEADER_ALIGN 8
+
+static bool
+cache_enabled(JSContext *context)
+{
+    static int disabled = -1;
+
+    if (G_UNLIKELY(disabled < 0))
+        disabled = g_getenv("GJS_DISABLE_BYTECODE_CACHE") != NULL;
+
+    return !disabled && !JS_GetDebugMode(context);
+}
+
+static const char *
+get_engine_id(void)
+{
+    static char *engine_id = NULL;
+
+    if (g_once_init_enter(&engine_id)) {
+        char *id = g_strdup_printf("%s gjs-%d %u", JS_GetImplementationVersion(),
+                                   GJS_VERSION, (unsigned) sizeof(void *));
+        g_once_init_leave(&engine_id, id);
+    }
+
+    return engine_id;
+}
+
+/* The key is the file's URI, a newline, and a stamp of its contents; we
+ * keep a single cache file per URI, so that it is replaced when the file
+ * changes instead of piling up. */
+static char *
+get_cache_path(const char *key)
+{
+    const char *stamp = strchr(key, '\n');
+    char *checksum, *path;
+
+    g_assert(stamp != NULL);
+
+    checksum = g_compute_checksum_for_data(G_CHECKSUM_SHA1,
+                                           (const guchar *) key, stamp - key);
+    path = g_build_filename(g_get_user_cache_dir(), "gjs", "bytecode",
+                            checksum, NULL);
+    g_free(checksum);
+
+    return path;
+}
+
+/**
+ * gjs_bytecode_cache_get_key:
+ * @context: the #JSContext
+ * @file: the file the script was loaded from
+ * @script: the contents of @file
+ * @script_len: the length of @script
+ *
+ * Returns: (transfer full) (nullable): the key to look up the bytecode of
+ * @script in the cache, or %NULL if it should not be cached.
+ */
+char *
+gjs_bytecode_cache_get_key(JSContext  *context,
+                           GFile      *file,
+                           const char *script,
+                           gsize       script_len)
+{
+    char *uri, *key;
+
+    if (!cache_enabled(context))
+        return NULL;
+
+    uri = g_file_get_uri(file);
+
+    if (g_file_is_native(file)) {
+        GFileInfo *info;
+        guint64 mtime;
+        guint32 mtime_usec;
+        goffset size;
+
+        info = g_file_query_info(file,
+                                 G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+                                 G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC ","
+                                 G_FILE_ATTRIBUTE_STANDARD_SIZE,
+                                 G_FILE_QUERY_INFO_NONE, NULL, NULL);
+        if (info == NULL) {
+            g_free(uri);
+            return NULL;
+        }
+
+        mtime = g_file_info_get_attribute_uint64(info,
+                                                 G_FILE_ATTRIBUTE_TIME_MODIFIED);
+        mtime_usec = g_file_info_get_attribute_uint32(info,
+                                                      G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+        size = g_file_info_get_size(info);
+        g_object_unref(info);
+
+        /* The file was changed after we read it */
+        if (size != (goffset) script_len) {
+            g_free(uri);
+            return NULL;
+        }
+
+        key = g_strdup_printf("%s\nmtime %" G_GUINT64_FORMAT ".%06u size %"
+                              G_GOFFSET_FORMAT, uri, mtime, mtime_usec, size);
+    } else {
+        char *checksum = g_compute_checksum_for_data(G_CHECKSUM_SHA256,
+                                                     (const guchar *) script,
+                                                     script_len);
+        key = g_strdup_printf("%s\nsha256 %s", uri, checksum);
+        g_free(checksum);
+    }
+
+    g_free(uri);
+    return key;
+}
+
+/* Checks the header of a cache file, and returns the offset of the
+ * bytecode, or 0 if the file is not valid for @key. */
+static gsize
+check_header(const char *data,
+             gsize       len,
+             const char *key)
+{
+    const char *engine_id = get_engine_id();
+    gsize offset = sizeof(CACHE_MAGIC);
+    gsize engine_id_len = strlen(engine_id) + 1;
+    gsize key_len = strlen(key) + 1;
+
+    if (len < offset + engine_id_len + key_len ||
+        memcmp(data, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0)
+        return 0;
+
+    if (memcmp(data + offset, engine_id, engine_id_len) != 0)
+        return 0;
+    offset += engine_id_len;
+
+    if (memcmp(data + offset, key, key_len) != 0)
+        return 0;
+    offset += key_len;
+
+    offset = (offset + CACHE_HEADER_ALIGN - 1) & ~(gsize) (CACHE_HEADER_ALIGN - 1);
+    if (offset >= len)
+        return 0;
+
+    return offset;
+}
+
+/**
+ * gjs_bytecode_cache_load:
+ * @context: the #JSContext
+ * @key: a key returned by gjs_bytecode_cache_get_key()
+ *
+ * Returns: the script decoded from the cache, or %NULL if it is not in the
+ * cache or the cached bytecode is stale. The caller must root it.
+ */
+JSScript *
+gjs_bytecode_cache_load(JSContext  *context,
+                        const char *key)
+{
+    char *path = get_cache_path(key);
+    char *contents = NULL;
+    gsize len, offset;
+    JSScript *script = NULL;
+
+    if (!g_file_get_contents(path, &contents, &len, NULL))
+        goto out;
+
+    offset = check_header(contents, len, key);
+    if (offset == 0) {
+        gjs_debug(GJS_DEBUG_IMPORTER, "Stale bytecode cache file %s", path);
+        goto out;
+    }
+
+    script = JS_DecodeScript(context, contents + offset, len - offset, NULL);
+    if (script == NULL) {
+        /* Most likely bytecode from an incompatible engine */
+        JS_ClearPendingException(context);
+        gjs_debug(GJS_DEBUG_IMPORTER, "Failed to decode bytecode cache file %s",
+                  path);
+        goto out;
+    }
+
+    gjs_debug(GJS_DEBUG_IMPORTER, "Loaded bytecode from cache file %s", path);
+
+ out:
+    g_free(contents);
+    g_free(path);
+    return script;
+}
+
+/**
+ * gjs_bytecode_cache_has:
+ * @context: the #JSContext
+ * @key: a key returned by gjs_bytecode_cache_get_key()
+ *
+ * Returns: whether the cache holds bytecode for @key, without decoding it.
+ */
+bool
+gjs_bytecode_cache_has(JSContext  *context,
+                       const char *key)
+{
+    char *path = get_cache_path(key);
+    GMappedFile *mapped = g_mapped_file_new(path, false, NULL);
+    bool found = false;
+
+    if (mapped != NULL) {
+        found = check_header(g_mapped_file_get_contents(mapped),
+                             g_mapped_file_get_length(mapped), key) != 0;
+        g_mapped_file_unref(mapped);
+    }
+
+    g_free(path);
+    return found;
+}
+
+/**
+ * gjs_bytecode_cache_store:
+ * @context: the #JSContext
+ * @key: a key returned by gjs_bytecode_cache_get_key()
+ * @script: the freshly compiled script, not executed yet
+ *
+ * Saves the bytecode of @script to the cache. Failures are not fatal and
+ * are only logged.
+ */
+void
+gjs_bytecode_cache_store(JSContext       *context,
+                         const char      *key,
+                         JS::HandleScript script)
+{
+    const char *engine_id = get_engine_id();
+    char *path, *dir;
+    GString *buf;
+    uint32_t len;
+    void *data;
+    GError *error = NULL;
+
+    data = JS_EncodeScript(context, script, &len);
+    if (data == NULL) {
+        JS_ClearPendingException(context);
+        return;
+    }
+
+    buf = g_string_sized_new(len + 256);
+    g_string_append_len(buf, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    g_string_append_len(buf, engine_id, strlen(engine_id) + 1);
+    g_string_append_len(buf, key, strlen(key) + 1);
+    while (buf->len % CACHE_HEADER_ALIGN != 0)
+        g_string_append_c(buf, '\0');
+    g_string_append_len(buf, (const char *) data, len);
+    JS_free(context, data);
+
+    path = get_cache_path(key);
+    dir = g_path_get_dirname(path);
+
+    if (g_mkdir_with_parents(dir, 0700) < 0 ||
+        !g_file_set_contents(path, buf->str, buf->len, &error)) {
+        gjs_debug(GJS_DEBUG_IMPORTER, "Failed to write bytecode cache file %s: %s",
+                  path, error ? error->message : g_strerror(errno));
+        g_clear_error(&error);
+    }
+
+    g_free(dir);
+    g_free(path);
+    g_string_free(buf, true);
+}
@@ -35,6 +35,18 @@ static char **coverage_prefixes = NULL;
 static char *coverage_output_path = NULL;
 static char *command = NULL;
 static gboolean print_version = false;
+static char *profile_output = NULL;
+
+static gboolean
+parse_profile_startup(const char *option_name,
+                      const char *value,
+                      gpointer    data,
+                      GError    **error)
+{
+    g_free(profile_output);
+    profile_output = g_strdup(value ? value : "-");
+    return true;
+}
 
 static GOptionEntry entries[] = {
     { "version", 0, 0, G_OPTION_ARG_NONE, &print_version, "Print GJS version and exit" },
@@ -42,6 +54,7 @@ static GOptionEntry entries[] = {
     { "coverage-prefix", 'C', 0, G_OPTION_ARG_STRING_ARRAY, &coverage_prefixes, "Add the prefix PREFIX to the list of files to generate coverage info for", "PREFIX" },
     { "coverage-output", 0, 0, G_OPTION_ARG_STRING, &coverage_output_path, "Write coverage output to a directory DIR. This option is mandatory when using --coverage-path", "DIR", },
     { "include-path", 'I', 0, G_OPTION_ARG_STRING_ARRAY, &include_path, "Add the directory DIR to the list of directories to search for js files.", "DIR" },
+    { "profile-startup", 0, G_OPTION_FLAG_OPTIONAL_ARG, G_OPTION_ARG_CALLBACK, (gpointer) parse_profile_startup, "Write a flame graph profile of imports and GI definitions to FILE, or stderr, at exit", "FILE" },
     { NULL }
 };
 
@@ -203,6 +216,7 @@ main(int argc, char **argv)
     coverage_output_path = NULL;
     command = NULL;
     print_version = false;
+    g_clear_pointer(&profile_output, g_free);
     g_option_context_set_ignore_unknown_options(context, false);
     g_option_context_set_help_enabled(context, true);
     if (!g_option_context_parse(context, &gjs_argc, &gjs_argv, &error))
@@ -215,6 +229,10 @@ main(int argc, char **argv)
         exit(0);
     }
 
+    /* Read when the first module is imported */
+    if (profile_output != NULL)
+        g_setenv("GJS_PROFILE_STARTUP", profile_output, true);
+
     if (command != NULL) {
         script = command;
         len = strlen(script);
@@ -27,6 +27,8 @@
 #include <inttypes.h>
 
 #include "context.h"
+#include "jsapi-wrapper.h"
+#include "prefetch.h"
 
 G_BEGIN_DECLS
 
@@ -34,6 +36,10 @@ bool         _gjs_context_destroying                  (GjsContext *js_context);
 
 void         _gjs_context_schedule_gc_if_needed       (GjsContext *js_context);
 
+void         _gjs_context_schedule_gc_notify          (JSRuntime  *runtime);
+
+GjsPrefetcher *_gjs_context_get_prefetcher           (GjsContext *js_context);
+
 void _gjs_context_exit(GjsContext *js_context,
                        uint8_t     exit_code);
 
@@ -34,6 +34,7 @@
 #include "native.h"
 #include "byteArray.h"
 #include "runtime.h"
+#include "mem.h"
 
 #include "gi.h"
 #include "gi/object.h"
@@ -74,6 +75,12 @@ struct _GjsContext {
     uint8_t exit_code;
 
     guint    auto_gc_id;
+    guint    gc_slice_budget;
+
+    guint    gc_notify_id;
+    guint64  gc_notified_count;
+
+    GjsPrefetcher *prefetcher;
 
     jsid const_strings[GJS_STRING_LAST];
 };
@@ -103,6 +110,13 @@ enum {
     PROP_PROGRAM_NAME,
 };
 
+enum {
+    SIGNAL_GC_FINISHED,
+    LAST_SIGNAL
+};
+
+static guint signals[LAST_SIGNAL];
+
 static GMutex contexts_lock;
 static GList *all_contexts = NULL;
 
@@ -315,6 +329,8 @@ static void
 gjs_context_init(GjsContext *js_context)
 {
     gjs_context_make_current(js_context);
+    js_context->gc_slice_budget = gjs_gc_get_slice_budget();
+    js_context->gc_notified_count = gjs_memory_get_gc_count();
 }
 
 static void
@@ -350,6 +366,32 @@ gjs_context_class_init(GjsContextClass *klass)
                                     PROP_PROGRAM_NAME,
                                     pspec);
 
+    /**
+     * GjsContext::gc-finished:
+     * @context: the #GjsContext
+     * @info: a #GVariant dictionary describing the collection
+     *
+     * Emitted from the main loop after each garbage collection of the
+     * context's runtime. @info has the following keys:
+     * start-time and end-time (monotonic times in microseconds), reason,
+     * incremental (whether it ran in several slices), full (whether all
+     * compartments were collected), slices, max-slice-duration
+     * (microseconds), heap-bytes-before and heap-bytes-after, and
+     * finalized, a dictionary giving the number of wrappers of each kind
+     * released during the collection, and finalized-types, the same by
+     * GType or type name, for the types with the most released wrappers.
+     *
+     * Information about the last collections is also available from JS
+     * through System.gcHistory().
+     */
+    signals[SIGNAL_GC_FINISHED] =
+        g_signal_new("gc-finished",
+                     G_TYPE_FROM_CLASS(klass),
+                     G_SIGNAL_RUN_LAST,
+                     0, NULL, NULL, NULL,
+                     G_TYPE_NONE,
+                     1, G_TYPE_VARIANT);
+
     /* For GjsPrivate */
     {
         char *priv_typelib_dir = g_build_filename (PKGLIBDIR, "girepository-1.0", NULL);
@@ -385,10 +427,19 @@ gjs_context_dispose(GObject *object)
 
         JS_BeginRequest(js_context->context);
 
+        /* Unused prefetched scripts are merged into the global's
+         * compartment while being discarded */
+        {
+            JSAutoCompartment ac(js_context->context, js_context->global);
+            gjs_prefetcher_free(js_context->prefetcher, js_context->context);
+            js_context->prefetcher = NULL;
+        }
+
         /* Do a full GC here before tearing down, since once we do
          * that we may not have the JS_GetPrivate() to access the
          * context
          */
+        gjs_runtime_set_next_gc_reason(js_context->runtime, "DESTROY_CONTEXT");
         JS_GC(js_context->runtime);
         JS_EndRequest(js_context->context);
 
@@ -405,6 +456,11 @@ gjs_context_dispose(GObject *object)
             js_context->auto_gc_id = 0;
         }
 
+        if (js_context->gc_notify_id > 0) {
+            g_source_remove (js_context->gc_notify_id);
+            js_context->gc_notify_id = 0;
+        }
+
         JS_RemoveExtraGCRootsTracer(js_context->runtime, gjs_context_tracer,
                                     js_context);
 
@@ -466,6 +522,8 @@ gjs_context_constructed(GObject *object)
     if (js_context->context == NULL)
         g_error("Failed to create javascript context");
 
+    js_context->prefetcher = gjs_prefetcher_new();
+
     for (i = 0; i < GJS_STRING_LAST; i++)
         js_context->const_strings[i] = gjs_intern_string_to_id(js_context->context, const_strings[i]);
 
@@ -587,13 +645,81 @@ _gjs_context_destroying (GjsContext *context)
     return context->destroying;
 }
 
+/* One frame at 60 fps, in microseconds */
+#define GC_SOURCE_FRAME_INTERVAL 16666
+
+/* The GC source runs at most one incremental GC slice per frame, at low
+ * priority, until the collection in progress is finished. Each slice is
+ * limited to the context's slice budget, so that the rest of the frame
+ * is left to the application. */
+typedef struct {
+    GSource     base;
+    GjsContext *js_context;
+    bool        force;
+} GjsGcSource;
+
 static gboolean
-trigger_gc_if_needed (gpointer user_data)
+gc_source_dispatch(GSource     *source,
+                   GSourceFunc  callback,
+                   gpointer     user_data)
 {
-    GjsContext *js_context = GJS_CONTEXT(user_data);
-    js_context->auto_gc_id = 0;
-    gjs_gc_if_needed(js_context->context);
-    return G_SOURCE_REMOVE;
+    GjsGcSource *gc_source = (GjsGcSource *) source;
+    GjsContext *js_context = gc_source->js_context;
+    gint64 slice_start = g_source_get_time(source);
+    bool in_progress;
+
+    if (gc_source->force)
+        in_progress = gjs_gc_start_incremental(js_context->context,
+                                               js_context->gc_slice_budget);
+    else
+        in_progress = gjs_gc_if_needed(js_context->context,
+                                       js_context->gc_slice_budget);
+
+    if (!in_progress) {
+        js_context->auto_gc_id = 0;
+        return G_SOURCE_REMOVE;
+    }
+
+    /* Keep going with the collection in progress, on the next frame */
+    gc_source->force = false;
+    g_source_set_ready_time(source, slice_start + GC_SOURCE_FRAME_INTERVAL);
+    return G_SOURCE_CONTINUE;
+}
+
+static GSourceFuncs gc_source_funcs = {
+    NULL, /* prepare */
+    NULL, /* check */
+    gc_source_dispatch,
+    NULL, /* finalize */
+};
+
+static void
+schedule_gc_source(GjsContext *js_context,
+                   bool        force)
+{
+    GSource *source;
+    GjsGcSource *gc_source;
+
+    if (js_context->auto_gc_id > 0) {
+        source = g_main_context_find_source_by_id(NULL, js_context->auto_gc_id);
+        if (source != NULL) {
+            ((GjsGcSource *) source)->force |= force;
+            g_source_set_ready_time(source, 0);
+            return;
+        }
+    }
+
+    source = g_source_new(&gc_source_funcs, sizeof(GjsGcSource));
+    gc_source = (GjsGcSource *) source;
+    gc_source->js_context = js_context;
+    gc_source->force = force;
+
+    g_source_set_priority(source, G_PRIORITY_LOW);
+    g_source_set_ready_time(source, 0);
+    g_source_set_name(source, "[gjs] incremental GC");
+
+    js_context->auto_gc_id = g_source_attach(source, NULL);
+    g_source_unref(source);
 }
 
 void
@@ -602,9 +728,103 @@ _gjs_context_schedule_gc_if_needed (GjsContext *js_context)
     if (js_context->auto_gc_id > 0)
         return;
 
-    js_context->auto_gc_id = g_idle_add_full(G_PRIORITY_LOW,
-                                             trigger_gc_if_needed,
-                                             js_context, NULL);
+    schedule_gc_source(js_context, false);
+}
+
+static GVariant *
+gc_info_to_variant(const GjsGcInfo *info)
+{
+    GVariantBuilder builder, finalized, finalized_types;
+    unsigned i;
+
+    g_variant_builder_init(&finalized, G_VARIANT_TYPE("a{su}"));
+    for (i = 0; i < GJS_N_COUNTERS; i++) {
+        if (info->finalized[i] > 0)
+            g_variant_builder_add(&finalized, "{su}",
+                                  gjs_memory_get_counter_name(i),
+                                  (guint32) info->finalized[i]);
+    }
+
+    g_variant_builder_init(&finalized_types, G_VARIANT_TYPE("a{su}"));
+    for (i = 0; i < info->n_finalized_types; i++)
+        g_variant_builder_add(&finalized_types, "{su}",
+                              info->finalized_types[i].name,
+                              (guint32) info->finalized_types[i].count);
+
+    g_variant_builder_init(&builder, G_VARIANT_TYPE_VARDICT);
+    g_variant_builder_add(&builder, "{sv}", "start-time",
+                          g_variant_new_int64(info->start_time));
+    g_variant_builder_add(&builder, "{sv}", "end-time",
+                          g_variant_new_int64(info->end_time));
+    g_variant_builder_add(&builder, "{sv}", "reason",
+                          g_variant_new_string(info->reason));
+    g_variant_builder_add(&builder, "{sv}", "incremental",
+                          g_variant_new_boolean(info->n_slices > 1));
+    g_variant_builder_add(&builder, "{sv}", "full",
+                          g_variant_new_boolean(info->full));
+    g_variant_builder_add(&builder, "{sv}", "slices",
+                          g_variant_new_uint32(info->n_slices));
+    g_variant_builder_add(&builder, "{sv}", "max-slice-duration",
+                          g_variant_new_int64(info->max_slice_duration));
+    g_variant_builder_add(&builder, "{sv}", "heap-bytes-before",
+                          g_variant_new_uint64(info->heap_bytes_before));
+    g_variant_builder_add(&builder, "{sv}", "heap-bytes-after",
+                          g_variant_new_uint64(info->heap_bytes_after));
+    g_variant_builder_add(&builder, "{sv}", "finalized",
+                          g_variant_builder_end(&finalized));
+    g_variant_builder_add(&builder, "{sv}", "finalized-types",
+                          g_variant_builder_end(&finalized_types));
+
+    return g_variant_builder_end(&builder);
+}
+
+static gboolean
+emit_gc_finished(gpointer user_data)
+{
+    GjsContext *js_context = GJS_CONTEXT(user_data);
+    guint64 count = gjs_memory_get_gc_count();
+    GjsGcInfo info;
+
+    js_context->gc_notify_id = 0;
+
+    /* Records that dropped out of the history in the meantime are lost */
+    for (; js_context->gc_notified_count < count;
+         js_context->gc_notified_count++) {
+        if (!gjs_memory_get_gc_info(js_context->gc_notified_count, &info) ||
+            info.runtime != js_context->runtime)
+            continue;
+
+        g_signal_emit(js_context, signals[SIGNAL_GC_FINISHED], 0,
+                      gc_info_to_variant(&info));
+    }
+
+    return G_SOURCE_REMOVE;
+}
+
+/* Called at the end of a collection, when running JS or emitting signals
+ * is not allowed, so the signal is emitted from an idle */
+void
+_gjs_context_schedule_gc_notify (JSRuntime *runtime)
+{
+    GList *l;
+
+    g_mutex_lock(&contexts_lock);
+    for (l = all_contexts; l != NULL; l = l->next) {
+        GjsContext *js_context = GJS_CONTEXT(l->data);
+
+        if (js_context->runtime != runtime || js_context->destroying ||
+            js_context->gc_notify_id > 0)
+            continue;
+
+        js_context->gc_notify_id = g_idle_add(emit_gc_finished, js_context);
+    }
+    g_mutex_unlock(&contexts_lock);
+}
+
+GjsPrefetcher *
+_gjs_context_get_prefetcher(GjsContext *js_context)
+{
+    return js_context->prefetcher;
 }
 
 void
@@ -641,10 +861,11 @@ context_reset_exit(GjsContext *js_context)
  * may initiate a garbage collection. 
  *
  * This function always unconditionally invokes JS_MaybeGC(), but
- * additionally looks at memory usage from the system malloc()
- * when available, and if the delta has grown since the last run
- * significantly, also initiates a full JavaScript garbage
- * collection.  The idea is that since GJS is a bridge between
+ * additionally looks at how much native memory was allocated on
+ * behalf of JS wrappers since the last collection, and if that is
+ * significant, also initiates an incremental JavaScript garbage
+ * collection, which is then finished in slices from the main
+ * loop.  The idea is that since GJS is a bridge between
  * JavaScript and system libraries, and JS objects act as proxies
  * for these system memory objects, GJS consumers need a way to
  * hint to the runtime that it may be a good idea to try a
@@ -669,9 +890,94 @@ gjs_context_maybe_gc (GjsContext  *context)
 void
 gjs_context_gc (GjsContext  *context)
 {
+    gjs_runtime_set_next_gc_reason(context->runtime, "API");
     JS_GC(context->runtime);
 }
 
+/**
+ * gjs_context_gc_incremental:
+ * @context: a #GjsContext
+ *
+ * Initiate a full incremental GC. Unlike gjs_context_gc(), this returns
+ * immediately; the collection is done in slices from the default main
+ * context, one per frame, each taking at most the time budget set with
+ * gjs_context_set_gc_slice_budget(). If a collection is already in
+ * progress, its next slice is run as soon as possible.
+ */
+void
+gjs_context_gc_incremental (GjsContext *context)
+{
+    g_return_if_fail(GJS_IS_CONTEXT(context));
+
+    schedule_gc_source(context, true);
+}
+
+/**
+ * gjs_context_get_gc_in_progress:
+ * @context: a #GjsContext
+ *
+ * Returns: whether an incremental GC was started and not finished yet.
+ */
+bool
+gjs_context_get_gc_in_progress (GjsContext *context)
+{
+    g_return_val_if_fail(GJS_IS_CONTEXT(context), false);
+
+    return JS::IsIncrementalGCInProgress(context->runtime);
+}
+
+/**
+ * gjs_context_set_gc_slice_budget:
+ * @context: a #GjsContext
+ * @budget_ms: time budget in milliseconds, must be positive
+ *
+ * Sets the maximum time that each incremental GC slice run from the main
+ * loop may take. Smaller budgets mean shorter pauses, but collections
+ * that take more frames to finish. The default is 5 ms, or the value of
+ * the GJS_GC_SLICE_BUDGET environment variable.
+ */
+void
+gjs_context_set_gc_slice_budget (GjsContext *context,
+                                 guint       budget_ms)
+{
+    g_return_if_fail(GJS_IS_CONTEXT(context));
+    g_return_if_fail(budget_ms > 0);
+
+    context->gc_slice_budget = budget_ms;
+}
+
+/**
+ * gjs_context_get_gc_slice_budget:
+ * @context: a #GjsContext
+ *
+ * Returns: the time budget of incremental GC slices, in milliseconds.
+ */
+guint
+gjs_context_get_gc_slice_budget (GjsContext *context)
+{
+    g_return_val_if_fail(GJS_IS_CONTEXT(context), 0);
+
+    return context->gc_slice_budget;
+}
+
+/**
+ * gjs_context_get_last_gc_slice_duration:
+ * @context: a #GjsContext
+ *
+ * Returns the time taken by the last GC slice, whether it was run from the
+ * main loop or triggered by the JS engine itself. A non-incremental GC
+ * counts as one slice. Useful to check that the slice budget is met.
+ *
+ * Returns: the duration in microseconds, or 0 if no GC happened yet.
+ */
+gint64
+gjs_context_get_last_gc_slice_duration (GjsContext *context)
+{
+    g_return_val_if_fail(GJS_IS_CONTEXT(context), 0);
+
+    return gjs_runtime_get_last_gc_slice_duration(context->runtime);
+}
+
 /**
  * gjs_context_get_all:
  *
@@ -707,24 +1013,42 @@ gjs_context_get_native_context (GjsContext *js_context)
     return js_context->context;
 }
 
-bool
-gjs_context_eval(GjsContext   *js_context,
-                 const char   *script,
-                 gssize        script_len,
-                 const char   *filename,
-                 int          *exit_status_p,
-                 GError      **error)
+/* @file is the file @script was loaded from, if any */
+static bool
+context_eval(GjsContext   *js_context,
+             const char   *script,
+             gssize        script_len,
+             const char   *filename,
+             GFile        *file,
+             int          *exit_status_p,
+             GError      **error)
 {
     bool ret = false;
+    bool ok;
 
     JSAutoCompartment ac(js_context->context, js_context->global);
     JSAutoRequest ar(js_context->context);
 
     g_object_ref(G_OBJECT(js_context));
 
+    /* Start compiling the modules this program imported last time, while
+     * the main thread compiles the program itself */
+    if (file != NULL) {
+        gjs_prefetch_start_manifest(js_context->context, file);
+    } else if (g_file_test(filename, G_FILE_TEST_IS_REGULAR)) {
+        GFile *main_file = g_file_new_for_commandline_arg(filename);
+        gjs_prefetch_start_manifest(js_context->context, main_file);
+        g_object_unref(main_file);
+    }
+
     JS::RootedValue retval(js_context->context);
-    if (!gjs_eval_with_scope(js_context->context, JS::NullPtr(), script,
-                             script_len, filename, &retval)) {
+    if (file != NULL)
+        ok = gjs_eval_file_with_scope(js_context->context, JS::NullPtr(), file,
+                                      script, script_len, filename, &retval);
+    else
+        ok = gjs_eval_with_scope(js_context->context, JS::NullPtr(), script,
+                                 script_len, filename, &retval);
+    if (!ok) {
         uint8_t code;
         if (context_should_exit(js_context, &code)) {
             /* exit_status_p is public API so can't be changed, but should be
@@ -765,13 +1089,26 @@ gjs_context_eval(GjsContext   *js_context,
     return ret;
 }
 
+bool
+gjs_context_eval(GjsContext   *js_context,
+                 const char   *script,
+                 gssize        script_len,
+                 const char   *filename,
+                 int          *exit_status_p,
+                 GError      **error)
+{
+    return context_eval(js_context, script, script_len, filename, NULL,
+                        exit_status_p, error);
+}
+
 bool
 gjs_context_eval_file(GjsContext    *js_context,
                       const char    *filename,
                       int           *exit_status_p,
                       GError       **error)
 {
-    char     *script = NULL;
+    GBytes   *script_bytes = NULL;
+    const char *script;
     gsize    script_len;
     bool ret = true;
 
@@ -782,18 +1119,25 @@ gjs_context_eval_file(GjsContext    *js_context,
         goto out;
     }
 
-    if (!g_file_load_contents(file, NULL, &script, &script_len, NULL, error)) {
+    script_bytes = gjs_file_load_bytes(file, error);
+    if (script_bytes == NULL) {
         ret = false;
         goto out;
     }
 
-    if (!gjs_context_eval(js_context, script, script_len, filename, exit_status_p, error)) {
+    script = (const char *) g_bytes_get_data(script_bytes, &script_len);
+    if (script == NULL)
+        script = "";  /* empty file */
+
+    if (!context_eval(js_context, script, script_len, filename, file,
+                      exit_status_p, error)) {
         ret = false;
         goto out;
     }
 
 out:
-    g_free(script);
+    if (script_bytes != NULL)
+        g_bytes_unref(script_bytes);
     g_object_unref(file);
     return ret;
 }
@@ -76,6 +76,15 @@ void            gjs_context_maybe_gc              (GjsContext  *context);
 
 void            gjs_context_gc                    (GjsContext  *context);
 
+void            gjs_context_gc_incremental        (GjsContext  *context);
+bool            gjs_context_get_gc_in_progress    (GjsContext  *context);
+
+void            gjs_context_set_gc_slice_budget   (GjsContext  *context,
+                                                   guint        budget_ms);
+guint           gjs_context_get_gc_slice_budget   (GjsContext  *context);
+
+gint64          gjs_context_get_last_gc_slice_duration (GjsContext *context);
+
 void            gjs_dumpstack                     (void);
 
 G_END_DECLS
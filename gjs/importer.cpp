@@ -30,6 +30,8 @@
 #include "jsapi-wrapper.h"
 #include "mem.h"
 #include "native.h"
+#include "prefetch.h"
+#include "startup-profile.h"
 
 #include <gio/gio.h>
 
@@ -43,6 +45,24 @@ typedef struct {
     bool is_root;
 } Importer;
 
+/* The contents of a searchPath directory, so that resolving an import
+ * doesn't have to stat the same files over and over. A listing is marked
+ * stale by its file monitor (this needs a running main loop), or dropped
+ * by importer.__clearCache__(); it is rescanned on the next lookup.
+ */
+typedef struct {
+    GHashTable   *entries;  /* file name -> GFileType */
+    GFileMonitor *monitor;
+    bool          stale;
+} DirListing;
+
+/* Search path entry -> DirListing, shared by all importers, so that a
+ * directory is listed and monitored once however many importers search
+ * it. It exists while there are importers. Not thread safe, like the
+ * search path. */
+static GHashTable *dir_listings = NULL;
+static unsigned n_importers = 0;
+
 typedef struct {
     GPtrArray *elements;
     unsigned int index;
@@ -252,7 +272,8 @@ import_file(JSContext       *context,
             JS::HandleObject module_obj)
 {
     bool ret = false;
-    char *script = NULL;
+    GBytes *script_bytes;
+    const char *script;
     char *full_path = NULL;
     gsize script_len = 0;
     GError *error = NULL;
@@ -260,7 +281,8 @@ import_file(JSContext       *context,
     JS::CompileOptions options(context);
     JS::RootedValue ignored(context);
 
-    if (!(g_file_load_contents(file, NULL, &script, &script_len, NULL, &error))) {
+    script_bytes = gjs_file_load_bytes(file, &error);
+    if (script_bytes == NULL) {
         if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_IS_DIRECTORY) &&
             !g_error_matches(error, G_IO_ERROR, G_IO_ERROR_NOT_DIRECTORY) &&
             !g_error_matches(error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
@@ -271,18 +293,21 @@ import_file(JSContext       *context,
         goto out;
     }
 
-    g_assert(script != NULL);
+    script = (const char *) g_bytes_get_data(script_bytes, &script_len);
+    if (script == NULL)
+        script = "";  /* empty file */
 
     full_path = g_file_get_parse_name (file);
 
-    if (!gjs_eval_with_scope(context, module_obj, script, script_len,
-                             full_path, &ignored))
+    if (!gjs_eval_file_with_scope(context, module_obj, file, script,
+                                  script_len, full_path, &ignored))
         goto out;
 
     ret = true;
 
  out:
-    g_free(script);
+    if (script_bytes != NULL)
+        g_bytes_unref(script_bytes);
     g_free(full_path);
     return ret;
 }
@@ -395,6 +420,153 @@ import_file_on_module(JSContext       *context,
     return retval;
 }
 
+static void
+on_dir_changed(GFileMonitor     *monitor,
+               GFile            *file,
+               GFile            *other_file,
+               GFileMonitorEvent event_type,
+               gpointer          user_data)
+{
+    DirListing *listing = (DirListing *) user_data;
+
+    switch (event_type) {
+    case G_FILE_MONITOR_EVENT_CHANGED:
+    case G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT:
+    case G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED:
+        /* File contents don't matter, only which files exist */
+        break;
+    default:
+        listing->stale = true;
+    }
+}
+
+static void
+dir_listing_free(gpointer data)
+{
+    DirListing *listing = (DirListing *) data;
+
+    if (listing->monitor != NULL) {
+        g_signal_handlers_disconnect_by_data(listing->monitor, listing);
+        g_file_monitor_cancel(listing->monitor);
+        g_object_unref(listing->monitor);
+    }
+    g_hash_table_destroy(listing->entries);
+    g_slice_free(DirListing, listing);
+}
+
+/* Returns false if the directory could not be listed for another reason
+ * than not existing, in which case the caller should not trust the cache.
+ */
+static bool
+dir_listing_scan(DirListing *listing,
+                 GFile      *dir)
+{
+    GFileEnumerator *enumerator;
+    GFileInfo *info;
+    GError *error = NULL;
+
+    g_hash_table_remove_all(listing->entries);
+    listing->stale = false;
+
+    enumerator = g_file_enumerate_children(dir,
+                                           G_FILE_ATTRIBUTE_STANDARD_NAME ","
+                                           G_FILE_ATTRIBUTE_STANDARD_TYPE,
+                                           G_FILE_QUERY_INFO_NONE, NULL, &error);
+    if (enumerator == NULL) {
+        bool missing = g_error_matches(error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND) ||
+            g_error_matches(error, G_IO_ERROR, G_IO_ERROR_NOT_DIRECTORY);
+        g_error_free(error);
+        return missing;
+    }
+
+    while ((info = g_file_enumerator_next_file(enumerator, NULL, &error))) {
+        g_hash_table_insert(listing->entries,
+                            g_strdup(g_file_info_get_name(info)),
+                            GINT_TO_POINTER(g_file_info_get_file_type(info)));
+        g_object_unref(info);
+    }
+
+    g_object_unref(enumerator);
+
+    if (error != NULL) {
+        g_error_free(error);
+        return false;
+    }
+
+    return true;
+}
+
+/* Returns the cached listing of @dirname, scanning it first if needed, or
+ * NULL if it can't be listed. */
+static DirListing *
+get_dir_listing(const char *dirname)
+{
+    DirListing *listing;
+    GFile *dir;
+    bool ok;
+
+    listing = (DirListing *) g_hash_table_lookup(dir_listings, dirname);
+    if (listing != NULL && !listing->stale)
+        return listing;
+
+    dir = g_file_new_for_commandline_arg(dirname);
+
+    if (listing == NULL) {
+        listing = g_slice_new0(DirListing);
+        listing->entries = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                                 g_free, NULL);
+
+        /* Resources can't change, other remote files aren't worth it */
+        if (g_file_is_native(dir)) {
+            listing->monitor = g_file_monitor_directory(dir, G_FILE_MONITOR_NONE,
+                                                        NULL, NULL);
+            if (listing->monitor != NULL)
+                g_signal_connect(listing->monitor, "changed",
+                                 G_CALLBACK(on_dir_changed), listing);
+        }
+
+        g_hash_table_insert(dir_listings, g_strdup(dirname), listing);
+    }
+
+    gjs_debug(GJS_DEBUG_IMPORTER, "Scanning search path directory '%s'",
+              dirname);
+
+    ok = dir_listing_scan(listing, dir);
+    g_object_unref(dir);
+
+    if (!ok) {
+        g_hash_table_remove(dir_listings, dirname);
+        return NULL;
+    }
+
+    return listing;
+}
+
+/* Looks up @filename in the searchPath directory @dirname; returns
+ * G_FILE_TYPE_UNKNOWN if it does not exist. */
+static GFileType
+query_file_type(const char *dirname,
+                const char *filename)
+{
+    DirListing *listing;
+    char *full_path;
+    GFile *file;
+    GFileType type;
+
+    listing = get_dir_listing(dirname);
+    if (listing != NULL)
+        return (GFileType) GPOINTER_TO_INT(g_hash_table_lookup(listing->entries,
+                                                               filename));
+
+    full_path = g_build_filename(dirname, filename, NULL);
+    file = g_file_new_for_commandline_arg(full_path);
+    type = g_file_query_file_type(file, G_FILE_QUERY_INFO_NONE, NULL);
+    g_object_unref(file);
+    g_free(full_path);
+
+    return type;
+}
+
 static bool
 do_import(JSContext       *context,
           JS::HandleObject obj,
@@ -410,7 +582,8 @@ do_import(JSContext       *context,
     bool result;
     GPtrArray *directories;
     GFile *gfile;
-    bool exists;
+
+    GjsProfileScope profile(GJS_PROFILE_IMPORT, NULL, name);
 
     JS::RootedId search_path_name(context,
         gjs_context_get_const_string(context, GJS_STRING_SEARCH_PATH));
@@ -482,7 +655,10 @@ do_import(JSContext       *context,
         full_path = g_build_filename(dirname, MODULE_INIT_FILENAME,
                                      NULL);
 
-        module_obj.set(load_module_init(context, obj, full_path));
+        if (query_file_type(dirname, MODULE_INIT_FILENAME) == G_FILE_TYPE_UNKNOWN)
+            module_obj.set(NULL);
+        else
+            module_obj.set(load_module_init(context, obj, full_path));
         if (module_obj != NULL) {
             JS::RootedValue obj_val(context);
             if (JS_GetProperty(context, module_obj, name, &obj_val)) {
@@ -500,9 +676,8 @@ do_import(JSContext       *context,
             g_free(full_path);
         full_path = g_build_filename(dirname, name,
                                      NULL);
-        gfile = g_file_new_for_commandline_arg(full_path);
 
-        if (g_file_query_file_type(gfile, (GFileQueryInfoFlags) 0, NULL) == G_FILE_TYPE_DIRECTORY) {
+        if (query_file_type(dirname, name) == G_FILE_TYPE_DIRECTORY) {
             gjs_debug(GJS_DEBUG_IMPORTER,
                       "Adding directory '%s' to child importer '%s'",
                       full_path, name);
@@ -514,8 +689,6 @@ do_import(JSContext       *context,
             full_path = NULL;
         }
 
-        g_object_unref(gfile);
-
         /* If we just added to directories, we know we don't need to
          * check for a file.  If we added to directories on an earlier
          * iteration, we want to ignore any files later in the
@@ -527,21 +700,18 @@ do_import(JSContext       *context,
         }
 
         /* Third, if it's not a directory, try importing a file */
-        g_free(full_path);
-        full_path = g_build_filename(dirname, filename,
-                                     NULL);
-        gfile = g_file_new_for_commandline_arg(full_path);
-        exists = g_file_query_exists(gfile, NULL);
-
-        if (!exists) {
+        if (query_file_type(dirname, filename) == G_FILE_TYPE_UNKNOWN) {
             gjs_debug(GJS_DEBUG_IMPORTER,
                       "JS import '%s' not found in %s",
                       name, dirname);
-
-            g_object_unref(gfile);
             continue;
         }
 
+        g_free(full_path);
+        full_path = g_build_filename(dirname, filename,
+                                     NULL);
+        gfile = g_file_new_for_commandline_arg(full_path);
+
         if (import_file_on_module (context, obj, name, gfile)) {
             gjs_debug(GJS_DEBUG_IMPORTER,
                       "successfully imported module '%s'", name);
@@ -682,7 +852,9 @@ importer_new_enumerate(JSContext  *context,
             char *dirname = NULL;
             char *init_path;
             const char *filename;
-            GDir *dir = NULL;
+            gpointer type;
+            DirListing *listing;
+            GHashTableIter entries;
 
             elem = JS::UndefinedValue();
             if (!JS_GetElement(context, search_path, i, &elem)) {
@@ -707,23 +879,30 @@ importer_new_enumerate(JSContext  *context,
                 return false; /* Error message already set */
             }
 
-            init_path = g_build_filename(dirname, MODULE_INIT_FILENAME,
-                                         NULL);
-
-            load_module_elements(context, object, iter, init_path);
-
-            g_free(init_path);
+            /* Ignore empty path elements */
+            if (dirname[0] == '\0') {
+                g_free(dirname);
+                continue;
+            }
 
-            dir = g_dir_open(dirname, 0, NULL);
+            listing = get_dir_listing(dirname);
 
-            if (!dir) {
+            if (!listing) {
                 g_free(dirname);
                 continue;
             }
 
-            while ((filename = g_dir_read_name(dir))) {
-                char *full_path;
+            if (g_hash_table_contains(listing->entries, MODULE_INIT_FILENAME)) {
+                init_path = g_build_filename(dirname, MODULE_INIT_FILENAME,
+                                             NULL);
 
+                load_module_elements(context, object, iter, init_path);
+
+                g_free(init_path);
+            }
+
+            g_hash_table_iter_init(&entries, listing->entries);
+            while (g_hash_table_iter_next(&entries, (gpointer *) &filename, &type)) {
                 /* skip hidden files and directories (.svn, .git, ...) */
                 if (filename[0] == '.')
                     continue;
@@ -732,9 +911,7 @@ importer_new_enumerate(JSContext  *context,
                 if (strcmp(filename, MODULE_INIT_FILENAME) == 0)
                     continue;
 
-                full_path = g_build_filename(dirname, filename, NULL);
-
-                if (g_file_test(full_path, G_FILE_TEST_IS_DIR)) {
+                if (GPOINTER_TO_INT(type) == G_FILE_TYPE_DIRECTORY) {
                     g_ptr_array_add(iter->elements, g_strdup(filename));
                 } else {
                     if (g_str_has_suffix(filename, "." G_MODULE_SUFFIX) ||
@@ -743,10 +920,7 @@ importer_new_enumerate(JSContext  *context,
                                         g_strndup(filename, strlen(filename) - 3));
                     }
                 }
-
-                g_free(full_path);
             }
-            g_dir_close(dir);
 
             g_free(dirname);
         }
@@ -824,7 +998,9 @@ importer_new_resolve(JSContext *context,
     /* let Object.prototype resolve these */
     if (strcmp(name, "valueOf") == 0 ||
         strcmp(name, "toString") == 0 ||
-        strcmp(name, "__iterator__") == 0)
+        strcmp(name, "__iterator__") == 0 ||
+        strcmp(name, "__clearCache__") == 0 ||
+        strcmp(name, "__prefetch__") == 0)
         goto out;
     priv = priv_from_js(context, obj);
 
@@ -861,6 +1037,8 @@ importer_finalize(JSFreeOp *fop,
         return; /* we are the prototype, not a real instance */
 
     GJS_DEC_COUNTER(importer);
+    if (--n_importers == 0)
+        g_clear_pointer(&dir_listings, g_hash_table_destroy);
     g_slice_free(Importer, priv);
 }
 
@@ -883,11 +1061,160 @@ struct JSClass gjs_importer_class = {
     importer_finalize
 };
 
+/* Forgets the cached contents of the search path directories, for when
+ * modules are added or removed while no main loop is running to notice.
+ * The cache is shared, so this applies to all importers. */
+static bool
+importer_clear_cache(JSContext *context,
+                     unsigned   argc,
+                     JS::Value *vp)
+{
+    GJS_GET_PRIV(context, argc, vp, args, obj, Importer, priv);
+
+    if (priv == NULL) {
+        gjs_throw(context, "__clearCache__() called on the importer prototype");
+        return false;
+    }
+
+    g_hash_table_remove_all(dir_listings);
+
+    args.rval().setUndefined();
+    return true;
+}
+
+/* Finds the file that importing @name would load, or sets *file_out to
+ * NULL if it would not load a file (it's not found, or a directory) */
+static bool
+find_module_file(JSContext       *context,
+                 JS::HandleObject obj,
+                 Importer        *priv,
+                 const char      *name,
+                 GFile          **file_out)
+{
+    JS::RootedObject search_path(context);
+    guint32 search_path_len, i;
+    char *filename;
+    bool ret = false;
+
+    *file_out = NULL;
+
+    JS::RootedId search_path_name(context,
+        gjs_context_get_const_string(context, GJS_STRING_SEARCH_PATH));
+    if (!gjs_object_require_property_value(context, obj, "importer",
+                                           search_path_name, &search_path))
+        return false;
+
+    if (!JS_IsArrayObject(context, search_path)) {
+        gjs_throw(context, "searchPath property on importer is not an array");
+        return false;
+    }
+
+    if (!JS_GetArrayLength(context, search_path, &search_path_len)) {
+        gjs_throw(context, "searchPath array has no length");
+        return false;
+    }
+
+    filename = g_strdup_printf("%s.js", name);
+
+    JS::RootedValue elem(context);
+    for (i = 0; i < search_path_len; ++i) {
+        char *dirname = NULL;
+        GFileType type;
+
+        if (!JS_GetElement(context, search_path, i, &elem))
+            goto out;
+
+        if (!elem.isString())
+            continue;
+
+        if (!gjs_string_to_utf8(context, elem, &dirname))
+            goto out;
+
+        if (dirname[0] == '\0') {
+            g_free(dirname);
+            continue;
+        }
+
+        /* Directories take precedence, as in do_import() */
+        if (query_file_type(dirname, name) == G_FILE_TYPE_DIRECTORY) {
+            g_free(dirname);
+            break;
+        }
+
+        type = query_file_type(dirname, filename);
+        if (type != G_FILE_TYPE_UNKNOWN && type != G_FILE_TYPE_DIRECTORY) {
+            char *full_path = g_build_filename(dirname, filename, NULL);
+            *file_out = g_file_new_for_commandline_arg(full_path);
+            g_free(full_path);
+            g_free(dirname);
+            break;
+        }
+
+        g_free(dirname);
+    }
+
+    ret = true;
+
+ out:
+    g_free(filename);
+    return ret;
+}
+
+/* Starts compiling the named modules on helper threads, so that
+ * importing them later only has to wait for the compiled scripts. */
+static bool
+importer_prefetch(JSContext *context,
+                  unsigned   argc,
+                  JS::Value *vp)
+{
+    GJS_GET_PRIV(context, argc, vp, args, obj, Importer, priv);
+    unsigned i;
+
+    if (priv == NULL) {
+        gjs_throw(context, "__prefetch__() called on the importer prototype");
+        return false;
+    }
+
+    for (i = 0; i < args.length(); i++) {
+        char *name;
+        bool found;
+        GFile *file;
+
+        if (!gjs_string_to_utf8(context, args[i], &name))
+            return false;
+
+        /* Already imported */
+        if (!JS_AlreadyHasOwnProperty(context, obj, name, &found)) {
+            g_free(name);
+            return false;
+        }
+
+        if (!found) {
+            if (!find_module_file(context, obj, priv, name, &file)) {
+                g_free(name);
+                return false;
+            }
+
+            if (file != NULL) {
+                gjs_prefetch_file(context, file);
+                g_object_unref(file);
+            }
+        }
+
+        g_free(name);
+    }
+
+    args.rval().setUndefined();
+    return true;
+}
+
 JSPropertySpec gjs_importer_proto_props[] = {
     JS_PS_END
 };
 
 JSFunctionSpec gjs_importer_proto_funcs[] = {
+    JS_FS("__clearCache__", importer_clear_cache, 0, 0),
+    JS_FS("__prefetch__", importer_prefetch, 1, 0),
     JS_FS_END
 };
 
@@ -942,6 +1269,10 @@ importer_new(JSContext *context,
     priv = g_slice_new0(Importer);
     priv->is_root = is_root;
 
+    if (n_importers++ == 0)
+        dir_listings = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                             g_free, dir_listing_free);
+
     GJS_INC_COUNTER(importer);
 
     g_assert(priv_from_js(context, importer) == NULL);
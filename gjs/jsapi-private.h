@@ -36,7 +36,13 @@
 G_BEGIN_DECLS
 
 void gjs_schedule_gc_if_needed (JSContext *context);
-void gjs_gc_if_needed          (JSContext *context);
+bool gjs_gc_if_needed          (JSContext *context,
+                                int64_t    slice_budget);
+
+bool gjs_gc_start_incremental  (JSContext *context,
+                                int64_t    slice_budget);
+
+int64_t gjs_gc_get_slice_budget(void);
 
 G_END_DECLS
 
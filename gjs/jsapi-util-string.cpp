@@ -73,6 +73,28 @@ gjs_string_from_utf8(JSContext             *context,
     glong u16_string_length;
     GError *error;
 
+    if (n_bytes < 0) {
+        n_bytes = strlen(utf8_string);
+    } else {
+        /* g_utf8_to_utf16() stops at the first nul byte; the ASCII path
+         * must stop there as well */
+        const char *nul = (const char *) memchr(utf8_string, '\0', n_bytes);
+        if (nul != NULL)
+            n_bytes = nul - utf8_string;
+    }
+
+    /* Pure ASCII needs neither validation nor decoding; the engine widens
+     * the bytes straight into the string's own buffer */
+    if (gjs_string_is_ascii(utf8_string, n_bytes)) {
+        JSAutoRequest ar(context);
+        JS::RootedString str(context,
+                             JS_NewStringCopyN(context, utf8_string, n_bytes));
+        if (str == NULL)
+            return false;
+        value_p.setString(str);
+        return true;
+    }
+
     /* intentionally using n_bytes even though glib api suggests n_chars; with
     * n_chars (from g_utf8_strlen()) the result appears truncated
     */
@@ -102,6 +124,36 @@ gjs_string_from_utf8(JSContext             *context,
     return str != NULL;
 }
 
+/**
+ * gjs_string_is_ascii:
+ * @str: a buffer, not necessarily nul-terminated
+ * @len: the length of @str in bytes
+ *
+ * Returns: whether all the bytes of @str are 7-bit ASCII
+ */
+bool
+gjs_string_is_ascii(const char *str,
+                    gsize       len)
+{
+    const char *end = str + len;
+    gsize word;
+
+    /* Checks a machine word at a time; the memcpy() compiles to a plain
+     * load, and compilers vectorize the loop further */
+    for (; end - str >= (ptrdiff_t) sizeof(word); str += sizeof(word)) {
+        memcpy(&word, str, sizeof(word));
+        if (word & (gsize) G_GUINT64_CONSTANT(0x8080808080808080))
+            return false;
+    }
+
+    for (; str != end; str++) {
+        if (*str & 0x80)
+            return false;
+    }
+
+    return true;
+}
+
 bool
 gjs_string_to_filename(JSContext      *context,
                        const JS::Value filename_val,
@@ -33,6 +33,10 @@
 #include "jsapi-wrapper.h"
 #include "context-private.h"
 #include "jsapi-private.h"
+#include "runtime.h"
+#include "bytecode-cache.h"
+#include "prefetch.h"
+#include "startup-profile.h"
 #include <gi/boxed.h>
 
 #include <string.h>
@@ -688,80 +692,125 @@ gjs_get_type_name(JS::Value value)
     }
 }
 
-#ifdef __linux__
-static void
-_linux_get_self_process_size (gulong *vm_size,
-                              gulong *rss_size)
+/* We start a collection once the native memory allocated on behalf of JS
+ * wrappers since the last one reaches this fraction of the GC heap size,
+ * but never for less than GJS_GC_MIN_NATIVE_TRIGGER bytes. */
+#define GJS_GC_NATIVE_TRIGGER_FACTOR 0.25
+#define GJS_GC_MIN_NATIVE_TRIGGER (8 * 1024 * 1024)
+
+/* Default time budget of each incremental GC slice run from the main loop,
+ * in milliseconds; can be overridden with the GJS_GC_SLICE_BUDGET
+ * environment variable, or per context with
+ * gjs_context_set_gc_slice_budget() */
+#define GJS_GC_DEFAULT_SLICE_BUDGET 5
+
+static int64_t gc_slice_budget = -1;
+static gint64 last_gc_time;
+
+static size_t
+native_gc_trigger(JSRuntime *runtime)
 {
-    char *contents;
-    char *iter;
-    gsize len;
-    int i;
+    size_t gc_bytes = JS_GetGCParameter(runtime, JSGC_BYTES);
+    return MAX(GJS_GC_MIN_NATIVE_TRIGGER,
+               (size_t) (gc_bytes * GJS_GC_NATIVE_TRIGGER_FACTOR));
+}
+
+int64_t
+gjs_gc_get_slice_budget(void)
+{
+    if (G_UNLIKELY(gc_slice_budget < 0)) {
+        const char *env = g_getenv("GJS_GC_SLICE_BUDGET");
+        gint64 budget = env ? g_ascii_strtoll(env, NULL, 10) : 0;
 
-    *vm_size = *rss_size = 0;
+        gc_slice_budget = budget > 0 ? budget : GJS_GC_DEFAULT_SLICE_BUDGET;
+    }
 
-    if (!g_file_get_contents ("/proc/self/stat", &contents, &len, NULL))
+    return gc_slice_budget;
+}
+
+/**
+ * gjs_gc_note_native_alloc:
+ * @context: the context the wrapper belongs to
+ * @nbytes: number of bytes
+ *
+ * Tells the GC that @nbytes of native memory were allocated on behalf of a
+ * JS wrapper, and that collecting the wrapper would free them. This is
+ * accounted in SpiderMonkey's malloc counter, and schedules a collection
+ * from the main loop once enough of it accumulated since the last one.
+ */
+void
+gjs_gc_note_native_alloc(JSContext *context,
+                         size_t     nbytes)
+{
+    JSRuntime *runtime = JS_GetRuntime(context);
+
+    if (nbytes == 0)
         return;
 
-    iter = contents;
-    /* See "man proc" for where this 22 comes from */
-    for (i = 0; i < 22; i++) {
-        iter = strchr (iter, ' ');
-        if (!iter)
-            goto out;
-        iter++;
-    }
-    sscanf (iter, " %lu", vm_size);
-    iter = strchr (iter, ' ');
-    if (iter)
-        sscanf (iter, " %lu", rss_size);
+    JS_updateMallocCounter(context, nbytes);
+    gjs_runtime_note_native_alloc(runtime, nbytes);
 
- out:
-    g_free (contents);
+    if (gjs_runtime_get_native_bytes_since_gc(runtime) >= native_gc_trigger(runtime)) {
+        GjsContext *gjs_context = (GjsContext *) JS_GetContextPrivate(context);
+        if (gjs_context)
+            _gjs_context_schedule_gc_if_needed(gjs_context);
+    }
 }
 
-static gulong linux_rss_trigger;
-static gint64 last_gc_time;
-#endif
+/* Starts or continues an incremental collection if needed, running one
+ * slice of at most @slice_budget milliseconds. Returns true if the
+ * collection is not finished yet, and this should be called again.
+ */
+bool
+gjs_gc_if_needed (JSContext *context,
+                  int64_t    slice_budget)
+{
+    JSRuntime *runtime = JS_GetRuntime(context);
+    gint64 now;
 
-void
-gjs_gc_if_needed (JSContext *context)
+    if (JS::IsIncrementalGCInProgress(runtime)) {
+        JS::PrepareForIncrementalGC(runtime);
+        JS::IncrementalGC(runtime, JS::gcreason::INTER_SLICE_GC, slice_budget);
+        return JS::IsIncrementalGCInProgress(runtime);
+    }
+
+    /* We rate limit GCs to at most one per 5 frames.
+       One frame is 16666 microseconds (1000000/60)*/
+    now = g_get_monotonic_time();
+    if (now - last_gc_time < 5 * 16666)
+        return false;
+
+    if (gjs_runtime_get_native_bytes_since_gc(runtime) < native_gc_trigger(runtime))
+        return false;
+
+    last_gc_time = now;
+    gjs_runtime_set_next_gc_reason(runtime, "MEM_PRESSURE");
+    JS::PrepareForFullGC(runtime);
+    JS::IncrementalGC(runtime, JS::gcreason::MEM_PRESSURE, slice_budget);
+    return JS::IsIncrementalGCInProgress(runtime);
+}
+
+/* Unconditionally starts an incremental collection, or runs the next slice
+ * of the one in progress. Returns true if the collection is not finished
+ * yet.
+ */
+bool
+gjs_gc_start_incremental(JSContext *context,
+                         int64_t    slice_budget)
 {
-#ifdef __linux__
-    {
-        /* We initiate a GC if VM or RSS has grown by this much */
-        gulong vmsize;
-        gulong rss_size;
-        gint64 now;
-
-        /* We rate limit GCs to at most one per 5 frames.
-           One frame is 16666 microseconds (1000000/60)*/
-        now = g_get_monotonic_time();
-        if (now - last_gc_time < 5 * 16666)
-            return;
-
-        _linux_get_self_process_size (&vmsize, &rss_size);
-
-        /* linux_rss_trigger is initialized to 0, so currently
-         * we always do a full GC early.
-         *
-         * Here we see if the RSS has grown by 25% since
-         * our last look; if so, initiate a full GC.  In
-         * theory using RSS is bad if we get swapped out,
-         * since we may be overzealous in GC, but on the
-         * other hand, if swapping is going on, better
-         * to GC.
-         */
-        if (rss_size > linux_rss_trigger) {
-            linux_rss_trigger = (gulong) MIN(G_MAXULONG, rss_size * 1.25);
-            JS_GC(JS_GetRuntime(context));
-            last_gc_time = now;
-        } else if (rss_size < (0.75 * linux_rss_trigger)) {
-            /* If we've shrunk by 75%, lower the trigger */
-            linux_rss_trigger = (rss_size * 1.25);
-        }
+    JSRuntime *runtime = JS_GetRuntime(context);
+
+    if (JS::IsIncrementalGCInProgress(runtime)) {
+        JS::PrepareForIncrementalGC(runtime);
+        JS::IncrementalGC(runtime, JS::gcreason::INTER_SLICE_GC, slice_budget);
+    } else {
+        last_gc_time = g_get_monotonic_time();
+        gjs_runtime_set_next_gc_reason(runtime, "API");
+        JS::PrepareForFullGC(runtime);
+        JS::IncrementalGC(runtime, JS::gcreason::API, slice_budget);
     }
-#endif
+
+    return JS::IsIncrementalGCInProgress(runtime);
 }
 
 /**
@@ -772,8 +821,14 @@ gjs_gc_if_needed (JSContext *context)
 void
 gjs_maybe_gc (JSContext *context)
 {
+    GjsContext *gjs_context = (GjsContext *) JS_GetContextPrivate(context);
+    int64_t slice_budget = gjs_context ?
+        gjs_context_get_gc_slice_budget(gjs_context) :
+        gjs_gc_get_slice_budget();
+
     JS_MaybeGC(context);
-    gjs_gc_if_needed(context);
+    if (gjs_gc_if_needed(context, slice_budget) && gjs_context)
+        _gjs_context_schedule_gc_if_needed(gjs_context);
 }
 
 void
@@ -794,9 +849,11 @@ gjs_schedule_gc_if_needed (JSContext *context)
 /**
  * gjs_strip_unix_shebang:
  *
- * @script: (in): A pointer to a JS script
- * @script_len: (inout): A pointer to the script length. The
- * pointer will be modified if a shebang is stripped.
+ * @script: (in): A pointer to a JS script, which need not be
+ * nul-terminated if @script_len is not negative
+ * @script_len: (inout): A pointer to the script length, or to -1 if
+ * @script is nul-terminated. The pointer will be modified if a shebang
+ * is stripped.
  * @new_start_line_number: (out) (allow-none): A pointer to
  * write the start-line number to account for the offset
  * as a result of stripping the shebang.
@@ -812,12 +869,16 @@ gjs_strip_unix_shebang(const char  *script,
                        gssize      *script_len,
                        int         *start_line_number_out)
 {
+    gsize len;
+
     g_assert(script_len);
 
+    len = *script_len < 0 ? strlen(script) : *script_len;
+
     /* handle scripts with UNIX shebangs */
-    if (strncmp(script, "#!", 2) == 0) {
+    if (len >= 2 && script[0] == '#' && script[1] == '!') {
         /* If we found a newline, advance the script by one line */
-        const char *s = (const char *) strstr (script, "\n");
+        const char *s = (const char *) memchr(script, '\n', len);
         if (s != NULL) {
             if (*script_len > 0)
                 *script_len -= (s + 1 - script);
@@ -845,42 +906,94 @@ gjs_strip_unix_shebang(const char  *script,
     return script;
 }
 
-bool
-gjs_eval_with_scope(JSContext             *context,
-                    JS::HandleObject       object,
-                    const char            *script,
-                    ssize_t                script_len,
-                    const char            *filename,
-                    JS::MutableHandleValue retval)
+static bool
+eval_with_scope_internal(JSContext             *context,
+                         JS::HandleObject       object,
+                         const char            *script,
+                         ssize_t                script_len,
+                         const char            *filename,
+                         GFile                 *file,
+                         JS::MutableHandleValue retval)
 {
     int start_line_number = 1;
+    char *cache_key = NULL;
     JSAutoRequest ar(context);
 
     if (script_len < 0)
         script_len = strlen(script);
 
-    script = gjs_strip_unix_shebang(script,
-                                    &script_len,
-                                    &start_line_number);
-
     /* log and clear exception if it's set (should not be, normally...) */
     if (JS_IsExceptionPending(context)) {
         g_warning("gjs_eval_in_scope called with a pending exception");
         return false;
     }
 
+    JS::RootedScript compiled(context);
+
+    if (file != NULL) {
+        GjsProfileScope profile(GJS_PROFILE_COMPILE, NULL, filename);
+
+        compiled = gjs_prefetch_take_script(context, file, script, script_len);
+        if (!compiled && JS_IsExceptionPending(context))
+            return false;  /* Compile error from the helper thread */
+
+        cache_key = gjs_bytecode_cache_get_key(context, file, script, script_len);
+    }
+
+    script = gjs_strip_unix_shebang(script,
+                                    &script_len,
+                                    &start_line_number);
+
     JS::RootedObject eval_obj(context, object);
     if (!eval_obj)
         eval_obj = JS_NewObject(context, NULL, JS::NullPtr(), JS::NullPtr());
 
+    /* ASCII is also Latin-1, which the compiler widens much faster than
+     * it decodes UTF-8 */
     JS::CompileOptions options(context);
-    options.setUTF8(true)
+    options.setUTF8(!gjs_string_is_ascii(script, script_len))
            .setFileAndLine(filename, start_line_number)
            .setSourceIsLazy(true);
 
-    if (!JS::Evaluate(context, eval_obj, options, script, script_len, retval))
+    /* This is what JS::Evaluate() does, but keeping the script around so
+     * that its bytecode can be cached, and so that compiling and executing
+     * it are profiled separately. Scripts compiled off the main thread are
+     * cached as soon as we get them. */
+    {
+        GjsProfileScope profile(GJS_PROFILE_COMPILE, NULL, filename);
+
+        if (compiled) {
+            if (cache_key != NULL)
+                gjs_bytecode_cache_store(context, cache_key, compiled);
+        } else if (cache_key != NULL) {
+            compiled = gjs_bytecode_cache_load(context, cache_key);
+        }
+
+        if (!compiled) {
+            /* Scripts must not be compile-and-go to be serialized; they
+             * aren't anyway, since we never evaluate files in the global
+             * scope. */
+            options.setCompileAndGo(cache_key == NULL &&
+                                    JS_GetGlobalForObject(context, eval_obj) == eval_obj);
+            compiled = JS::Compile(context, eval_obj, options, script,
+                                   script_len);
+            if (compiled && cache_key != NULL)
+                gjs_bytecode_cache_store(context, cache_key, compiled);
+        }
+    }
+
+    g_free(cache_key);
+
+    if (!compiled)
         return false;
 
+    {
+        GjsProfileScope profile(GJS_PROFILE_EXECUTE, NULL, filename);
+
+        if (!JS_ExecuteScript(context, eval_obj, compiled, retval))
+            return false;
+    }
+
     gjs_schedule_gc_if_needed(context);
 
     if (JS_IsExceptionPending(context)) {
@@ -894,3 +1007,84 @@ gjs_eval_with_scope(JSContext             *context,
 
     return true;
 }
+
+bool
+gjs_eval_with_scope(JSContext             *context,
+                    JS::HandleObject       object,
+                    const char            *script,
+                    ssize_t                script_len,
+                    const char            *filename,
+                    JS::MutableHandleValue retval)
+{
+    return eval_with_scope_internal(context, object, script, script_len,
+                                    filename, NULL, retval);
+}
+
+/**
+ * gjs_eval_file_with_scope:
+ * @file: the file @script was loaded from
+ *
+ * Like gjs_eval_with_scope(), but the compiled script may be taken from,
+ * or saved to, the bytecode cache.
+ */
+bool
+gjs_eval_file_with_scope(JSContext             *context,
+                         JS::HandleObject       object,
+                         GFile                 *file,
+                         const char            *script,
+                         ssize_t                script_len,
+                         const char            *filename,
+                         JS::MutableHandleValue retval)
+{
+    return eval_with_scope_internal(context, object, script, script_len,
+                                    filename, file, retval);
+}
+
+/**
+ * gjs_file_load_bytes:
+ * @file: a script file
+ * @error: return location for a #GError
+ *
+ * Loads the contents of @file without copying them where possible: files
+ * in GResources are borrowed from the resource data, and local files are
+ * mapped into memory. The data is not nul-terminated.
+ *
+ * Returns: (transfer full): the contents of @file, or %NULL on error
+ */
+GBytes *
+gjs_file_load_bytes(GFile   *file,
+                    GError **error)
+{
+    GBytes *bytes = NULL;
+    char *contents;
+    gsize len;
+
+    if (g_file_has_uri_scheme(file, "resource")) {
+        char *uri = g_file_get_uri(file);
+        char *path = g_uri_unescape_string(uri + strlen("resource://"), NULL);
+
+        bytes = g_resources_lookup_data(path, G_RESOURCE_LOOKUP_FLAGS_NONE,
+                                        NULL);
+        g_free(path);
+        g_free(uri);
+    } else if (g_file_is_native(file)) {
+        char *path = g_file_get_path(file);
+        GMappedFile *mapped = g_mapped_file_new(path, false, NULL);
+
+        if (mapped != NULL) {
+            bytes = g_mapped_file_get_bytes(mapped);
+            g_mapped_file_unref(mapped);
+        }
+        g_free(path);
+    }
+
+    if (bytes != NULL)
+        return bytes;
+
+    /* Not found, a directory, or something exotic; let GIO sort it out
+     * so that the caller gets the usual G_IO_ERROR */
+    if (!g_file_load_contents(file, NULL, &contents, &len, NULL, error))
+        return NULL;
+
+    return g_bytes_new_take(contents, len);
+}
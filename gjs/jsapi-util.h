@@ -27,6 +27,7 @@
 #include <stdbool.h>
 
 #include <glib-object.h>
+#include <gio/gio.h>
 #include <mozilla/Maybe.h>
 
 #include "jsapi-wrapper.h"
@@ -394,6 +395,8 @@ bool gjs_string_from_utf8(JSContext             *context,
                           const char            *utf8_string,
                           ssize_t                n_bytes,
                           JS::MutableHandleValue value_p);
+bool        gjs_string_is_ascii              (const char      *str,
+                                              gsize            len);
 
 bool        gjs_string_to_filename           (JSContext       *context,
                                               const JS::Value  string_val,
@@ -433,6 +436,9 @@ const char* gjs_get_type_name                (JS::Value        value);
 
 void gjs_maybe_gc (JSContext *context);
 
+void gjs_gc_note_native_alloc(JSContext *context,
+                              size_t     nbytes);
+
 bool gjs_context_get_frame_info(JSContext                              *context,
                                 mozilla::Maybe<JS::MutableHandleValue>& stack,
                                 mozilla::Maybe<JS::MutableHandleValue>& fileName,
@@ -445,6 +451,17 @@ bool gjs_eval_with_scope(JSContext             *context,
                          const char            *filename,
                          JS::MutableHandleValue retval);
 
+bool gjs_eval_file_with_scope(JSContext             *context,
+                              JS::HandleObject       object,
+                              GFile                 *file,
+                              const char            *script,
+                              ssize_t                script_len,
+                              const char            *filename,
+                              JS::MutableHandleValue retval);
+
+GBytes *gjs_file_load_bytes(GFile   *file,
+                            GError **error);
+
 typedef enum {
   GJS_STRING_CONSTRUCTOR,
   GJS_STRING_PROTOTYPE,
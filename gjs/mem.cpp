@@ -23,12 +23,14 @@
 
 #include <config.h>
 
+#include <string.h>
+
 #include "mem.h"
 #include <util/log.h>
 
 #define GJS_DEFINE_COUNTER(name)             \
     GjsMemCounter gjs_counter_ ## name = { \
-        0, #name                                \
+        0, 0, #name                             \
     };
 
 
@@ -71,6 +73,232 @@ static GjsMemCounter* counters[] = {
     GJS_LIST_COUNTER(constructor_proxy),
 };
 
+G_STATIC_ASSERT(G_N_ELEMENTS(counters) == GJS_N_COUNTERS);
+
+/* The accounting for one type; finalized counts the wrappers released
+ * since the start, finalized_at_gc_begin is what it was when the last
+ * collection started */
+typedef struct {
+    GjsTypeCounter counter;
+    int            finalized;
+    int            finalized_at_gc_begin;
+} TypeEntry;
+
+static GMutex types_lock;
+static GHashTable *types;  /* interned name -> TypeEntry */
+
+/**
+ * gjs_memory_account_type:
+ * @kind: kind of wrapper, such as "object" or "boxed", or "cache"
+ * @name: an interned string, the GType name or the introspection name of
+ *   the wrapped type, or the name of the cached structure
+ * @delta_live: change in the number of live wrappers or cache entries
+ * @delta_bytes: change in the native memory held by the wrappers
+ *
+ * Updates the per-type accounting shown by gjs_memory_get_type_report().
+ * Called when wrappers are created and finalized, and when entries are
+ * added to or removed from the native caches.
+ */
+void
+gjs_memory_account_type(const char *kind,
+                        const char *name,
+                        int         delta_live,
+                        gint64      delta_bytes)
+{
+    TypeEntry *entry;
+
+    g_mutex_lock(&types_lock);
+
+    if (G_UNLIKELY(types == NULL))
+        types = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL,
+                                      g_free);
+
+    entry = (TypeEntry *) g_hash_table_lookup(types, name);
+    if (entry == NULL) {
+        entry = g_new0(TypeEntry, 1);
+        entry->counter.kind = kind;
+        entry->counter.name = name;
+        g_hash_table_insert(types, (gpointer) name, entry);
+    }
+
+    entry->counter.live += delta_live;
+    entry->counter.bytes += delta_bytes;
+    if (delta_live < 0)
+        entry->finalized -= delta_live;
+
+    g_mutex_unlock(&types_lock);
+}
+
+static int
+compare_type_counters(const void *a,
+                      const void *b)
+{
+    const GjsTypeCounter *ca = (const GjsTypeCounter *) a;
+    const GjsTypeCounter *cb = (const GjsTypeCounter *) b;
+
+    if (ca->bytes != cb->bytes)
+        return ca->bytes < cb->bytes ? 1 : -1;
+    if (ca->live != cb->live)
+        return cb->live - ca->live;
+    return strcmp(ca->name, cb->name);
+}
+
+/**
+ * gjs_memory_get_type_report:
+ * @n_types: (out): return location for the number of entries
+ *
+ * Returns: (transfer full): a newly allocated array of the types that
+ * currently have live wrappers, the ones holding the most native memory
+ * first, then the ones with the most wrappers. Free with g_free().
+ */
+GjsTypeCounter *
+gjs_memory_get_type_report(unsigned *n_types)
+{
+    GArray *report;
+    GHashTableIter iter;
+    gpointer value;
+
+    report = g_array_new(false, false, sizeof(GjsTypeCounter));
+
+    g_mutex_lock(&types_lock);
+    if (types != NULL) {
+        g_hash_table_iter_init(&iter, types);
+        while (g_hash_table_iter_next(&iter, NULL, &value)) {
+            TypeEntry *entry = (TypeEntry *) value;
+            if (entry->counter.live > 0)
+                g_array_append_val(report, entry->counter);
+        }
+    }
+    g_mutex_unlock(&types_lock);
+
+    g_array_sort(report, compare_type_counters);
+
+    *n_types = report->len;
+    return (GjsTypeCounter *) g_array_free(report, false);
+}
+
+static GMutex gc_history_lock;
+static GjsGcInfo gc_history[GJS_GC_HISTORY_SIZE];
+static guint64 gc_count;
+
+const char *
+gjs_memory_get_counter_name(unsigned i)
+{
+    g_return_val_if_fail(i < GJS_N_COUNTERS, NULL);
+    return counters[i]->name;
+}
+
+/* Called when a collection starts; @info must have its runtime, start
+ * time, reason and heap size filled in already */
+void
+gjs_memory_gc_begin(GjsGcInfo *info)
+{
+    GHashTableIter iter;
+    gpointer value;
+    unsigned i;
+
+    for (i = 0; i < GJS_N_COUNTERS; ++i)
+        info->finalized[i] = g_atomic_int_get(&counters[i]->finalized);
+
+    g_mutex_lock(&types_lock);
+    if (types != NULL) {
+        g_hash_table_iter_init(&iter, types);
+        while (g_hash_table_iter_next(&iter, NULL, &value)) {
+            TypeEntry *entry = (TypeEntry *) value;
+            entry->finalized_at_gc_begin = entry->finalized;
+        }
+    }
+    g_mutex_unlock(&types_lock);
+}
+
+/* Keeps the GJS_GC_FINALIZED_TYPES types with the most finalized wrappers
+ * in @info, sorted by count */
+static void
+record_finalized_type(GjsGcInfo  *info,
+                      const char *name,
+                      int         count)
+{
+    unsigned i;
+
+    for (i = info->n_finalized_types; i > 0; i--) {
+        if (info->finalized_types[i - 1].count >= count)
+            break;
+        if (i < GJS_GC_FINALIZED_TYPES)
+            info->finalized_types[i] = info->finalized_types[i - 1];
+    }
+
+    if (i == GJS_GC_FINALIZED_TYPES)
+        return;
+
+    info->finalized_types[i].name = name;
+    info->finalized_types[i].count = count;
+    if (info->n_finalized_types < GJS_GC_FINALIZED_TYPES)
+        info->n_finalized_types++;
+}
+
+/* Called when a collection is finished, records @info in the history */
+void
+gjs_memory_gc_end(GjsGcInfo *info)
+{
+    GHashTableIter iter;
+    gpointer value;
+    unsigned i;
+
+    for (i = 0; i < GJS_N_COUNTERS; ++i)
+        info->finalized[i] =
+            g_atomic_int_get(&counters[i]->finalized) - info->finalized[i];
+
+    info->n_finalized_types = 0;
+    g_mutex_lock(&types_lock);
+    if (types != NULL) {
+        g_hash_table_iter_init(&iter, types);
+        while (g_hash_table_iter_next(&iter, NULL, &value)) {
+            TypeEntry *entry = (TypeEntry *) value;
+            int count = entry->finalized - entry->finalized_at_gc_begin;
+
+            /* Only wrappers, not the entries of native caches */
+            if (count > 0 && strcmp(entry->counter.kind, "cache") != 0)
+                record_finalized_type(info, entry->counter.name, count);
+        }
+    }
+    g_mutex_unlock(&types_lock);
+
+    g_mutex_lock(&gc_history_lock);
+    gc_history[gc_count % GJS_GC_HISTORY_SIZE] = *info;
+    gc_count++;
+    g_mutex_unlock(&gc_history_lock);
+}
+
+/* Total number of collections recorded so far, the serial of the next one */
+guint64
+gjs_memory_get_gc_count(void)
+{
+    guint64 retval;
+
+    g_mutex_lock(&gc_history_lock);
+    retval = gc_count;
+    g_mutex_unlock(&gc_history_lock);
+
+    return retval;
+}
+
+/* Copies the record of collection number @serial into @info. Returns false
+ * if it didn't happen yet or was dropped from the history. */
+bool
+gjs_memory_get_gc_info(guint64    serial,
+                       GjsGcInfo *info)
+{
+    bool found;
+
+    g_mutex_lock(&gc_history_lock);
+    found = serial < gc_count && gc_count - serial <= GJS_GC_HISTORY_SIZE;
+    if (found)
+        *info = gc_history[serial % GJS_GC_HISTORY_SIZE];
+    g_mutex_unlock(&gc_history_lock);
+
+    return found;
+}
+
 void
 gjs_memory_report(const char *where,
                   bool        die_if_leaks)
@@ -78,6 +306,8 @@ gjs_memory_report(const char *where,
     int i;
     int n_counters;
     int total_objects;
+    GjsTypeCounter *report;
+    unsigned n_types, j;
 
     gjs_debug(GJS_DEBUG_MEMORY,
               "Memory report: %s",
@@ -106,6 +336,17 @@ gjs_memory_report(const char *where,
                   counters[i]->value);
     }
 
+    report = gjs_memory_get_type_report(&n_types);
+    if (n_types > 0)
+        gjs_debug(GJS_DEBUG_MEMORY, "  Live wrappers by type:");
+    for (j = 0; j < n_types; ++j) {
+        gjs_debug(GJS_DEBUG_MEMORY,
+                  "    %8s %-32s %6d wrappers %10" G_GINT64_FORMAT " bytes",
+                  report[j].kind, report[j].name,
+                  report[j].live, report[j].bytes);
+    }
+    g_free(report);
+
     if (die_if_leaks && GJS_GET_COUNTER(everything) > 0) {
         g_error("%s: JavaScript objects were leaked.", where);
     }
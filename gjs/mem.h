@@ -32,6 +32,7 @@ G_BEGIN_DECLS
 
 typedef struct {
     volatile int value;
+    volatile int finalized;
     const char *name;
 } GjsMemCounter;
 
@@ -66,6 +67,7 @@ GJS_DECLARE_COUNTER(constructor_proxy)
     do {                                        \
         g_atomic_int_add(&gjs_counter_everything.value, -1); \
         g_atomic_int_add(&gjs_counter_ ## name .value, -1); \
+        g_atomic_int_add(&gjs_counter_ ## name .finalized, 1); \
     } while (0)
 
 #define GJS_GET_COUNTER(name) \
@@ -74,6 +76,63 @@ GJS_DECLARE_COUNTER(constructor_proxy)
 void gjs_memory_report(const char *where,
                        bool        die_if_leaks);
 
+/* Live wrappers and estimated native bytes for one GType or struct type */
+typedef struct {
+    const char *kind;
+    const char *name;
+    int         live;
+    gint64      bytes;
+} GjsTypeCounter;
+
+void            gjs_memory_account_type    (const char *kind,
+                                            const char *name,
+                                            int         delta_live,
+                                            gint64      delta_bytes);
+
+GjsTypeCounter *gjs_memory_get_type_report (unsigned   *n_types);
+
+/* Number of counters, not including "everything" */
+#define GJS_N_COUNTERS 15
+
+const char *gjs_memory_get_counter_name(unsigned i);
+
+/* Maximum number of types listed in GjsGcInfo.finalized_types */
+#define GJS_GC_FINALIZED_TYPES 16
+
+typedef struct {
+    const char *name;  /* interned, as given to gjs_memory_account_type() */
+    int         count;
+} GjsFinalizedType;
+
+/* Telemetry about one garbage collection. Times are from
+ * g_get_monotonic_time(), finalized counts the wrappers of each counter
+ * that were released while the collection was in progress, and
+ * finalized_types the types that most of them belonged to, most first. */
+typedef struct {
+    JSRuntime  *runtime;
+    gint64      start_time;
+    gint64      end_time;
+    const char *reason;
+    bool        full;
+    unsigned    n_slices;
+    gint64      max_slice_duration;
+    size_t      heap_bytes_before;
+    size_t      heap_bytes_after;
+    int         finalized[GJS_N_COUNTERS];
+    GjsFinalizedType finalized_types[GJS_GC_FINALIZED_TYPES];
+    unsigned    n_finalized_types;
+} GjsGcInfo;
+
+/* Number of GC records kept by gjs_memory_get_gc_info() */
+#define GJS_GC_HISTORY_SIZE 64
+
+void    gjs_memory_gc_begin     (GjsGcInfo *info);
+void    gjs_memory_gc_end       (GjsGcInfo *info);
+
+guint64 gjs_memory_get_gc_count (void);
+bool    gjs_memory_get_gc_info  (guint64    serial,
+                                 GjsGcInfo *info);
+
 G_END_DECLS
 
 #endif  /* __GJS_MEM_H__ */
@@ -0,0 +1,453 @@
+/* -*- mode: C; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+/* Compilation of scripts on SpiderMonkey's helper threads.
+ *
+ * gjs_prefetch_file() starts compiling a script that is going to be
+ * evaluated soon; when it is, gjs_eval_file_with_scope() waits for the
+ * compiled script instead of compiling it on the main thread. Importers
+ * expose this as importer.__prefetch__().
+ *
+ * Each context also records which files it imports while running its
+ * main program, and saves them to $XDG_CACHE_HOME/gjs/prefetch when it is
+ * destroyed. The next run of the same program starts compiling all of
+ * them at once, while the main program is still being compiled. Files
+ * whose bytecode is in the bytecode cache are not worth compiling and are
+ * skipped.
+ *
+ * Set GJS_DISABLE_PREFETCH in the environment to disable it. Like the
+ * bytecode cache, it is disabled when a debugger is attached, since
+ * scripts compiled off the main thread are invisible to it.
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <string.h>
+
+#include "bytecode-cache.h"
+#include "context-private.h"
+#include "jsapi-util.h"
+#include "prefetch.h"
+#include <util/log.h>
+
+#define MANIFEST_HEADER "GJS prefetch manifest 1"
+
+typedef struct {
+    GjsPrefetcher *prefetcher;
+    GBytes        *source;  /* to check that the file didn't change */
+    gunichar2     *chars;   /* must outlive the compilation */
+    void          *token;
+    bool           done;
+} PrefetchTask;
+
+struct _GjsPrefetcher {
+    GMutex      lock;
+    GCond       done_cond;
+    GHashTable *tasks;  /* URI -> PrefetchTask */
+
+    char       *main_uri;
+    char       *manifest_path;
+    GHashTable *manifest;  /* URIs listed in the manifest we loaded */
+    GPtrArray  *imported;  /* URIs imported during this run, in order */
+    GHashTable *imported_set;
+};
+
+static bool
+prefetch_enabled(JSContext *context)
+{
+    static int disabled = -1;
+
+    if (G_UNLIKELY(disabled < 0))
+        disabled = g_getenv("GJS_DISABLE_PREFETCH") != NULL;
+
+    return !disabled && !JS_GetDebugMode(context);
+}
+
+static GjsPrefetcher *
+get_prefetcher(JSContext *context)
+{
+    GjsContext *gjs_context = (GjsContext *) JS_GetContextPrivate(context);
+
+    return _gjs_context_get_prefetcher(gjs_context);
+}
+
+GjsPrefetcher *
+gjs_prefetcher_new(void)
+{
+    GjsPrefetcher *prefetcher = g_slice_new0(GjsPrefetcher);
+
+    g_mutex_init(&prefetcher->lock);
+    g_cond_init(&prefetcher->done_cond);
+    prefetcher->tasks = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                              g_free, NULL);
+    prefetcher->imported = g_ptr_array_new_with_free_func(g_free);
+    prefetcher->imported_set = g_hash_table_new(g_str_hash, g_str_equal);
+
+    return prefetcher;
+}
+
+/* Called on the helper thread when the compilation is finished */
+static void
+on_compiled(void *token,
+            void *data)
+{
+    PrefetchTask *task = (PrefetchTask *) data;
+    GjsPrefetcher *prefetcher = task->prefetcher;
+
+    g_mutex_lock(&prefetcher->lock);
+    task->token = token;
+    task->done = true;
+    g_cond_broadcast(&prefetcher->done_cond);
+    g_mutex_unlock(&prefetcher->lock);
+}
+
+/* Scripts parsed off the main thread while an incremental GC is collecting
+ * the atoms zone are not started until the GC is finished, which cannot
+ * happen while the main thread is blocked waiting for them. */
+static void
+finish_incremental_gc(JSContext *context)
+{
+    JSRuntime *runtime = JS_GetRuntime(context);
+
+    if (JS::IsIncrementalGCInProgress(runtime)) {
+        gjs_debug(GJS_DEBUG_IMPORTER, "Finishing incremental GC before "
+                  "waiting for prefetched script");
+        JS::FinishIncrementalGC(runtime, JS::gcreason::API);
+    }
+}
+
+/* Waits for the compilation of @task, and returns its script. The task is
+ * freed. */
+static JSScript *
+finish_task(JSContext    *context,
+            PrefetchTask *task)
+{
+    GjsPrefetcher *prefetcher = task->prefetcher;
+    gint64 start = g_get_monotonic_time();
+    JSScript *script;
+
+    finish_incremental_gc(context);
+
+    g_mutex_lock(&prefetcher->lock);
+    while (!task->done)
+        g_cond_wait(&prefetcher->done_cond, &prefetcher->lock);
+    g_mutex_unlock(&prefetcher->lock);
+
+    script = JS::FinishOffThreadScript(context, JS_GetRuntime(context),
+                                       task->token);
+
+    gjs_debug(GJS_DEBUG_IMPORTER, "Waited %" G_GINT64_FORMAT " us for "
+              "prefetched script", g_get_monotonic_time() - start);
+
+    g_bytes_unref(task->source);
+    g_free(task->chars);
+    g_slice_free(PrefetchTask, task);
+
+    return script;
+}
+
+static void
+save_manifest(GjsPrefetcher *prefetcher)
+{
+    GString *contents;
+    char *dir;
+    unsigned i;
+    bool changed;
+    GError *error = NULL;
+
+    changed = prefetcher->manifest == NULL ||
+        g_hash_table_size(prefetcher->manifest) != prefetcher->imported->len;
+    for (i = 0; !changed && i < prefetcher->imported->len; i++)
+        changed = !g_hash_table_contains(prefetcher->manifest,
+                                         g_ptr_array_index(prefetcher->imported, i));
+    if (!changed)
+        return;
+
+    contents = g_string_new(MANIFEST_HEADER "\n");
+    for (i = 0; i < prefetcher->imported->len; i++) {
+        g_string_append(contents,
+                        (const char *) g_ptr_array_index(prefetcher->imported, i));
+        g_string_append_c(contents, '\n');
+    }
+
+    dir = g_path_get_dirname(prefetcher->manifest_path);
+    if (g_mkdir_with_parents(dir, 0700) < 0 ||
+        !g_file_set_contents(prefetcher->manifest_path, contents->str,
+                             contents->len, &error)) {
+        gjs_debug(GJS_DEBUG_IMPORTER, "Failed to write prefetch manifest %s: %s",
+                  prefetcher->manifest_path,
+                  error ? error->message : g_strerror(errno));
+        g_clear_error(&error);
+    }
+
+    g_free(dir);
+    g_string_free(contents, true);
+}
+
+/**
+ * gjs_prefetcher_free:
+ * @prefetcher: a #GjsPrefetcher
+ * @context: the #JSContext it belongs to, whose global must still be alive
+ *
+ * Discards the scripts that were prefetched but never used, and saves the
+ * manifest of imported files if it changed.
+ */
+void
+gjs_prefetcher_free(GjsPrefetcher *prefetcher,
+                    JSContext     *context)
+{
+    GHashTableIter iter;
+    gpointer task;
+
+    /* The scripts must be finished even if unused, to release the
+     * resources SpiderMonkey holds for them */
+    g_hash_table_iter_init(&iter, prefetcher->tasks);
+    while (g_hash_table_iter_next(&iter, NULL, &task)) {
+        finish_task(context, (PrefetchTask *) task);
+        JS_ClearPendingException(context);
+    }
+    g_hash_table_destroy(prefetcher->tasks);
+
+    if (prefetcher->manifest_path != NULL)
+        save_manifest(prefetcher);
+
+    g_free(prefetcher->main_uri);
+    g_free(prefetcher->manifest_path);
+    if (prefetcher->manifest != NULL)
+        g_hash_table_destroy(prefetcher->manifest);
+    g_hash_table_destroy(prefetcher->imported_set);
+    g_ptr_array_free(prefetcher->imported, true);
+    g_mutex_clear(&prefetcher->lock);
+    g_cond_clear(&prefetcher->done_cond);
+    g_slice_free(GjsPrefetcher, prefetcher);
+}
+
+/**
+ * gjs_prefetch_file:
+ * @context: the #JSContext
+ * @file: a script that is going to be imported
+ *
+ * Starts compiling @file on a helper thread. Nothing happens if the
+ * script is too small to be worth it, or already in the bytecode cache.
+ *
+ * Returns: whether @file is being compiled
+ */
+bool
+gjs_prefetch_file(JSContext *context,
+                  GFile     *file)
+{
+    GjsPrefetcher *prefetcher = get_prefetcher(context);
+    PrefetchTask *task;
+    GBytes *source = NULL;
+    const char *script;
+    gsize len;
+    gssize stripped_len;
+    int start_line_number;
+    char *uri, *cache_key, *filename = NULL;
+    gunichar2 *chars = NULL;
+    glong n_chars;
+    bool ret = false;
+
+    if (!prefetch_enabled(context))
+        return false;
+
+    uri = g_file_get_uri(file);
+    if (g_hash_table_contains(prefetcher->tasks, uri)) {
+        ret = true;
+        goto out;
+    }
+
+    source = gjs_file_load_bytes(file, NULL);
+    if (source == NULL)
+        goto out;
+
+    script = (const char *) g_bytes_get_data(source, &len);
+    if (script == NULL)
+        goto out;
+
+    cache_key = gjs_bytecode_cache_get_key(context, file, script, len);
+    if (cache_key != NULL) {
+        bool cached = gjs_bytecode_cache_has(context, cache_key);
+        g_free(cache_key);
+        if (cached)
+            goto out;
+    }
+
+    stripped_len = len;
+    script = gjs_strip_unix_shebang(script, &stripped_len, &start_line_number);
+    if (script == NULL)
+        goto out;
+
+    chars = g_utf8_to_utf16(script, stripped_len, NULL, &n_chars, NULL);
+    if (chars == NULL)
+        goto out;  /* invalid UTF-8, let the main thread report it */
+
+    {
+        /* Same options as gjs_eval_file_with_scope() */
+        filename = g_file_get_parse_name(file);
+        JS::CompileOptions options(context);
+        options.setFileAndLine(filename, start_line_number)
+               .setSourceIsLazy(true)
+               .setCompileAndGo(false);
+
+        if (!JS::CanCompileOffThread(context, options, n_chars))
+            goto out;
+
+        task = g_slice_new0(PrefetchTask);
+        task->prefetcher = prefetcher;
+        task->source = g_bytes_ref(source);
+        task->chars = chars;
+
+        if (!JS::CompileOffThread(context, options, (const jschar *) chars,
+                                  n_chars, on_compiled, task)) {
+            JS_ClearPendingException(context);
+            g_bytes_unref(task->source);
+            g_slice_free(PrefetchTask, task);
+            goto out;
+        }
+    }
+
+    gjs_debug(GJS_DEBUG_IMPORTER, "Compiling %s off the main thread", filename);
+
+    g_hash_table_insert(prefetcher->tasks, uri, task);
+    uri = NULL;
+    chars = NULL;
+    ret = true;
+
+ out:
+    g_free(filename);
+    g_free(chars);
+    g_free(uri);
+    if (source != NULL)
+        g_bytes_unref(source);
+    return ret;
+}
+
+/**
+ * gjs_prefetch_take_script:
+ * @context: the #JSContext
+ * @file: the file @script was loaded from
+ * @script: the contents of @file
+ * @script_len: the length of @script
+ *
+ * Called when @file is about to be evaluated; waits for it to finish
+ * compiling if it was prefetched, and records it in the manifest.
+ *
+ * Returns: the compiled script, or %NULL if @file was not prefetched (or
+ * has changed since), or if compiling it failed, in which case an
+ * exception is pending. The caller must root it.
+ */
+JSScript *
+gjs_prefetch_take_script(JSContext  *context,
+                         GFile      *file,
+                         const char *script,
+                         gsize       script_len)
+{
+    GjsPrefetcher *prefetcher = get_prefetcher(context);
+    char *uri = g_file_get_uri(file);
+    gpointer key, task;
+    JSScript *compiled = NULL;
+
+    if (prefetcher->main_uri != NULL && strcmp(uri, prefetcher->main_uri) != 0 &&
+        !g_hash_table_contains(prefetcher->imported_set, uri)) {
+        char *imported = g_strdup(uri);
+        g_ptr_array_add(prefetcher->imported, imported);
+        g_hash_table_add(prefetcher->imported_set, imported);
+    }
+
+    if (g_hash_table_lookup_extended(prefetcher->tasks, uri, &key, &task)) {
+        GBytes *source = g_bytes_ref(((PrefetchTask *) task)->source);
+
+        g_hash_table_steal(prefetcher->tasks, uri);
+        g_free(key);
+
+        compiled = finish_task(context, (PrefetchTask *) task);
+
+        if (g_bytes_get_size(source) != script_len ||
+            memcmp(g_bytes_get_data(source, NULL), script, script_len) != 0) {
+            gjs_debug(GJS_DEBUG_IMPORTER, "Prefetched %s has changed", uri);
+            JS_ClearPendingException(context);
+            compiled = NULL;
+        }
+
+        g_bytes_unref(source);
+    }
+
+    g_free(uri);
+    return compiled;
+}
+
+/**
+ * gjs_prefetch_start_manifest:
+ * @context: the #JSContext
+ * @main_file: the main program of @context
+ *
+ * Starts prefetching the files that @main_file imported in its last run,
+ * and recording the files it imports in this one. Only the first main
+ * program of a context is taken into account.
+ */
+void
+gjs_prefetch_start_manifest(JSContext *context,
+                            GFile     *main_file)
+{
+    GjsPrefetcher *prefetcher = get_prefetcher(context);
+    char *checksum, *contents, **lines;
+    unsigned i;
+
+    if (prefetcher->main_uri != NULL || !prefetch_enabled(context))
+        return;
+
+    prefetcher->main_uri = g_file_get_uri(main_file);
+
+    checksum = g_compute_checksum_for_string(G_CHECKSUM_SHA1,
+                                             prefetcher->main_uri, -1);
+    prefetcher->manifest_path = g_build_filename(g_get_user_cache_dir(), "gjs",
+                                                 "prefetch", checksum, NULL);
+    g_free(checksum);
+
+    if (!g_file_get_contents(prefetcher->manifest_path, &contents, NULL, NULL))
+        return;
+
+    lines = g_strsplit(contents, "\n", -1);
+    g_free(contents);
+
+    if (g_strcmp0(lines[0], MANIFEST_HEADER) == 0) {
+        prefetcher->manifest = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                                     g_free, NULL);
+
+        for (i = 1; lines[i] != NULL; i++) {
+            GFile *file;
+
+            if (lines[i][0] == '\0')
+                continue;
+
+            g_hash_table_add(prefetcher->manifest, g_strdup(lines[i]));
+
+            file = g_file_new_for_uri(lines[i]);
+            gjs_prefetch_file(context, file);
+            g_object_unref(file);
+        }
+    }
+
+    g_strfreev(lines);
+}
@@ -23,13 +23,20 @@
 
 #include <config.h>
 
+#include "context-private.h"
 #include "jsapi-util.h"
 #include "jsapi-wrapper.h"
+#include "mem.h"
 #include "runtime.h"
 
 struct RuntimeData {
   unsigned refcount;
   bool in_gc_sweep;
+  size_t native_bytes_since_gc;
+  gint64 gc_slice_start;
+  gint64 last_gc_slice_duration;
+  const char *next_gc_reason;
+  GjsGcInfo gc_info;
 };
 
 bool
@@ -40,6 +47,48 @@ gjs_runtime_is_sweeping (JSRuntime *runtime)
   return data->in_gc_sweep;
 }
 
+/* Native memory allocated on behalf of JS wrappers since the last
+ * collection, see gjs_gc_note_native_alloc() */
+void
+gjs_runtime_note_native_alloc (JSRuntime *runtime,
+                               size_t     nbytes)
+{
+  RuntimeData *data = (RuntimeData*) JS_GetRuntimePrivate(runtime);
+
+  data->native_bytes_since_gc += nbytes;
+}
+
+size_t
+gjs_runtime_get_native_bytes_since_gc (JSRuntime *runtime)
+{
+  RuntimeData *data = (RuntimeData*) JS_GetRuntimePrivate(runtime);
+
+  return data->native_bytes_since_gc;
+}
+
+/* Duration in microseconds of the last GC slice, or of the last
+ * non-incremental GC */
+gint64
+gjs_runtime_get_last_gc_slice_duration (JSRuntime *runtime)
+{
+  RuntimeData *data = (RuntimeData*) JS_GetRuntimePrivate(runtime);
+
+  return data->last_gc_slice_duration;
+}
+
+/* Records why GJS is about to start a collection, for the GC telemetry;
+ * @reason must be a static string. Collections started by SpiderMonkey
+ * on its own are reported with the reason "ENGINE". */
+void
+gjs_runtime_set_next_gc_reason (JSRuntime  *runtime,
+                                const char *reason)
+{
+  RuntimeData *data = (RuntimeData*) JS_GetRuntimePrivate(runtime);
+
+  if (!JS::IsIncrementalGCInProgress(runtime))
+    data->next_gc_reason = reason;
+}
+
 /* Implementations of locale-specific operations; these are used
  * in the implementation of String.localeCompare(), Date.toLocaleDateString(),
  * and so forth. We take the straight-forward approach of converting
@@ -221,6 +270,58 @@ gjs_finalize_callback(JSFreeOp         *fop,
     data->in_gc_sweep = true;
   else if (status == JSFINALIZE_GROUP_END)
     data->in_gc_sweep = false;
+  else if (status == JSFINALIZE_COLLECTION_END)
+    data->native_bytes_since_gc = 0;
+}
+
+/* Note that mozjs 31 reports the first slice of a collection with
+ * GC_CYCLE_BEGIN instead of GC_SLICE_BEGIN, and the last one with
+ * GC_CYCLE_END instead of GC_SLICE_END; a non-incremental GC is a
+ * single slice. */
+static void
+gjs_gc_slice_callback(JSRuntime                *runtime,
+                      JS::GCProgress            progress,
+                      const JS::GCDescription&  desc)
+{
+  RuntimeData *data = (RuntimeData*) JS_GetRuntimePrivate(runtime);
+  GjsGcInfo *info = &data->gc_info;
+  gint64 now = g_get_monotonic_time();
+
+  switch (progress) {
+  case JS::GC_CYCLE_BEGIN:
+    info->runtime = runtime;
+    info->start_time = now;
+    info->reason = data->next_gc_reason ? data->next_gc_reason : "ENGINE";
+    info->full = !desc.isCompartment;
+    info->n_slices = 0;
+    info->max_slice_duration = 0;
+    info->heap_bytes_before = JS_GetGCParameter(runtime, JSGC_BYTES);
+    gjs_memory_gc_begin(info);
+    data->next_gc_reason = NULL;
+    /* fall through */
+  case JS::GC_SLICE_BEGIN:
+    data->gc_slice_start = now;
+    break;
+  case JS::GC_SLICE_END:
+  case JS::GC_CYCLE_END:
+    data->last_gc_slice_duration = now - data->gc_slice_start;
+    info->n_slices++;
+    info->max_slice_duration = MAX(info->max_slice_duration,
+                                   data->last_gc_slice_duration);
+
+    gjs_debug(GJS_DEBUG_CONTEXT,
+              "GC slice %u took %" G_GINT64_FORMAT " us%s",
+              info->n_slices, data->last_gc_slice_duration,
+              progress == JS::GC_CYCLE_END ? ", collection finished" : "");
+
+    if (progress == JS::GC_CYCLE_END) {
+      info->end_time = now;
+      info->heap_bytes_after = JS_GetGCParameter(runtime, JSGC_BYTES);
+      gjs_memory_gc_end(info);
+      _gjs_context_schedule_gc_notify(runtime);
+    }
+    break;
+  }
 }
 
 /* Destroys the current thread's runtime regardless of refcount. No-op if there
@@ -268,8 +369,10 @@ gjs_runtime_for_current_thread(void)
 
         JS_SetNativeStackQuota(runtime, 1024*1024);
         JS_SetGCParameter(runtime, JSGC_MAX_BYTES, 0xffffffff);
+        JS_SetGCParameter(runtime, JSGC_MODE, JSGC_MODE_INCREMENTAL);
         JS_SetLocaleCallbacks(runtime, &gjs_locale_callbacks);
         JS_SetFinalizeCallback(runtime, gjs_finalize_callback);
+        JS::SetGCSliceCallback(runtime, gjs_gc_slice_callback);
 
         g_private_set(&thread_runtime, runtime);
     }
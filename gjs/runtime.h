@@ -31,4 +31,12 @@ void gjs_runtime_unref(void);
 
 bool        gjs_runtime_is_sweeping        (JSRuntime *runtime);
 
+void        gjs_runtime_note_native_alloc          (JSRuntime *runtime,
+                                                    size_t     nbytes);
+size_t      gjs_runtime_get_native_bytes_since_gc  (JSRuntime *runtime);
+
+gint64      gjs_runtime_get_last_gc_slice_duration (JSRuntime  *runtime);
+void        gjs_runtime_set_next_gc_reason         (JSRuntime  *runtime,
+                                                    const char *reason);
+
 #endif /* __GJS_RUNTIME_H__ */
@@ -0,0 +1,202 @@
+/* -*- mode: C; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+/* Startup profiler.
+ *
+ * When GJS_PROFILE_STARTUP is set in the environment (gjs-console sets it
+ * for --profile-startup), the time spent importing modules, compiling and
+ * executing scripts, loading typelibs and defining GI infos and classes
+ * is measured. The measurements nest: the time of an import includes the
+ * imports done while executing the module, and a definition includes the
+ * definitions of parent classes. Identical frames under the same parent
+ * are merged.
+ *
+ * At exit, the tree is written in the "folded stacks" format read by
+ * flamegraph.pl and most flame graph viewers: one line per frame, with
+ * the frames from the root separated by semicolons, followed by the
+ * frame's self time in microseconds. The report goes to the file named
+ * by GJS_PROFILE_STARTUP, or to stderr if the variable is empty or "-".
+ *
+ * Only the thread that started profiling is measured.
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "startup-profile.h"
+
+typedef struct ProfileNode {
+    char       *label;
+    gint64      total;
+    unsigned    count;
+    GHashTable *children;  /* label -> ProfileNode */
+} ProfileNode;
+
+typedef struct {
+    ProfileNode *node;
+    gint64       start;
+} ProfileFrame;
+
+static const char *kind_labels[] = {
+    "import", "compile", "execute",
+    "require", "define", "class",
+};
+
+G_STATIC_ASSERT(G_N_ELEMENTS(kind_labels) == GJS_PROFILE_GI_CLASS + 1);
+
+static int enabled = -1;
+static GThread *profile_thread;
+static ProfileNode root;
+static GArray *stack;  /* ProfileFrame */
+
+static void write_report(void);
+
+bool
+gjs_startup_profile_enabled(void)
+{
+    if (G_UNLIKELY(enabled < 0)) {
+        enabled = g_getenv("GJS_PROFILE_STARTUP") != NULL;
+        if (enabled) {
+            profile_thread = g_thread_self();
+            stack = g_array_new(false, false, sizeof(ProfileFrame));
+            atexit(write_report);
+        }
+    }
+
+    return enabled && g_thread_self() == profile_thread;
+}
+
+void
+gjs_startup_profile_push(GjsProfileKind  kind,
+                         const char     *ns,
+                         const char     *name)
+{
+    ProfileNode *parent, *node;
+    ProfileFrame frame;
+    char *label;
+
+    if (stack->len > 0)
+        parent = g_array_index(stack, ProfileFrame, stack->len - 1).node;
+    else
+        parent = &root;
+
+    /* ';' separates frames in the report */
+    label = g_strdup_printf("%s %s%s%s", kind_labels[kind], ns ? ns : "",
+                            ns ? "." : "", name ? name : "?");
+    g_strdelimit(label, ";\n", '_');
+
+    if (parent->children == NULL)
+        parent->children = g_hash_table_new(g_str_hash, g_str_equal);
+
+    node = (ProfileNode *) g_hash_table_lookup(parent->children, label);
+    if (node == NULL) {
+        node = g_new0(ProfileNode, 1);
+        node->label = label;
+        g_hash_table_insert(parent->children, label, node);
+    } else {
+        g_free(label);
+    }
+
+    frame.node = node;
+    frame.start = g_get_monotonic_time();
+    g_array_append_val(stack, frame);
+}
+
+void
+gjs_startup_profile_pop(void)
+{
+    ProfileFrame *frame;
+
+    if (stack->len == 0)
+        return;
+
+    frame = &g_array_index(stack, ProfileFrame, stack->len - 1);
+    frame->node->total += g_get_monotonic_time() - frame->start;
+    frame->node->count++;
+    g_array_set_size(stack, stack->len - 1);
+}
+
+static void
+write_node(FILE        *out,
+           GString     *path,
+           ProfileNode *node)
+{
+    GHashTableIter iter;
+    gpointer child;
+    gint64 self = node->total;
+    gsize path_len = path->len;
+
+    if (path->len > 0)
+        g_string_append_c(path, ';');
+    g_string_append(path, node->label);
+
+    if (node->children != NULL) {
+        g_hash_table_iter_init(&iter, node->children);
+        while (g_hash_table_iter_next(&iter, NULL, &child)) {
+            self -= ((ProfileNode *) child)->total;
+            write_node(out, path, (ProfileNode *) child);
+        }
+    }
+
+    fprintf(out, "%s %" G_GINT64_FORMAT "\n", path->str, MAX(self, 0));
+
+    g_string_truncate(path, path_len);
+}
+
+static void
+write_report(void)
+{
+    const char *output = g_getenv("GJS_PROFILE_STARTUP");
+    GHashTableIter iter;
+    gpointer child;
+    GString *path;
+    FILE *out = stderr;
+
+    /* Close the frames still open, if exit() was called from JS */
+    while (stack->len > 0)
+        gjs_startup_profile_pop();
+
+    if (root.children == NULL)
+        return;
+
+    if (output != NULL && output[0] != '\0' && strcmp(output, "-") != 0) {
+        out = fopen(output, "w");
+        if (out == NULL) {
+            g_printerr("Failed to write startup profile to %s: %s\n", output,
+                       g_strerror(errno));
+            return;
+        }
+    }
+
+    path = g_string_new(NULL);
+    g_hash_table_iter_init(&iter, root.children);
+    while (g_hash_table_iter_next(&iter, NULL, &child))
+        write_node(out, path, (ProfileNode *) child);
+    g_string_free(path, true);
+
+    if (out != stderr)
+        fclose(out);
+}
@@ -0,0 +1,70 @@
+/* -*- mode: C; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+#ifndef __GJS_STARTUP_PROFILE_H__
+#define __GJS_STARTUP_PROFILE_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef enum {
+    GJS_PROFILE_IMPORT,
+    GJS_PROFILE_COMPILE,
+    GJS_PROFILE_EXECUTE,
+    GJS_PROFILE_GI_REQUIRE,
+    GJS_PROFILE_GI_DEFINE,
+    GJS_PROFILE_GI_CLASS,
+} GjsProfileKind;
+
+bool gjs_startup_profile_enabled (void);
+
+void gjs_startup_profile_push    (GjsProfileKind  kind,
+                                  const char     *ns,
+                                  const char     *name);
+void gjs_startup_profile_pop     (void);
+
+G_END_DECLS
+
+/* Times the enclosing block, if profiling is enabled. @ns may be NULL;
+ * both strings are copied. */
+class GjsProfileScope {
+    bool m_active;
+
+public:
+    GjsProfileScope(GjsProfileKind  kind,
+                    const char     *ns,
+                    const char     *name)
+        : m_active(gjs_startup_profile_enabled())
+    {
+        if (m_active)
+            gjs_startup_profile_push(kind, ns, name);
+    }
+
+    ~GjsProfileScope()
+    {
+        if (m_active)
+            gjs_startup_profile_pop();
+    }
+};
+
+#endif  /* __GJS_STARTUP_PROFILE_H__ */
@@ -105,6 +105,96 @@ function testFromArray() {
     JSUnit.assertEquals("a[3] == 4", 4, a[3]);
 }
 
+function testFromUint8Array() {
+    let a = ByteArray.fromArray(new Uint8Array([ 1, 2, 255 ]));
+    JSUnit.assertEquals("from Uint8Array [1,2,255] gives length 3", 3, a.length);
+    JSUnit.assertEquals("a[0] == 1", 1, a[0]);
+    JSUnit.assertEquals("a[2] == 255", 255, a[2]);
+
+    let u = ByteArray.toUint8Array(a);
+    JSUnit.assertTrue("toUint8Array() gives a Uint8Array", u instanceof Uint8Array);
+    JSUnit.assertEquals("round trip keeps length", 3, u.length);
+    JSUnit.assertEquals("round trip keeps a[2]", 255, u[2]);
+}
+
+function testGBytesBackedAccess() {
+    let bytes = ByteArray.fromArray([ 10, 20, 30 ]).toGBytes();
+    let a = ByteArray.fromGBytes(bytes);
+    JSUnit.assertEquals("a[1] == 20", 20, a[1]);
+    JSUnit.assertEquals("a['2'] == 30", 30, a['2']);
+
+    a[1] = 21;
+    JSUnit.assertEquals("a[1] == 21 after assignment", 21, a[1]);
+    JSUnit.assertEquals("the GBytes is left alone", 20,
+                        ByteArray.fromGBytes(bytes)[1]);
+}
+
+function testSlice() {
+    let a = ByteArray.fromArray([ 1, 2, 3, 4, 5 ]);
+    let b = a.slice(1, 3);
+    JSUnit.assertEquals("slice(1, 3) gives length 2", 2, b.length);
+    JSUnit.assertEquals("b[0] == 2", 2, b[0]);
+    JSUnit.assertEquals("b[1] == 3", 3, b[1]);
+    b[0] = 42;
+    JSUnit.assertEquals("slice() copies", 2, a[1]);
+
+    b = a.slice(-2);
+    JSUnit.assertEquals("slice(-2) gives length 2", 2, b.length);
+    JSUnit.assertEquals("slice(-2)[0] == 4", 4, b[0]);
+    JSUnit.assertEquals("slice() copies everything", 5, a.slice().length);
+    JSUnit.assertEquals("slice(4, 1) is empty", 0, a.slice(4, 1).length);
+}
+
+function testIndexOf() {
+    let a = ByteArray.fromString("a,bc,,d,");
+    let comma = ",".charCodeAt(0);
+    JSUnit.assertEquals(1, a.indexOf(comma));
+    JSUnit.assertEquals(4, a.indexOf(comma, 2));
+    JSUnit.assertEquals(7, a.lastIndexOf(comma));
+    JSUnit.assertEquals(5, a.lastIndexOf(comma, 6));
+    JSUnit.assertEquals(-1, a.indexOf(0));
+    JSUnit.assertEquals(-1, ByteArray.fromArray([ 1, 2, 3 ]).lastIndexOf(1, -5));
+    JSUnit.assertEquals(0, ByteArray.fromArray([ 1, 2, 3 ]).lastIndexOf(1, -3));
+
+    JSUnit.assertEquals(4, a.indexOf(ByteArray.fromString(",,")));
+    JSUnit.assertEquals(2, a.indexOf(new Uint8Array([ 98, 99 ])));
+    JSUnit.assertEquals(-1, a.indexOf(ByteArray.fromString(",,,")));
+    JSUnit.assertEquals(6, a.lastIndexOf(ByteArray.fromString("d,")));
+
+    JSUnit.assertRaises(function() { a.indexOf("x"); });
+}
+
+function testCopyWithinAndFill() {
+    let a = ByteArray.fromArray([ 1, 2, 3, 4, 5 ]);
+    JSUnit.assertEquals("copyWithin() returns the array", a, a.copyWithin(0, 3));
+    JSUnit.assertEquals(4, a[0]);
+    JSUnit.assertEquals(5, a[1]);
+    JSUnit.assertEquals(3, a[2]);
+
+    a.fill(7, 1, -1);
+    JSUnit.assertEquals(4, a[0]);
+    JSUnit.assertEquals(7, a[1]);
+    JSUnit.assertEquals(7, a[3]);
+    JSUnit.assertEquals(5, a[4]);
+
+    JSUnit.assertRaises(function() { a.fill(256); });
+}
+
+function testConcatAndCompare() {
+    let a = ByteArray.fromArray([ 1, 2 ]);
+    let b = a.concat(ByteArray.fromArray([ 3 ]), new Uint8Array([ 4, 5 ]));
+    JSUnit.assertEquals("concat() gives length 5", 5, b.length);
+    JSUnit.assertEquals(1, b[0]);
+    JSUnit.assertEquals(3, b[2]);
+    JSUnit.assertEquals(5, b[4]);
+    JSUnit.assertEquals("concat() leaves the original alone", 2, a.length);
+
+    JSUnit.assertEquals(0, a.compare(ByteArray.fromArray([ 1, 2 ])));
+    JSUnit.assertEquals(-1, a.compare(b));
+    JSUnit.assertEquals(1, b.compare(a));
+    JSUnit.assertEquals(1, a.compare(new Uint8Array([ 1, 1, 9 ])));
+}
+
 function testToString() {
     let a = new ByteArray.ByteArray();
     a[0] = 97;
@@ -117,5 +207,145 @@ function testToString() {
     JSUnit.assertEquals("toString() gives 'abcd'", "abcd", s);
 }
 
+function testGBytesToUint8Array() {
+    let bytes = ByteArray.fromArray([ 1, 2, 255 ]).toGBytes();
+    let a = bytes.toUint8Array();
+    JSUnit.assertTrue("toUint8Array() gives a Uint8Array", a instanceof Uint8Array);
+    JSUnit.assertEquals("length is 3", 3, a.length);
+    JSUnit.assertEquals("a[0] == 1", 1, a[0]);
+    JSUnit.assertEquals("a[2] == 255", 255, a[2]);
+
+    a = ByteArray.toUint8Array(new ByteArray.ByteArray().toGBytes());
+    JSUnit.assertEquals("empty GBytes gives length 0", 0, a.length);
+}
+
+function testToStringUTF8() {
+    let ascii = new Array(100).join("abcdefgh");
+    let a = ByteArray.fromString(ascii);
+    JSUnit.assertEquals(ascii.length, a.length);
+    JSUnit.assertEquals(ascii, a.toString());
+
+    a = ByteArray.fromString("h\u00e9llo");
+    JSUnit.assertEquals("fromString() encodes UTF-8", 6, a.length);
+    JSUnit.assertEquals(0xc3, a[1]);
+    JSUnit.assertEquals("h\u00e9llo", a.toString());
+
+    a = ByteArray.fromArray([ 97, 0xff, 98 ]);
+    JSUnit.assertRaises(function() { a.toString(); });
+}
+
+function testEncodings() {
+    let a = ByteArray.fromString("h\u00e9llo", "ISO-8859-1");
+    JSUnit.assertEquals("Latin-1 is one byte per char", 5, a.length);
+    JSUnit.assertEquals(0xe9, a[1]);
+    JSUnit.assertEquals("h\u00e9llo", a.toString("ISO-8859-1"));
+    JSUnit.assertEquals("no byte order mark", 5, a.toString("ISO-8859-1").length);
+
+    JSUnit.assertEquals("", new ByteArray.ByteArray().toString("ISO-8859-1"));
+
+    JSUnit.assertRaises(function() {
+        ByteArray.fromString("\u20ac", "ISO-8859-1");
+    });
+    JSUnit.assertRaises(function() { a.toString("NO-SUCH-ENCODING"); });
+}
+
+function testStreamingDecoder() {
+    // "h\u00e9\u20ac" is 68 c3 a9 e2 82 ac in UTF-8
+    let bytes = [ 0x68, 0xc3, 0xa9, 0xe2, 0x82, 0xac ];
+    let decoder = new ByteArray.Decoder();
+    let s = '';
+    for (let i = 0; i < bytes.length; i += 2)
+        s += decoder.decode(ByteArray.fromArray(bytes.slice(i, i + 2)),
+                            { stream: true });
+    s += decoder.decode();
+    JSUnit.assertEquals("h\u00e9\u20ac", s);
+
+    // A cut sequence carries over byte by byte, also from Uint8Arrays
+    s = '';
+    for (let b of bytes)
+        s += decoder.decode(new Uint8Array([ b ]), { stream: true });
+    JSUnit.assertEquals("h\u00e9\u20ac", s + decoder.decode());
+
+    decoder.decode(ByteArray.fromArray([ 0xe2, 0x82 ]), { stream: true });
+    JSUnit.assertRaises(function() { decoder.decode(); });
+    JSUnit.assertEquals("the decoder starts over after an error", "a",
+                        decoder.decode(ByteArray.fromArray([ 0x61 ])));
+
+    decoder = new ByteArray.Decoder("UTF-16LE");
+    s = decoder.decode(ByteArray.fromArray([ 0x68, 0x00, 0xe9 ]), { stream: true });
+    s += decoder.decode(ByteArray.fromArray([ 0x00 ]));
+    JSUnit.assertEquals("h\u00e9", s);
+}
+
+function testEmbeddedNul() {
+    // toString() stops at the first nul byte, whether or not the bytes
+    // are ASCII
+    JSUnit.assertEquals("a", ByteArray.fromArray([ 0x61, 0, 0x62 ]).toString());
+    JSUnit.assertEquals("\u00e9",
+                        ByteArray.fromArray([ 0xc3, 0xa9, 0, 0x62 ]).toString());
+
+    // The decoder keeps them, in both cases
+    let decoder = new ByteArray.Decoder();
+    JSUnit.assertEquals("a\0b",
+                        decoder.decode(ByteArray.fromArray([ 0x61, 0, 0x62 ])));
+    JSUnit.assertEquals("\u00e9\0b",
+                        decoder.decode(ByteArray.fromArray([ 0xc3, 0xa9, 0, 0x62 ])));
+}
+
+function testEncoderEncodeInto() {
+    let encoder = new ByteArray.Encoder();
+    let a = new ByteArray.ByteArray(4);
+    let result = encoder.encodeInto("h\u00e9\u20ac", a);
+    JSUnit.assertEquals("stops before a char that doesn't fit", 2, result.read);
+    JSUnit.assertEquals(3, result.written);
+    JSUnit.assertEquals(4, a.length);
+    JSUnit.assertEquals(0x68, a[0]);
+    JSUnit.assertEquals(0xc3, a[1]);
+    JSUnit.assertEquals(0xa9, a[2]);
+
+    let u = new Uint8Array(4);
+    result = encoder.encodeInto("\u20ac", u, 1);
+    JSUnit.assertEquals(1, result.read);
+    JSUnit.assertEquals(3, result.written);
+    JSUnit.assertEquals(0, u[0]);
+    JSUnit.assertEquals(0xe2, u[1]);
+
+    encoder = new ByteArray.Encoder("ISO-8859-1");
+    a = new ByteArray.ByteArray(2);
+    result = encoder.encodeInto("h\u00e9llo", a);
+    JSUnit.assertEquals(2, result.read);
+    JSUnit.assertEquals(2, result.written);
+    JSUnit.assertEquals(0xe9, a[1]);
+
+    JSUnit.assertRaises(function() { new ByteArray.Encoder("NO-SUCH-ENCODING"); });
+}
+
+function testEncoderEncodeIntoStateful() {
+    let hexBytes = bytes =>
+        Array.prototype.map.call(bytes, b => b.toString(16)).join(',');
+    let encoder = new ByteArray.Encoder("ISO-2022-JP");
+    let u = new Uint8Array(16);
+    let result = encoder.encodeInto("\u65e5\u672c", u);
+    JSUnit.assertEquals(2, result.read);
+    JSUnit.assertEquals(10, result.written);
+    JSUnit.assertEquals("switches to JIS X 0208",
+                        "1b,24,42", hexBytes(u.subarray(0, 3)));
+    JSUnit.assertEquals("switches back to ASCII at the end",
+                        "1b,28,42", hexBytes(u.subarray(7, 10)));
+
+    let u2 = new Uint8Array(16);
+    result = encoder.encodeInto("\u65e5\u672c", u2);
+    JSUnit.assertEquals("each call is self-contained",
+                        hexBytes(u), hexBytes(u2));
+
+    // Room for both characters, but not for the escape sequence after them
+    let small = new Uint8Array(8);
+    result = encoder.encodeInto("\u65e5\u672c", small);
+    JSUnit.assertEquals(1, result.read);
+    JSUnit.assertEquals(8, result.written);
+    JSUnit.assertEquals("1b,24,42", hexBytes(small.subarray(0, 3)));
+    JSUnit.assertEquals("1b,28,42", hexBytes(small.subarray(5, 8)));
+}
+
 JSUnit.gjstestRun(this, JSUnit.setUp, JSUnit.tearDown);
 
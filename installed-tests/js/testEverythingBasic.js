@@ -115,6 +115,20 @@ function testNoImplicitConversionToUnsigned() {
     JSUnit.assertRaises(function() { return Everything.test_size(-42); });
 }
 
+function testNumericArgumentConversions() {
+    JSUnit.assertEquals(42, Everything.test_int8('42'));
+    JSUnit.assertEquals(42, Everything.test_int32(42.5));
+    JSUnit.assertEquals(0, Everything.test_uint16(null));
+    JSUnit.assertEquals(1.5, Everything.test_double('1.5'));
+    JSUnit.assertEquals(true, Everything.test_boolean('yes'));
+    JSUnit.assertEquals(false, Everything.test_boolean(0));
+
+    JSUnit.assertRaises(function() { return Everything.test_int8(INT8_MAX + 1); });
+    JSUnit.assertRaises(function() { return Everything.test_uint16(UINT16_MAX + 1); });
+    JSUnit.assertRaises(function() { return Everything.test_uint32(UINT32_MAX + 1); });
+    JSUnit.assertRaises(function() { return Everything.test_float(Number.MAX_VALUE); });
+}
+
 
 function testBadConstructor() {
     try {
@@ -322,6 +336,18 @@ function testArrayIn() {
     JSUnit.assertEquals(10, Everything.test_array_gint16_in("\x01\x02\x03\x04"));
     JSUnit.assertEquals(2560, Everything.test_array_gint16_in("\u0100\u0200\u0300\u0400"));
 
+    // typed arrays of the same element size are copied in one go
+    JSUnit.assertEquals(10, Everything.test_array_gint8_in(new Int8Array([1,2,3,4])));
+    JSUnit.assertEquals(10, Everything.test_array_gint8_in(new Uint8Array([1,2,3,4])));
+    JSUnit.assertEquals(-2, Everything.test_array_gint8_in(new Uint8Array([255,255])));
+    JSUnit.assertEquals(10, Everything.test_array_gint16_in(new Int16Array([1,2,3,4])));
+    JSUnit.assertEquals(10, Everything.test_array_gint32_in(new Int32Array([1,2,3,4])));
+    JSUnit.assertEquals(0, Everything.test_array_gint32_in(new Int32Array(0)));
+    JSUnit.assertEquals(10, Everything.test_array_gint8_in(imports.byteArray.fromArray([1,2,3,4])));
+    // others are converted element by element
+    JSUnit.assertEquals(10, Everything.test_array_gint32_in(new Float64Array([1,2,3,4])));
+    JSUnit.assertEquals(10, Everything.test_array_gint32_in(new Uint8Array([1,2,3,4])));
+
     // GType arrays
     JSUnit.assertEquals('[GSimpleAction,GIcon,GBoxed,]',
                  Everything.test_array_gtype_in([Gio.SimpleAction, Gio.Icon, GObject.TYPE_BOXED]));
@@ -366,6 +392,37 @@ function testArrayOut() {
     Everything.test_array_int_null_in(null);
 }
 
+function testArrayOutTypedArrays() {
+    function arrayEqual(ref, res) {
+        JSUnit.assertEquals(ref.length, res.length);
+        for (let i = 0; i < ref.length; i++)
+            JSUnit.assertEquals(ref[i], res[i]);
+    }
+
+    JSUnit.assertFalse(Everything.test_array_int_full_out.typedArrays);
+    Everything.test_array_int_full_out.typedArrays = true;
+    Everything.test_array_int_none_out.typedArrays = true;
+    Everything.test_array_int_null_out.typedArrays = true;
+    try {
+        let array = Everything.test_array_int_full_out();
+        JSUnit.assertTrue(array instanceof Int32Array);
+        arrayEqual([0, 1, 2, 3, 4], array);
+
+        array = Everything.test_array_int_none_out();
+        JSUnit.assertTrue(array instanceof Int32Array);
+        arrayEqual([1, 2, 3, 4, 5], array);
+
+        array = Everything.test_array_int_null_out();
+        JSUnit.assertEquals(0, array.length);
+    } finally {
+        Everything.test_array_int_full_out.typedArrays = false;
+        Everything.test_array_int_none_out.typedArrays = false;
+        Everything.test_array_int_null_out.typedArrays = false;
+    }
+
+    JSUnit.assertTrue(Everything.test_array_int_out() instanceof Array);
+}
+
 function testArrayOfStructsOut() {
    let array = Everything.test_array_struct_out();
    let ints = array.map(struct => struct.some_int);
@@ -436,6 +493,78 @@ function testEnumParam() {
     JSUnit.assertEquals('value4', Everything.TestEnum.param(Everything.TestEnum.VALUE4));
 }
 
+function testRepeatedPropertyAccess() {
+    let o = new Everything.TestObj({ int: 42 });
+    for (let i = 0; i < 3; i++) {
+        JSUnit.assertEquals(42 + i, o.int);
+        o.int++;
+    }
+    JSUnit.assertEquals(45, o.int);
+
+    for (let i = 0; i < 3; i++) {
+        o.notAGObjectProperty = i;
+        JSUnit.assertEquals(i, o.notAGObjectProperty);
+    }
+
+    o.string = 'hello';
+    JSUnit.assertEquals('hello', o.string);
+}
+
+function testPropertyAccessorNames() {
+    let o = new Everything.TestObj({ string: 'hello' });
+    JSUnit.assertEquals('hello', o['string']);
+
+    JSUnit.assertEquals(o.hash_table, o.hashTable);
+    JSUnit.assertEquals(o.hash_table, o['hash-table']);
+
+    // Accessors live on the prototype, so setting a property doesn't
+    // shadow it with a plain JS property on the instance
+    o.string = 'world';
+    JSUnit.assertFalse(o.hasOwnProperty('string'));
+    JSUnit.assertEquals('world', o.string);
+}
+
+function testBulkPropertySet() {
+    let o = new Everything.TestObj();
+    let notified = [];
+    o.connect('notify', function(obj, pspec) {
+        // Both values must already be set when the first notify arrives
+        JSUnit.assertEquals(7, obj.int);
+        JSUnit.assertEquals('bulk', obj.string);
+        notified.push(pspec.name);
+    });
+
+    o.set({ int: 7, string: 'bulk' });
+    JSUnit.assertEquals(2, notified.length);
+    JSUnit.assertTrue(notified.indexOf('int') >= 0);
+    JSUnit.assertTrue(notified.indexOf('string') >= 0);
+
+    // Nothing is set if one of the values can't be converted
+    JSUnit.assertRaises(function() { o.set({ int: 8, noSuchProperty: 1 }); });
+    JSUnit.assertEquals(7, o.int);
+}
+
+function testPropertyAssignedOnPrototype() {
+    // Assigning to a property on a prototype defines a plain property
+    // there, as it would without the accessors
+    const MyTestObj = new GObject.Class({
+        Name: 'MyTestObjWithMethod',
+        Extends: Everything.TestObj,
+    });
+    MyTestObj.prototype.string = function() { return 'method'; };
+    JSUnit.assertTrue(MyTestObj.prototype.hasOwnProperty('string'));
+    JSUnit.assertEquals('method', new MyTestObj().string());
+
+    let proto = Object.create(Everything.TestObj.prototype);
+    proto.string = 42;
+    JSUnit.assertTrue(proto.hasOwnProperty('string'));
+    JSUnit.assertEquals(42, Object.create(proto).string);
+
+    // The accessor on the parent prototype is still in place
+    let o = new Everything.TestObj({ string: 'hello' });
+    JSUnit.assertEquals('hello', o.string);
+}
+
 function testSignal() {
     let handlerCounter = 0;
     let o = new Everything.TestObj();
@@ -454,6 +583,21 @@ function testSignal() {
     JSUnit.assertEquals('disconnected handler not called', 1, handlerCounter);
 }
 
+function testSignalById() {
+    let o = new Everything.TestObj();
+    let signalId = GObject.signal_lookup('test', Everything.TestObj);
+    let handlerCounter = 0;
+
+    let handlerId = o.connect(signalId, function() { handlerCounter++; });
+    o.emit('test');
+    o.emit(signalId);
+    JSUnit.assertEquals(2, handlerCounter);
+    o.disconnect(handlerId);
+
+    JSUnit.assertRaises(function() { o.connect(0, function() {}); });
+    JSUnit.assertRaises(function() { o.emit(-1); });
+}
+
 function testInvalidSignal() {
     let o = new Everything.TestObj();
 
@@ -326,6 +326,24 @@ function testGValue() {
     assertArrayEquals([42, "42", true], thing);
 }
 
+function testEnumsAndFlags() {
+    assertEquals(GIMarshallingTests.Enum.VALUE3, GIMarshallingTests.enum_returnv());
+    assertEquals(GIMarshallingTests.GEnum.VALUE3, GIMarshallingTests.genum_returnv());
+    assertEquals(GIMarshallingTests.Flags.VALUE2, GIMarshallingTests.flags_returnv());
+    assertEquals(GIMarshallingTests.NoTypeFlags.VALUE2,
+                 GIMarshallingTests.no_type_flags_returnv());
+
+    GIMarshallingTests.enum_in(GIMarshallingTests.Enum.VALUE3);
+    GIMarshallingTests.genum_in(GIMarshallingTests.GEnum.VALUE3);
+    GIMarshallingTests.flags_in(GIMarshallingTests.Flags.VALUE2);
+    GIMarshallingTests.flags_in_zero(0);
+    GIMarshallingTests.no_type_flags_in(GIMarshallingTests.NoTypeFlags.VALUE2);
+
+    // Values that are not part of the type are still rejected
+    assertRaises(function() { GIMarshallingTests.enum_in(43); });
+    assertRaises(function() { GIMarshallingTests.flags_in(1 << 20); });
+}
+
 function testGType() {
     assertEquals("void", GObject.TYPE_NONE.name);
     assertEquals("gchararray", GObject.TYPE_STRING.name);
@@ -5,6 +5,7 @@ const Lang = imports.lang;
 const GObject = imports.gi.GObject;
 const Gio = imports.gi.Gio;
 const Gtk = imports.gi.Gtk;
+const System = imports.system;
 
 const MyObject = new GObject.Class({
     Name: 'MyObject',
@@ -364,4 +365,49 @@ function testDefaultHandler() {
     JSUnit.assertEquals(79, result);
 }
 
+const MySignalObject = new GObject.Class({
+    Name: 'MySignalObject',
+    Signals: {
+        'typed': { param_types: [ GObject.TYPE_INT, GObject.TYPE_UINT,
+                                  GObject.TYPE_DOUBLE, GObject.TYPE_BOOLEAN,
+                                  GObject.TYPE_STRING ] },
+    },
+});
+
+function cachedSignalCount() {
+    let entry = System.typeReport().filter(e => e.name === 'ObjectSignal')[0];
+    return entry ? entry.live : 0;
+}
+
+function testSignalCache() {
+    let myInstance = new MySignalObject();
+    let before = cachedSignalCount();
+    let args = null;
+
+    myInstance.connect('typed', function(emitter, i, u, d, b, s) {
+        args = [i, u, d, b, s];
+    });
+    JSUnit.assertEquals(before + 1, cachedSignalCount());
+
+    // A second connect, with a name built at runtime, and emitting are
+    // served from the cache
+    let name = 'ty' + 'ped';
+    myInstance.connect(name, function() {});
+    myInstance.emit('typed', -1, 2, 0.5, 1, 'foo');
+    JSUnit.assertEquals(before + 1, cachedSignalCount());
+
+    JSUnit.assertEquals(-1, args[0]);
+    JSUnit.assertEquals(2, args[1]);
+    JSUnit.assertEquals(0.5, args[2]);
+    JSUnit.assertEquals(true, args[3]);
+    JSUnit.assertEquals('foo', args[4]);
+
+    myInstance.emit('typed', 0, 0, 0, false, null);
+    JSUnit.assertEquals(null, args[4]);
+
+    JSUnit.assertRaises(function() {
+        myInstance.emit('typed', 0, 0, 0, false, 42);
+    });
+}
+
 JSUnit.gjstestRun(this, JSUnit.setUp, JSUnit.tearDown);
@@ -99,6 +99,95 @@ function testImporterUTF8() {
     JSUnit.assertEquals(ModUnicode.uval, "const \u2665 utf8");
 }
 
+function testImporterEnumerateResources() {
+    let names = [];
+    for (let name in imports)
+        names.push(name);
+
+    JSUnit.assertTrue(names.indexOf('foobar') >= 0);
+    JSUnit.assertTrue(names.indexOf('subA') >= 0);
+    JSUnit.assertTrue(names.indexOf('mutualImport') >= 0);
+}
+
+function testImporterClearCache() {
+    const GLib = imports.gi.GLib;
+
+    let dir = GLib.dir_make_tmp('gjs-importer-XXXXXX');
+    let path = GLib.build_filenamev([dir, 'lateModule.js']);
+
+    imports.searchPath = [dir];
+    JSUnit.assertRaises(() => imports.lateModule);
+
+    // Without a main loop running, the directory monitor can't tell the
+    // importer about the new file
+    GLib.file_set_contents(path, 'var value = 42;');
+    imports.__clearCache__();
+    JSUnit.assertEquals(42, imports.lateModule.value);
+
+    GLib.unlink(path);
+    GLib.rmdir(dir);
+}
+
+function testImporterClearCacheIsShared() {
+    const GLib = imports.gi.GLib;
+
+    let dir = GLib.dir_make_tmp('gjs-importer-XXXXXX');
+    let subdir = GLib.build_filenamev([dir, 'latePackage']);
+    let path = GLib.build_filenamev([subdir, 'lateModule.js']);
+    GLib.mkdir_with_parents(subdir, 0o755);
+
+    imports.searchPath = [dir];
+    let subImporter = imports.latePackage;
+    JSUnit.assertRaises(() => subImporter.lateModule);
+
+    // The directory listings are shared by all importers, so clearing the
+    // cache of the root importer clears it for the sub-importer as well
+    GLib.file_set_contents(path, 'var value = 42;');
+    imports.__clearCache__();
+    JSUnit.assertEquals(42, subImporter.lateModule.value);
+
+    GLib.unlink(path);
+    GLib.rmdir(subdir);
+    GLib.rmdir(dir);
+}
+
+function testImporterMethodNamesDontShadowModules() {
+    const GLib = imports.gi.GLib;
+
+    let dir = GLib.dir_make_tmp('gjs-importer-XXXXXX');
+    let paths = ['clearCache.js', 'prefetch.js'].map(name =>
+        GLib.build_filenamev([dir, name]));
+    paths.forEach(path => GLib.file_set_contents(path, 'var value = 42;'));
+
+    imports.searchPath = [dir];
+    JSUnit.assertEquals(42, imports.clearCache.value);
+    JSUnit.assertEquals(42, imports.prefetch.value);
+
+    paths.forEach(path => GLib.unlink(path));
+    GLib.rmdir(dir);
+}
+
+function testImporterPrefetch() {
+    const GLib = imports.gi.GLib;
+
+    // Big enough to be compiled off the main thread
+    let dir = GLib.dir_make_tmp('gjs-importer-XXXXXX');
+    let path = GLib.build_filenamev([dir, 'bigModule.js']);
+    let lines = [];
+    for (let i = 0; i < 1000; i++)
+        lines.push('function f' + i + '() { return ' + i + '; }');
+    lines.push('var value = f999();');
+    GLib.file_set_contents(path, lines.join('\n'));
+
+    imports.searchPath = [dir, 'resource:///org/gjs/jsunit/modules'];
+    imports.__prefetch__('bigModule', 'foobar', 'subA', 'nonexistentModuleName');
+    JSUnit.assertEquals(999, imports.bigModule.value);
+    JSUnit.assertEquals("This is foo", imports.foobar.foo);
+
+    GLib.unlink(path);
+    GLib.rmdir(dir);
+}
+
 let oldSearchPath;
 
 function setUp() {
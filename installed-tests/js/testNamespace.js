@@ -5,4 +5,23 @@ function testName() {
     JSUnit.assertEquals(Everything.__name__, "Regress");
 }
 
+function testMissingNames() {
+    // The second lookup is answered from the cache of missing names
+    for (let i = 0; i < 2; i++) {
+        JSUnit.assertFalse('NotInRegress' in Everything);
+        JSUnit.assertUndefined(Everything.NotInRegress);
+    }
+    JSUnit.assertTrue('TestObj' in Everything);
+}
+
+function testMaterialize() {
+    const GIMarshallingTests = imports.gi.GIMarshallingTests;
+    GIMarshallingTests.__materialize__();
+
+    let names = Object.getOwnPropertyNames(GIMarshallingTests);
+    JSUnit.assertTrue(names.indexOf('Object') >= 0);
+    JSUnit.assertTrue(names.indexOf('int_return_max') >= 0);
+    JSUnit.assertEquals(GIMarshallingTests.int_return_max(), 0x7fffffff);
+}
+
 JSUnit.gjstestRun(this, JSUnit.setUp, JSUnit.tearDown);
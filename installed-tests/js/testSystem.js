@@ -14,5 +14,54 @@ function testVersion() {
     JSUnit.assert(System.version >= 13600);
 }
 
+function testToggleQueueDepth() {
+    // Nothing is toggled from other threads in this test
+    JSUnit.assertEquals(0, System.toggleQueueDepth());
+}
+
+function testGcHistory() {
+    System.gc();
+    let history = System.gcHistory();
+    JSUnit.assertTrue(history.length > 0);
+
+    let last = history[history.length - 1];
+    JSUnit.assertEquals('API', last.reason);
+    JSUnit.assertTrue(last.full);
+    JSUnit.assertTrue(last.slices >= 1);
+    JSUnit.assertTrue(last.endTime >= last.startTime);
+    JSUnit.assertEquals('object', typeof last.finalized);
+    JSUnit.assertEquals('object', typeof last.finalizedTypes);
+}
+
+function testGcHistoryFinalizedTypes() {
+    const ByteArray = imports.byteArray;
+    (function() {
+        for (let i = 0; i < 100; i++)
+            new ByteArray.ByteArray(10);
+    })();
+    System.gc();
+
+    let history = System.gcHistory();
+    let last = history[history.length - 1];
+    JSUnit.assertTrue(last.finalizedTypes['ByteArray'] > 0);
+}
+
+function testTypeReport() {
+    const ByteArray = imports.byteArray;
+    let arrays = [];
+    for (let i = 0; i < 10; i++)
+        arrays.push(new ByteArray.ByteArray(1000));
+
+    let report = System.typeReport();
+    let entry = report.filter(e => e.name === 'ByteArray')[0];
+    JSUnit.assertNotUndefined(entry);
+    JSUnit.assertEquals('byteArray', entry.kind);
+    JSUnit.assertTrue(entry.live >= arrays.length);
+    JSUnit.assertTrue(entry.bytes >= 1000 * arrays.length);
+
+    for (let i = 1; i < report.length; i++)
+        JSUnit.assertTrue(report[i - 1].bytes >= report[i].bytes);
+}
+
 JSUnit.gjstestRun(this, JSUnit.setUp, JSUnit.tearDown);
 
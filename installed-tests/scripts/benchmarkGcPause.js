@@ -0,0 +1,44 @@
+// -*- mode: js; indent-tabs-mode: nil -*-
+//
+// Times full garbage collections with a growing number of toggled-up
+// wrappers, that is, wrappers of GObjects that C code holds a reference
+// to. Those wrappers are kept alive by the keep-alive object, which
+// traces all of them on every collection.
+// Run with: gjs benchmarkGcPause.js [max-wrappers]
+
+const Gio = imports.gi.Gio;
+const GLib = imports.gi.GLib;
+const GObject = imports.gi.GObject;
+const System = imports.system;
+
+const MAX_WRAPPERS = ARGV.length > 0 ? parseInt(ARGV[0], 10) : 100000;
+const COLLECTIONS = 10;
+
+function timeCollections() {
+    let pauses = [];
+    for (let i = 0; i < COLLECTIONS; i++) {
+        let start = GLib.get_monotonic_time();
+        System.gc();
+        pauses.push(GLib.get_monotonic_time() - start);
+    }
+    pauses.sort((a, b) => a - b);
+    return pauses[Math.floor(COLLECTIONS / 2)];
+}
+
+print('baseline: ' + (timeCollections() / 1000).toFixed(2) + ' ms per GC');
+
+for (let n = 1000; n <= MAX_WRAPPERS; n *= 10) {
+    // The store holds a reference to each object, which toggles its
+    // wrapper up once the last JS reference to it is gone
+    let store = new Gio.ListStore({ item_type: GObject.Object });
+    for (let i = 0; i < n; i++)
+        store.append(new GObject.Object());
+    System.gc();
+
+    print(n + ' toggled-up wrappers: ' +
+          (timeCollections() / 1000).toFixed(2) + ' ms per GC');
+
+    store.remove_all();
+    store = null;
+    System.gc();
+}
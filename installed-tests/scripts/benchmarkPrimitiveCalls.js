@@ -0,0 +1,70 @@
+// -*- mode: js; indent-tabs-mode: nil -*-
+//
+// Times calls to C functions that only take and return numbers, booleans
+// and enums, which go through the primitive invokers in gi/function.cpp.
+// Needs the Regress and GIMarshallingTests typelibs from the build
+// directory:
+//   GI_TYPELIB_PATH=. LD_LIBRARY_PATH=.libs \
+//       gjs installed-tests/scripts/benchmarkPrimitiveCalls.js [iterations]
+
+const GIMarshallingTests = imports.gi.GIMarshallingTests;
+const GLib = imports.gi.GLib;
+const Regress = imports.gi.Regress;
+
+const ITERATIONS = ARGV.length > 0 ? parseInt(ARGV[0], 10) : 1000000;
+
+function time(name, func) {
+    // Warm up, so that all loops are compiled before they are timed
+    func(ITERATIONS / 10);
+
+    let start = GLib.get_monotonic_time();
+    func(ITERATIONS);
+    let elapsed = GLib.get_monotonic_time() - start;
+
+    print(name + ': ' + ITERATIONS + ' calls in ' +
+          (elapsed / 1000).toFixed(1) + ' ms, ' +
+          (elapsed * 1000 / ITERATIONS).toFixed(1) + ' ns per call');
+}
+
+time('Regress.test_int32()', function(n) {
+    let sum = 0;
+    for (let i = 0; i < n; i++)
+        sum += Regress.test_int32(i & 0xffff);
+    return sum;
+});
+
+time('Regress.test_double()', function(n) {
+    let sum = 0;
+    for (let i = 0; i < n; i++)
+        sum += Regress.test_double(i / 2);
+    return sum;
+});
+
+time('Regress.test_boolean()', function(n) {
+    let count = 0;
+    for (let i = 0; i < n; i++) {
+        if (Regress.test_boolean(i & 1))
+            count++;
+    }
+    return count;
+});
+
+time('GIMarshallingTests.enum_returnv()', function(n) {
+    let sum = 0;
+    for (let i = 0; i < n; i++)
+        sum += GIMarshallingTests.enum_returnv();
+    return sum;
+});
+
+// Plain JS function with the same shape, as a baseline for the call
+// overhead of the loop itself
+function identity(x) {
+    return x;
+}
+
+time('JS function', function(n) {
+    let sum = 0;
+    for (let i = 0; i < n; i++)
+        sum += identity(i & 0xffff);
+    return sum;
+});
@@ -0,0 +1,44 @@
+// -*- mode: js; indent-tabs-mode: nil -*-
+//
+// Times reads of a GObject property, which go through the accessors on
+// the prototype, against reads of a plain JS property set on the same
+// wrapper. Run with: gjs benchmarkPropertyAccess.js [iterations]
+
+const Gio = imports.gi.Gio;
+const GLib = imports.gi.GLib;
+
+const ITERATIONS = ARGV.length > 0 ? parseInt(ARGV[0], 10) : 1000000;
+
+function time(name, func) {
+    // Warm up, so that both loops are compiled before they are timed
+    func(ITERATIONS / 10);
+
+    let start = GLib.get_monotonic_time();
+    func(ITERATIONS);
+    let elapsed = GLib.get_monotonic_time() - start;
+
+    print(name + ': ' + ITERATIONS + ' reads in ' +
+          (elapsed / 1000).toFixed(1) + ' ms, ' +
+          (elapsed * 1000 / ITERATIONS).toFixed(1) + ' ns per read');
+}
+
+let action = new Gio.SimpleAction({ name: 'benchmark' });
+action._expando = true;
+
+time('GObject property', function(n) {
+    let count = 0;
+    for (let i = 0; i < n; i++) {
+        if (action.enabled)
+            count++;
+    }
+    return count;
+});
+
+time('JS expando property', function(n) {
+    let count = 0;
+    for (let i = 0; i < n; i++) {
+        if (action._expando)
+            count++;
+    }
+    return count;
+});
@@ -282,6 +282,9 @@ function _init() {
     this.Bytes.prototype.toArray = function() {
 	return imports.byteArray.fromGBytes(this);
     };
+    this.Bytes.prototype.toUint8Array = function() {
+	return imports.byteArray.toUint8Array(this);
+    };
 
     this.log_structured = function(logDomain, logLevel, stringFields) {
         let fields = {};
@@ -28,11 +28,14 @@
 #include <unistd.h>
 #include <time.h>
 
+#include <vector>
+
 #include <gjs/context.h>
 
 #include "gi/object.h"
 #include "gjs/context-private.h"
 #include "gjs/jsapi-util-args.h"
+#include "gjs/mem.h"
 #include "system.h"
 
 static bool
@@ -125,11 +128,198 @@ gjs_gc(JSContext *context,
     JS::CallArgs argv = JS::CallArgsFromVp (argc, vp);
     if (!gjs_parse_call_args(context, "gc", argv, ""))
         return false;
+    gjs_runtime_set_next_gc_reason(JS_GetRuntime(context), "API");
     JS_GC(JS_GetRuntime(context));
     argv.rval().setUndefined();
     return true;
 }
 
+static bool
+define_report_property(JSContext       *context,
+                       JS::HandleObject obj,
+                       const char      *name,
+                       JS::HandleValue  value)
+{
+    return JS_DefineProperty(context, obj, name, value, JSPROP_ENUMERATE,
+                             JS_PropertyStub, JS_StrictPropertyStub);
+}
+
+static JSObject *
+gc_info_to_object(JSContext       *context,
+                  const GjsGcInfo *info)
+{
+    JS::RootedObject obj(context,
+        JS_NewObject(context, NULL, JS::NullPtr(), JS::NullPtr()));
+    JS::RootedObject finalized(context,
+        JS_NewObject(context, NULL, JS::NullPtr(), JS::NullPtr()));
+    JS::RootedObject finalized_types(context,
+        JS_NewObject(context, NULL, JS::NullPtr(), JS::NullPtr()));
+    JS::RootedValue value(context);
+    unsigned i;
+
+    if (!obj || !finalized || !finalized_types)
+        return NULL;
+
+    for (i = 0; i < GJS_N_COUNTERS; i++) {
+        if (info->finalized[i] == 0)
+            continue;
+        value.setInt32(info->finalized[i]);
+        if (!define_report_property(context, finalized,
+                                    gjs_memory_get_counter_name(i), value))
+            return NULL;
+    }
+
+    for (i = 0; i < info->n_finalized_types; i++) {
+        value.setInt32(info->finalized_types[i].count);
+        if (!define_report_property(context, finalized_types,
+                                    info->finalized_types[i].name, value))
+            return NULL;
+    }
+
+    value.setNumber((double) info->start_time);
+    if (!define_report_property(context, obj, "startTime", value))
+        return NULL;
+    value.setNumber((double) info->end_time);
+    if (!define_report_property(context, obj, "endTime", value))
+        return NULL;
+    if (!gjs_string_from_utf8(context, info->reason, -1, &value) ||
+        !define_report_property(context, obj, "reason", value))
+        return NULL;
+    value.setBoolean(info->n_slices > 1);
+    if (!define_report_property(context, obj, "incremental", value))
+        return NULL;
+    value.setBoolean(info->full);
+    if (!define_report_property(context, obj, "full", value))
+        return NULL;
+    value.setNumber(info->n_slices);
+    if (!define_report_property(context, obj, "slices", value))
+        return NULL;
+    value.setNumber((double) info->max_slice_duration);
+    if (!define_report_property(context, obj, "maxSliceDuration", value))
+        return NULL;
+    value.setNumber((double) info->heap_bytes_before);
+    if (!define_report_property(context, obj, "heapBytesBefore", value))
+        return NULL;
+    value.setNumber((double) info->heap_bytes_after);
+    if (!define_report_property(context, obj, "heapBytesAfter", value))
+        return NULL;
+    value.setObject(*finalized);
+    if (!define_report_property(context, obj, "finalized", value))
+        return NULL;
+    value.setObject(*finalized_types);
+    if (!define_report_property(context, obj, "finalizedTypes", value))
+        return NULL;
+
+    return obj;
+}
+
+/* Returns the last collections of this runtime, oldest first */
+static bool
+gjs_gc_history(JSContext *context,
+               unsigned   argc,
+               JS::Value *vp)
+{
+    JS::CallArgs argv = JS::CallArgsFromVp(argc, vp);
+    JSRuntime *runtime = JS_GetRuntime(context);
+    guint64 count, serial;
+    uint32_t length = 0;
+    GjsGcInfo info;
+
+    if (!gjs_parse_call_args(context, "gcHistory", argv, ""))
+        return false;
+
+    JS::RootedObject history(context, JS_NewArrayObject(context, 0));
+    if (!history)
+        return false;
+
+    /* Copy the records first; the objects we allocate may cause more GCs */
+    count = gjs_memory_get_gc_count();
+    serial = count > GJS_GC_HISTORY_SIZE ? count - GJS_GC_HISTORY_SIZE : 0;
+    std::vector<GjsGcInfo> records;
+    for (; serial < count; serial++) {
+        if (gjs_memory_get_gc_info(serial, &info) && info.runtime == runtime)
+            records.push_back(info);
+    }
+
+    JS::RootedValue elem(context);
+    for (const GjsGcInfo& record : records) {
+        JSObject *obj = gc_info_to_object(context, &record);
+        if (obj == NULL)
+            return false;
+        elem.setObject(*obj);
+        if (!JS_SetElement(context, history, length++, elem))
+            return false;
+    }
+
+    argv.rval().setObject(*history);
+    return true;
+}
+
+/* Returns the live wrappers by type, holding the most memory first */
+static bool
+gjs_type_report(JSContext *context,
+                unsigned   argc,
+                JS::Value *vp)
+{
+    JS::CallArgs argv = JS::CallArgsFromVp(argc, vp);
+    GjsTypeCounter *report;
+    unsigned n_types, i;
+    bool retval = false;
+
+    if (!gjs_parse_call_args(context, "typeReport", argv, ""))
+        return false;
+
+    JS::RootedObject array(context, JS_NewArrayObject(context, 0));
+    if (!array)
+        return false;
+
+    report = gjs_memory_get_type_report(&n_types);
+
+    JS::RootedObject entry(context);
+    JS::RootedValue value(context);
+    for (i = 0; i < n_types; i++) {
+        entry = JS_NewObject(context, NULL, JS::NullPtr(), JS::NullPtr());
+        if (!entry)
+            goto out;
+
+        if (!gjs_string_from_utf8(context, report[i].kind, -1, &value) ||
+            !define_report_property(context, entry, "kind", value))
+            goto out;
+        if (!gjs_string_from_utf8(context, report[i].name, -1, &value) ||
+            !define_report_property(context, entry, "name", value))
+            goto out;
+        value.setInt32(report[i].live);
+        if (!define_report_property(context, entry, "live", value))
+            goto out;
+        value.setNumber((double) report[i].bytes);
+        if (!define_report_property(context, entry, "bytes", value))
+            goto out;
+
+        value.setObject(*entry);
+        if (!JS_SetElement(context, array, i, value))
+            goto out;
+    }
+
+    argv.rval().setObject(*array);
+    retval = true;
+
+ out:
+    g_free(report);
+    return retval;
+}
+
+static bool
+gjs_toggle_queue_depth(JSContext *context,
+                       unsigned   argc,
+                       JS::Value *vp)
+{
+    JS::CallArgs argv = JS::CallArgsFromVp(argc, vp);
+    if (!gjs_parse_call_args(context, "toggleQueueDepth", argv, ""))
+        return false;
+    argv.rval().setInt32(gjs_object_get_toggle_queue_depth());
+    return true;
+}
+
 static bool
 gjs_exit(JSContext *context,
          unsigned   argc,
@@ -171,6 +361,9 @@ static JSFunctionSpec module_funcs[] = {
     JS_FS("breakpoint", gjs_breakpoint, 0, GJS_MODULE_PROP_FLAGS),
     JS_FS("dumpHeapComplete", gjs_dump_heap_complete, 0, GJS_MODULE_PROP_FLAGS),
     JS_FS("gc", gjs_gc, 0, GJS_MODULE_PROP_FLAGS),
+    JS_FS("toggleQueueDepth", gjs_toggle_queue_depth, 0, GJS_MODULE_PROP_FLAGS),
+    JS_FS("gcHistory", gjs_gc_history, 0, GJS_MODULE_PROP_FLAGS),
+    JS_FS("typeReport", gjs_type_report, 0, GJS_MODULE_PROP_FLAGS),
     JS_FS("exit", gjs_exit, 0, GJS_MODULE_PROP_FLAGS),
     JS_FS("clearDateCaches", gjs_clear_date_caches, 0, GJS_MODULE_PROP_FLAGS),
     JS_FS_END
@@ -22,7 +22,10 @@
  */
 
 #include <config.h>
+#include <string.h>
+#include <unistd.h>
 #include <glib.h>
+#include <glib/gstdio.h>
 #include <glib-object.h>
 #include <util/glib.h>
 
@@ -85,6 +88,364 @@ gjstest_test_func_gjs_context_exit(void)
     g_object_unref(context);
 }
 
+static void
+gjstest_test_func_gjs_context_gc_incremental(void)
+{
+    GjsContext *context = gjs_context_new();
+    GError *error = NULL;
+    int status;
+
+    gjs_context_set_gc_slice_budget(context, 1);
+    g_assert_cmpuint(gjs_context_get_gc_slice_budget(context), ==, 1);
+
+    bool ok = gjs_context_eval(context,
+                               "let garbage = [];"
+                               "for (let i = 0; i < 100000; i++)"
+                               "    garbage.push({ i: i });"
+                               "garbage = null;",
+                               -1, "<input>", &status, &error);
+    g_assert_no_error(error);
+    g_assert_true(ok);
+
+    /* The collection is finished from the main loop */
+    gjs_context_gc_incremental(context);
+    while (g_main_context_pending(NULL) ||
+           gjs_context_get_gc_in_progress(context))
+        g_main_context_iteration(NULL, true);
+
+    g_assert_false(gjs_context_get_gc_in_progress(context));
+    g_assert_cmpint(gjs_context_get_last_gc_slice_duration(context), >, 0);
+
+    g_object_unref(context);
+}
+
+static void
+on_gc_finished(GjsContext *context,
+               GVariant   *info,
+               char      **reason_p)
+{
+    GVariant *finalized_types;
+
+    g_free(*reason_p);
+    g_variant_lookup(info, "reason", "s", reason_p);
+
+    finalized_types = g_variant_lookup_value(info, "finalized-types",
+                                             G_VARIANT_TYPE("a{su}"));
+    g_assert_nonnull(finalized_types);
+    g_variant_unref(finalized_types);
+}
+
+static void
+gjstest_test_func_gjs_context_gc_finished_signal(void)
+{
+    GjsContext *context = gjs_context_new();
+    char *reason = NULL;
+
+    /* Flush notifications for collections done during startup */
+    while (g_main_context_iteration(NULL, false));
+
+    g_signal_connect(context, "gc-finished",
+                     G_CALLBACK(on_gc_finished), &reason);
+
+    gjs_context_gc(context);
+    g_assert_null(reason);  /* emitted from the main loop */
+
+    while (g_main_context_iteration(NULL, false));
+    g_assert_cmpstr(reason, ==, "API");
+
+    g_free(reason);
+    g_object_unref(context);
+}
+
+static int
+eval_file_status(const char *filename)
+{
+    GjsContext *context = gjs_context_new();
+    GError *error = NULL;
+    int status = 0;
+
+    bool ok = gjs_context_eval_file(context, filename, &status, &error);
+    g_assert_no_error(error);
+    g_assert_true(ok);
+
+    g_object_unref(context);
+    return status;
+}
+
+/* Returns the offset of the bytecode in a cache file: it follows the
+ * magic, the engine id and the key, padded to 8 bytes */
+static gsize
+bytecode_cache_data_offset(const char *data,
+                           gsize       len)
+{
+    const char *p = data + 8;
+
+    for (int i = 0; i < 2; i++) {
+        p = (const char *) memchr(p, '\0', data + len - p);
+        g_assert_nonnull(p);
+        p++;
+    }
+
+    return ((p - data) + 7) & ~(gsize) 7;
+}
+
+static void
+gjstest_test_func_gjs_context_eval_file_bytecode_cache(void)
+{
+    GError *error = NULL;
+    char *tmpdir, *filename, *uri, *checksum, *cache_file;
+    char *contents;
+    gsize len, offset;
+
+    tmpdir = g_dir_make_tmp("gjs-test-XXXXXX", &error);
+    g_assert_no_error(error);
+    filename = g_build_filename(tmpdir, "cached.js", NULL);
+    g_file_set_contents(filename,
+                        "function add(a, b) { return a + b; }\n"
+                        "add(40, 2);\n",
+                        -1, &error);
+    g_assert_no_error(error);
+
+    /* The cache holds one file per script, named after its URI */
+    uri = g_filename_to_uri(filename, NULL, &error);
+    g_assert_no_error(error);
+    checksum = g_compute_checksum_for_string(G_CHECKSUM_SHA1, uri, -1);
+    cache_file = g_build_filename(g_get_user_cache_dir(), "gjs", "bytecode",
+                                  checksum, NULL);
+    g_unlink(cache_file);
+
+    /* The first run compiles and fills the cache, the second one uses
+     * the bytecode from the cache */
+    g_assert_cmpint(eval_file_status(filename), ==, 42);
+    g_assert_true(g_file_test(cache_file, G_FILE_TEST_IS_REGULAR));
+    g_assert_cmpint(eval_file_status(filename), ==, 42);
+
+    /* Corrupt bytecode is compiled again, and replaced */
+    g_file_get_contents(cache_file, &contents, &len, &error);
+    g_assert_no_error(error);
+    offset = bytecode_cache_data_offset(contents, len);
+    g_assert_cmpuint(offset + 4, <=, len);
+    memset(contents + offset, 0xff, 4);
+    g_file_set_contents(cache_file, contents, len, &error);
+    g_assert_no_error(error);
+    g_free(contents);
+
+    g_assert_cmpint(eval_file_status(filename), ==, 42);
+
+    g_file_get_contents(cache_file, &contents, &len, &error);
+    g_assert_no_error(error);
+    g_assert_cmpuint(offset + 4, <=, len);
+    g_assert_cmpint(memcmp(contents + offset, "\xff\xff\xff\xff", 4), !=, 0);
+    g_free(contents);
+
+    /* So is a truncated cache file */
+    g_assert_true(truncate(cache_file, offset / 2) == 0);
+    g_assert_cmpint(eval_file_status(filename), ==, 42);
+
+    /* Changing the script, here its size, makes the cached bytecode
+     * stale */
+    g_file_set_contents(filename,
+                        "function add(a, b) { return a + b; }\n"
+                        "add(40, 2) + 1;\n",
+                        -1, &error);
+    g_assert_no_error(error);
+    g_assert_cmpint(eval_file_status(filename), ==, 43);
+    g_assert_cmpint(eval_file_status(filename), ==, 43);
+
+    g_unlink(filename);
+    g_rmdir(tmpdir);
+    g_free(cache_file);
+    g_free(checksum);
+    g_free(uri);
+    g_free(filename);
+    g_free(tmpdir);
+}
+
+static void
+gjstest_test_func_gjs_context_prefetch_during_gc(void)
+{
+    GError *error = NULL;
+    int status;
+    char *tmpdir, *filename;
+    GString *module;
+
+    /* Big enough for SpiderMonkey to wait for a collection of the atoms
+     * zone before parsing it off the main thread */
+    module = g_string_new(NULL);
+    for (int i = 0; i < 4000; i++)
+        g_string_append_printf(module, "function f%d() { return %d; }\n",
+                               i, i);
+    g_string_append(module, "var value = 42;\n");
+    g_assert_cmpuint(module->len, >=, 100000);
+
+    tmpdir = g_dir_make_tmp("gjs-test-XXXXXX", &error);
+    g_assert_no_error(error);
+    filename = g_build_filename(tmpdir, "bigModule.js", NULL);
+    g_file_set_contents(filename, module->str, module->len, &error);
+    g_assert_no_error(error);
+
+    char *search_path[] = { tmpdir, NULL };
+    GjsContext *context = gjs_context_new_with_search_path(search_path);
+
+    gjs_context_set_gc_slice_budget(context, 1);
+    bool ok = gjs_context_eval(context,
+                               "let garbage = [];"
+                               "for (let i = 0; i < 100000; i++)"
+                               "    garbage.push({ i: i });"
+                               "garbage = null;",
+                               -1, "<input>", &status, &error);
+    g_assert_no_error(error);
+    g_assert_true(ok);
+
+    gjs_context_gc_incremental(context);
+    while (!gjs_context_get_gc_in_progress(context) &&
+           g_main_context_pending(NULL))
+        g_main_context_iteration(NULL, false);
+
+    if (!gjs_context_get_gc_in_progress(context)) {
+        g_test_skip("The collection finished in a single slice");
+    } else {
+        /* Used to wait forever for the prefetched script */
+        ok = gjs_context_eval(context,
+                              "imports.__prefetch__('bigModule');"
+                              "imports.bigModule.value;",
+                              -1, "<input>", &status, &error);
+        g_assert_no_error(error);
+        g_assert_true(ok);
+        g_assert_cmpint(status, ==, 42);
+    }
+
+    g_object_unref(context);
+
+    g_unlink(filename);
+    g_rmdir(tmpdir);
+    g_string_free(module, true);
+    g_free(filename);
+    g_free(tmpdir);
+}
+
+/* Reads a folded stacks report into a table from stack to self time */
+static GHashTable *
+read_startup_profile(const char *filename)
+{
+    GHashTable *frames = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                               g_free, NULL);
+    GError *error = NULL;
+    char *contents, **lines;
+
+    g_file_get_contents(filename, &contents, NULL, &error);
+    g_assert_no_error(error);
+
+    lines = g_strsplit(contents, "\n", -1);
+    for (char **line = lines; *line != NULL; line++) {
+        char *space = strrchr(*line, ' ');
+        if (space == NULL)
+            continue;
+
+        gint64 self = g_ascii_strtoll(space + 1, NULL, 10);
+        g_hash_table_insert(frames, g_strndup(*line, space - *line),
+                            GINT_TO_POINTER((int) self));
+    }
+
+    g_strfreev(lines);
+    g_free(contents);
+    return frames;
+}
+
+static int
+startup_profile_self_time(GHashTable *frames,
+                          const char *stack)
+{
+    gpointer self;
+
+    if (!g_hash_table_lookup_extended(frames, stack, NULL, &self))
+        g_error("No frame %s in the startup profile", stack);
+
+    return GPOINTER_TO_INT(self);
+}
+
+static void
+gjstest_test_func_gjs_startup_profile(void)
+{
+    GError *error = NULL;
+    char *tmpdir, *outer, *inner, *profile;
+    char *import_outer, *execute_outer, *import_inner, *stack;
+    GHashTable *frames;
+
+    /* The profiler is set up once per process, and reports at exit */
+    if (g_test_subprocess()) {
+        char *dir = g_path_get_dirname(g_getenv("GJS_PROFILE_STARTUP"));
+        char *search_path[] = { dir, NULL };
+        GjsContext *context = gjs_context_new_with_search_path(search_path);
+        int status;
+
+        bool ok = gjs_context_eval(context, "imports.outer.value;", -1,
+                                   "<input>", &status, &error);
+        g_assert_no_error(error);
+        g_assert_true(ok);
+        g_assert_cmpint(status, ==, 42);
+
+        g_object_unref(context);
+        g_free(dir);
+        return;
+    }
+
+    tmpdir = g_dir_make_tmp("gjs-test-XXXXXX", &error);
+    g_assert_no_error(error);
+    outer = g_build_filename(tmpdir, "outer.js", NULL);
+    inner = g_build_filename(tmpdir, "inner.js", NULL);
+    profile = g_build_filename(tmpdir, "profile.folded", NULL);
+
+    g_file_set_contents(outer, "var value = imports.inner.value + 1;\n",
+                        -1, &error);
+    g_assert_no_error(error);
+    g_file_set_contents(inner,
+                        "let start = Date.now();\n"
+                        "while (Date.now() - start < 50);\n"
+                        "var value = 41;\n",
+                        -1, &error);
+    g_assert_no_error(error);
+
+    g_setenv("GJS_PROFILE_STARTUP", profile, true);
+    g_test_trap_subprocess(NULL, 0, G_TEST_SUBPROCESS_INHERIT_STDERR);
+    g_unsetenv("GJS_PROFILE_STARTUP");
+    g_test_trap_assert_passed();
+
+    frames = read_startup_profile(profile);
+
+    import_outer = g_strdup("execute <input>;import outer");
+    execute_outer = g_strdup_printf("%s;execute %s", import_outer, outer);
+    import_inner = g_strdup_printf("%s;import inner", execute_outer);
+
+    stack = g_strdup_printf("%s;compile %s", import_outer, outer);
+    startup_profile_self_time(frames, stack);
+    g_free(stack);
+    stack = g_strdup_printf("%s;compile %s", import_inner, inner);
+    startup_profile_self_time(frames, stack);
+    g_free(stack);
+
+    /* The busy loop only counts in the self time of the frame running
+     * it, not in that of the frames above it */
+    stack = g_strdup_printf("%s;execute %s", import_inner, inner);
+    g_assert_cmpint(startup_profile_self_time(frames, stack), >=, 50000);
+    g_assert_cmpint(startup_profile_self_time(frames, execute_outer), <, 50000);
+    g_assert_cmpint(startup_profile_self_time(frames, import_outer), <, 50000);
+    g_free(stack);
+
+    g_unlink(profile);
+    g_unlink(inner);
+    g_unlink(outer);
+    g_rmdir(tmpdir);
+    g_hash_table_destroy(frames);
+    g_free(import_inner);
+    g_free(execute_outer);
+    g_free(import_outer);
+    g_free(profile);
+    g_free(inner);
+    g_free(outer);
+    g_free(tmpdir);
+}
+
 #define JS_CLASS "\
 const Lang    = imports.lang; \
 const GObject = imports.gi.GObject; \
@@ -267,6 +628,24 @@ gjstest_test_strip_shebang_return_null_for_just_shebang(void)
     g_assert(line_number == -1);
 }
 
+static void
+gjstest_test_strip_shebang_respect_length(void)
+{
+    /* Mapped files are not nul-terminated, so the newline past the end
+     * of the script must not be found */
+    const char *script = "#!foo\nbar";
+    gssize     script_len = 5;
+    int        line_number = 1;
+
+    const char *stripped = gjs_strip_unix_shebang(script,
+                                                  &script_len,
+                                                  &line_number);
+
+    g_assert(stripped == NULL);
+    g_assert(script_len == 0);
+    g_assert(line_number == -1);
+}
+
 int
 main(int    argc,
      char **argv)
@@ -281,10 +660,16 @@ main(int    argc,
     g_test_add_func("/gjs/context/construct/destroy", gjstest_test_func_gjs_context_construct_destroy);
     g_test_add_func("/gjs/context/construct/eval", gjstest_test_func_gjs_context_construct_eval);
     g_test_add_func("/gjs/context/exit", gjstest_test_func_gjs_context_exit);
+    g_test_add_func("/gjs/context/gc/incremental", gjstest_test_func_gjs_context_gc_incremental);
+    g_test_add_func("/gjs/context/gc/finished-signal", gjstest_test_func_gjs_context_gc_finished_signal);
+    g_test_add_func("/gjs/context/eval-file/bytecode-cache", gjstest_test_func_gjs_context_eval_file_bytecode_cache);
+    g_test_add_func("/gjs/context/prefetch/during-gc", gjstest_test_func_gjs_context_prefetch_during_gc);
+    g_test_add_func("/gjs/startup-profile/nested-imports", gjstest_test_func_gjs_startup_profile);
     g_test_add_func("/gjs/gobject/js_defined_type", gjstest_test_func_gjs_gobject_js_defined_type);
     g_test_add_func("/gjs/jsutil/strip_shebang/no_shebang", gjstest_test_strip_shebang_no_advance_for_no_shebang);
     g_test_add_func("/gjs/jsutil/strip_shebang/have_shebang", gjstest_test_strip_shebang_advance_for_shebang);
     g_test_add_func("/gjs/jsutil/strip_shebang/only_shebang", gjstest_test_strip_shebang_return_null_for_just_shebang);
+    g_test_add_func("/gjs/jsutil/strip_shebang/length", gjstest_test_strip_shebang_respect_length);
     g_test_add_func("/util/glib/strv/concat/null", gjstest_test_func_util_glib_strv_concat_null);
     g_test_add_func("/util/glib/strv/concat/pointers", gjstest_test_func_util_glib_strv_concat_pointers);
 